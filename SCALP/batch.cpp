@@ -0,0 +1,248 @@
+/*
+* Implements the BatchRunner class in batch.h
+* See comments in batch.h for more details
+*/
+
+#include "batch.h"
+#include "arena.h"
+#include "evaluator.h"
+#include "integrator.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "stats.h"
+#include "symbols.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+// Lines handed to a worker at a time; large enough to keep the input lock cold
+const size_t LINES_PER_TAKE = 64;
+
+// Results that may wait in the reordering window per worker thread
+const size_t WINDOW_PER_THREAD = 1024;
+
+// Constructor
+BatchRunner::BatchRunner() {
+	this->threadCount = 0;
+	this->windowSize = 0;
+	this->cache = NULL;
+	this->variable = SymbolTable::letter('x');
+	this->cursor = NULL;
+	this->end = NULL;
+	this->stream = NULL;
+	this->linesRead = 0;
+	this->inputDone = false;
+	this->linesWritten = 0;
+	this->workersRunning = 0;
+}
+
+void BatchRunner::setThreads(unsigned int t_threadCount) {
+	this->threadCount = t_threadCount;
+}
+
+void BatchRunner::setCache(ResultCache* t_cache) {
+	this->cache = t_cache;
+}
+
+void BatchRunner::setVariable(int t_variable) {
+	this->variable = t_variable;
+}
+
+void BatchRunner::setBudget(const BudgetLimits& t_budget) {
+	this->budget = t_budget;
+}
+
+void BatchRunner::setRuleOrder(const RuleOrder& t_ruleOrder) {
+	this->ruleOrder = t_ruleOrder;
+}
+
+size_t BatchRunner::takeLines(std::vector<std::string>& lines) {
+	lines.clear();
+	std::lock_guard<std::mutex> lock(inputMutex);
+	size_t first = linesRead;
+
+	while (!inputDone && lines.size() < LINES_PER_TAKE) {
+		if (stream != NULL) {
+			std::string line;
+			if (std::getline(*stream, line)) {
+				lines.push_back(line);
+			}
+			else {
+				inputDone = true;
+			}
+		}
+		else if (cursor < end) {
+			const char* newline = (const char*)memchr(cursor, '\n', end - cursor);
+			const char* lineEnd = (newline != NULL) ? newline : end;
+			lines.push_back(std::string(cursor, lineEnd));
+			cursor = (newline != NULL) ? newline + 1 : end;
+		}
+		else {
+			inputDone = true;
+		}
+	}
+
+	linesRead += lines.size();
+	return first;
+}
+
+// Integrates one input line the same way Tester::test1 does, but without the 42 character limit
+// The parser's tree lives in the worker's arena, so it is emptied afterwards on every path instead of deleting the tree
+std::string BatchRunner::integrateLine(const std::string& line, Interpreter& interpreter, Parser& parser, NodeArena& arena, Integrator& integrator) {
+	size_t length = line.size();
+	if (length > 0 && line[length - 1] == '\r') {
+		length--;
+	}
+	if (length == 0) {
+		return "";
+	}
+
+	std::string result;
+	try {
+		// interpret() edits in place and may insert one '*' per character, so leave room for twice the input
+		std::vector<char> text(2 * length + 4, 0);
+		memcpy(&text[0], line.data(), length);
+		interpreter.interpret(&text[0]);
+		Budget lineBudget(budget);
+		result = integrator.integrate(parser.parse(&text[0]), variable);
+	}
+	catch (const ParserException& exception) {
+		result = std::string("INVALID: ") + exception.what();
+	}
+	catch (const EvaluatorException& exception) {
+		result = std::string("INVALID: ") + exception.what();
+	}
+	catch (const BudgetException& exception) {
+		result = exception.what(); // Already starts "Budget exceeded:"
+	}
+	// Anything else, such as std::bad_alloc on a huge line, fails only this line, not the whole run
+	catch (const std::exception& exception) {
+		result = std::string("ERROR: ") + exception.what();
+	}
+	arena.reset();
+	return result;
+}
+
+void BatchRunner::worker() {
+	Interpreter interpreter; Parser parser; NodeArena arena; Integrator integrator;
+	parser.setArena(&arena);
+	integrator.setCache(cache);
+	integrator.setRuleOrder(ruleOrder);
+
+	std::vector<std::string> lines;
+	while (true) {
+		size_t first = takeLines(lines);
+		if (lines.empty()) {
+			break;
+		}
+
+		for (size_t i = 0; i < lines.size(); i++) {
+			std::string result = integrateLine(lines[i], interpreter, parser, arena, integrator);
+			size_t index = first + i;
+
+			// The oldest unwritten line can always be stored, so waiting here never deadlocks
+			std::unique_lock<std::mutex> lock(windowMutex);
+			while (index >= linesWritten + windowSize) {
+				slotFreed.wait(lock);
+			}
+			Slot& slot = window[index % windowSize];
+			slot.text.swap(result);
+			slot.ready = true;
+			if (index == linesWritten) {
+				slotReady.notify_one();
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(windowMutex);
+	workersRunning--;
+	slotReady.notify_one();
+}
+
+bool BatchRunner::run(const std::string& path, std::ostream& out, std::ostream& report) {
+	std::ifstream file;
+	stream = NULL; cursor = NULL; end = NULL;
+	if (path == "-") {
+		stream = &std::cin;
+	}
+	else if (mappedInput.open(path)) {
+		cursor = (const char*)mappedInput.data();
+		end = cursor + mappedInput.size();
+	}
+	else {
+		// Fall back to ordinary reads for things that cannot be mapped, such as pipes
+		file.open(path.c_str());
+		if (!file) {
+			report << "Could not open batch input \"" << path << "\"\n";
+			return false;
+		}
+		stream = &file;
+	}
+
+	unsigned int workers = threadCount;
+	if (workers == 0) {
+		workers = std::thread::hardware_concurrency();
+		if (workers == 0) workers = 1;
+	}
+
+	linesRead = 0; inputDone = false; linesWritten = 0;
+	windowSize = workers * WINDOW_PER_THREAD;
+	window.assign(windowSize, Slot());
+	for (size_t i = 0; i < windowSize; i++) window[i].ready = false;
+	workersRunning = workers;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> pool;
+	for (unsigned int i = 0; i < workers; i++) {
+		pool.push_back(std::thread(&BatchRunner::worker, this));
+	}
+
+	// This thread is the writer: it emits results strictly in input order as they become ready
+	std::string pending;
+	std::unique_lock<std::mutex> lock(windowMutex);
+	while (true) {
+		Slot& slot = window[linesWritten % windowSize];
+		if (slot.ready) {
+			pending += slot.text;
+			pending += '\n';
+			slot.text.clear();
+			slot.ready = false;
+			linesWritten++;
+			slotFreed.notify_all();
+
+			// Write outside the lock in blocks rather than line by line
+			if (pending.size() >= 64 * 1024) {
+				lock.unlock();
+				PhaseTimer timer(phaseFormat);
+				out.write(pending.data(), pending.size());
+				pending.clear();
+				lock.lock();
+			}
+		}
+		else if (workersRunning == 0) {
+			break;
+		}
+		else {
+			slotReady.wait(lock);
+		}
+	}
+	lock.unlock();
+	{
+		PhaseTimer timer(phaseFormat);
+		out.write(pending.data(), pending.size());
+		out.flush();
+	}
+
+	for (size_t i = 0; i < pool.size(); i++) {
+		pool[i].join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	report << "Processed " << linesWritten << " integrands in " << elapsed.count() << " s ("
+		<< (elapsed.count() > 0 ? linesWritten / elapsed.count() : 0) << " per second) using " << workers << " threads\n";
+
+	window.clear();
+	mappedInput.close();
+	return true;
+}
@@ -0,0 +1,96 @@
+/*
+* Declares a BatchRunner class, which integrates a whole file of integrands (one per line) on a pool of threads.
+* Results are written one per line in the same order as the input, followed by a throughput report.
+*
+* Each worker thread has its own Interpreter, Parser, NodeArena and Integrator, so nothing but the input, the output window and
+* the optional ResultCache is shared. Workers may finish out of order; a finished result waits in a bounded
+* reordering window until every earlier line has been written, and a worker that gets too far ahead waits for
+* the writer to catch up, so memory use stays flat no matter how long the input is.
+* Each line runs under a Budget (see budget.h) set with setBudget(); a line that runs out of it gets a
+* "Budget exceeded: ..." result instead of holding up its worker. Any other failure of a line, such as running out
+* of memory, gives an "ERROR: ..." result for that line and the run goes on.
+*
+*  Sample usage:
+*   BatchRunner runner;
+*   runner.setThreads(8);
+*   runner.run("integrands.txt", std::cout, std::cerr);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_BATCH_H_
+#define SCALP_BATCH_H_
+
+#include "budget.h"
+#include "mappedfile.h"
+#include "ruleorder.h"
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Integrator;
+class Interpreter;
+class NodeArena;
+class Parser;
+class ResultCache;
+
+class BatchRunner
+{
+	unsigned int threadCount;
+	size_t windowSize;
+	ResultCache* cache;
+	int variable;
+	BudgetLimits budget;
+	RuleOrder ruleOrder;
+
+	// Input: either a mapped file that is handed out line by line, or a stream read under the same lock
+	MappedFile mappedInput;
+	const char* cursor;
+	const char* end;
+	std::istream* stream;
+	std::mutex inputMutex;
+	size_t linesRead;
+	bool inputDone;
+
+	// Reordering window: slot (i % windowSize) holds line i's result until it has been written
+	struct Slot {
+		std::string text;
+		bool ready;
+	};
+	std::vector<Slot> window;
+	std::mutex windowMutex;
+	std::condition_variable slotReady;
+	std::condition_variable slotFreed;
+	size_t linesWritten;
+	unsigned int workersRunning;
+
+	// Hands the calling worker the next few input lines and returns the index of the first one
+	size_t takeLines(std::vector<std::string>& lines);
+	void worker();
+	std::string integrateLine(const std::string& line, Interpreter& interpreter, Parser& parser, NodeArena& arena, Integrator& integrator);
+
+public:
+	BatchRunner();
+
+	// Number of worker threads; 0 (the default) means one per hardware thread
+	void setThreads(unsigned int t_threadCount);
+
+	// Optional shared persistent cache; NULL to disable
+	void setCache(ResultCache* t_cache);
+
+	// Symbol id of the variable of integration (see symbols.h); x by default
+	void setVariable(int t_variable);
+
+	// Limits for each line; by default there are none
+	void setBudget(const BudgetLimits& t_budget);
+
+	// Order in which workers try the integrator's table rules (see ruleorder.h)
+	void setRuleOrder(const RuleOrder& t_ruleOrder);
+
+	// Integrates every line of the file at path ("-" reads standard input) and writes one result line per input line to out
+	// The throughput report goes to report; returns false if the input could not be opened
+	bool run(const std::string& path, std::ostream& out, std::ostream& report);
+};
+
+#endif // SCALP_BATCH_H_
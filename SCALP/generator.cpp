@@ -0,0 +1,193 @@
+/*
+* Implements the ExpressionGenerator class in generator.h
+* See comments in generator.h for more details
+*/
+
+#include "generator.h"
+#include "symbols.h"
+#include <cstdlib>
+#include <sstream>
+
+const char* OPERATOR_NAMES[GENERATED_OPERATOR_COUNT] = { "+", "-", "*", "/", "^", "neg" };
+const char* FUNCTION_NAMES[GENERATED_FUNCTION_COUNT] = { "sin", "cos", "tan", "sec", "csc", "cot", "ln", "log" };
+
+// Constructor; the defaults give small polynomial-like expressions in x with the occasional function call
+GeneratorOptions::GeneratorOptions() {
+	this->seed = 1;
+	this->size = 15;
+	this->maxDepth = 12;
+	this->operatorWeights[genPlus] = 4;
+	this->operatorWeights[genMinus] = 2;
+	this->operatorWeights[genMul] = 3;
+	this->operatorWeights[genDivision] = 1;
+	this->operatorWeights[genPower] = 1;
+	this->operatorWeights[genNegate] = 0;
+	for (int i = 0; i < GENERATED_FUNCTION_COUNT; i++) {
+		this->functionWeights[i] = 1;
+	}
+	this->functionShare = 0.15;
+	this->variables = "x";
+	this->variableShare = 0.5;
+	this->maxConstant = 9;
+	this->maxExponent = 4;
+}
+
+// Parses "name:weight,name:weight" into weights indexed like names
+static bool parseMix(const std::string& mix, const char* const* names, int count, double* weights) {
+	std::vector<double> parsed(count, 0);
+	std::stringstream sstr(mix);
+	std::string entry;
+	while (std::getline(sstr, entry, ',')) {
+		size_t colon = entry.find(':');
+		std::string name = entry.substr(0, colon);
+		int i = 0;
+		while (i < count && name != names[i]) i++;
+		if (i == count) {
+			return false;
+		}
+		parsed[i] = (colon == std::string::npos) ? 1 : atof(entry.c_str() + colon + 1);
+	}
+	for (int i = 0; i < count; i++) {
+		weights[i] = parsed[i];
+	}
+	return true;
+}
+
+bool GeneratorOptions::setOperatorMix(const std::string& mix) {
+	return parseMix(mix, OPERATOR_NAMES, GENERATED_OPERATOR_COUNT, operatorWeights);
+}
+
+bool GeneratorOptions::setFunctionMix(const std::string& mix) {
+	return parseMix(mix, FUNCTION_NAMES, GENERATED_FUNCTION_COUNT, functionWeights);
+}
+
+bool GeneratorOptions::setVariables(const std::string& letters) {
+	for (size_t i = 0; i < letters.size(); i++) {
+		if (SymbolTable::letter(letters[i]) < 0) {
+			return false;
+		}
+	}
+	variables = letters;
+	return true;
+}
+
+// Constructor
+ExpressionGenerator::ExpressionGenerator(const GeneratorOptions& t_options) {
+	this->options = t_options;
+	this->state = t_options.seed;
+}
+
+// SplitMix64
+unsigned long long ExpressionGenerator::nextRandom() {
+	unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+double ExpressionGenerator::nextUnit() {
+	return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform in [low, high]
+int ExpressionGenerator::nextInt(int low, int high) {
+	if (high <= low) return low;
+	return low + (int)(nextRandom() % (unsigned long long)(high - low + 1));
+}
+
+// Returns an index chosen with probability proportional to its weight, or -1 if every weight is 0
+int ExpressionGenerator::pickWeighted(const double* weights, int count) {
+	double total = 0;
+	for (int i = 0; i < count; i++) total += weights[i];
+	if (total <= 0) return -1;
+
+	double target = nextUnit() * total;
+	for (int i = 0; i < count; i++) {
+		if (target < weights[i]) return i;
+		target -= weights[i];
+	}
+	return count - 1;
+}
+
+void ExpressionGenerator::generateLeaf(std::string& out) {
+	if (!options.variables.empty() && nextUnit() < options.variableShare) {
+		out += options.variables[nextInt(0, (int)options.variables.size() - 1)];
+	}
+	else {
+		out += std::to_string(nextInt(1, options.maxConstant));
+	}
+}
+
+// Appends an expression of about size nodes; every non-leaf is wrapped in parentheses
+void ExpressionGenerator::generateNode(std::string& out, int size, int depth) {
+	if (size <= 1 || depth >= options.maxDepth) {
+		generateLeaf(out);
+		return;
+	}
+
+	if (nextUnit() < options.functionShare) {
+		int function = pickWeighted(options.functionWeights, GENERATED_FUNCTION_COUNT);
+		if (function >= 0) {
+			out += "(";
+			out += FUNCTION_NAMES[function];
+			out += "(";
+			// Logs are always written with an explicit base; see Parser::handleLog
+			if (function == genLog) {
+				out += std::to_string(nextInt(2, 10));
+				out += ",";
+			}
+			generateNode(out, size - 1, depth + 1);
+			out += "))";
+			return;
+		}
+	}
+
+	int op = pickWeighted(options.operatorWeights, GENERATED_OPERATOR_COUNT);
+	if (op < 0) {
+		generateLeaf(out);
+		return;
+	}
+
+	out += "(";
+	if (op == genNegate) {
+		out += "-";
+		generateNode(out, size - 1, depth + 1);
+	}
+	else if (op == genPower) {
+		// Small integer exponents keep results finite and within the integrator's reach
+		generateNode(out, size - 2, depth + 1);
+		out += "^";
+		out += std::to_string(nextInt(2, options.maxExponent < 2 ? 2 : options.maxExponent));
+	}
+	else {
+		// Split the remaining nodes at random, or evenly when the depth budget would not fit a lopsided split
+		int remaining = size - 1;
+		int levelsLeft = options.maxDepth - depth - 1;
+		int leftSize;
+		if (levelsLeft < 30 && (1 << levelsLeft) < remaining) {
+			leftSize = remaining / 2;
+		}
+		else {
+			leftSize = nextInt(1, remaining - 1);
+		}
+		generateNode(out, leftSize, depth + 1);
+		out += OPERATOR_NAMES[op];
+		generateNode(out, remaining - leftSize, depth + 1);
+	}
+	out += ")";
+}
+
+std::string ExpressionGenerator::generate() {
+	std::string out;
+	generateNode(out, options.size, 0);
+	return out;
+}
+
+std::vector<std::string> ExpressionGenerator::generateCorpus(int count) {
+	std::vector<std::string> corpus;
+	for (int i = 0; i < count; i++) {
+		corpus.push_back(generate());
+	}
+	return corpus;
+}
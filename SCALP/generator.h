@@ -0,0 +1,91 @@
+/*
+* Declares an ExpressionGenerator class that produces random, well-formed expressions in the syntax the Interpreter
+* and Parser accept, for building reproducible stress and scaling corpora.
+*
+* The same seed and options always give the same sequence of expressions on every platform (the generator uses its
+* own SplitMix64 stream rather than the implementation-defined standard distributions).
+*
+* Size is counted in expression nodes: every number, variable, operator and function call is one node. The parser
+* adds identity wrapper nodes of its own, so a parsed tree is larger than the generated size.
+*
+* Function calls and compound operands are always parenthesized, so the text parses into exactly the tree that
+* was generated.
+*
+*  Sample usage:
+*   GeneratorOptions options;
+*   options.seed = 42; options.size = 1000; options.maxDepth = 30;
+*   options.setOperatorMix("+:4,-:2,*:3,/:1,^:1");
+*   ExpressionGenerator generator(options);
+*   std::string text = generator.generate();
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_GENERATOR_H_
+#define SCALP_GENERATOR_H_
+
+#include <string>
+#include <vector>
+
+// Indexes into GeneratorOptions::operatorWeights
+enum GeneratedOperator { genPlus, genMinus, genMul, genDivision, genPower, genNegate, GENERATED_OPERATOR_COUNT };
+
+// Indexes into GeneratorOptions::functionWeights
+enum GeneratedFunction { genSin, genCos, genTan, genSec, genCsc, genCot, genLn, genLog, GENERATED_FUNCTION_COUNT };
+
+struct GeneratorOptions {
+	unsigned long long seed;
+
+	// Target number of nodes per expression, and how deep the tree may get before only leaves are produced
+	int size;
+	int maxDepth;
+
+	// Relative weights; an inner node is a function call with probability functionShare, otherwise an operator
+	double operatorWeights[GENERATED_OPERATOR_COUNT];
+	double functionWeights[GENERATED_FUNCTION_COUNT];
+	double functionShare;
+
+	// Leaves are variables with probability variableShare, otherwise integers in [1, maxConstant]
+	// An empty variable list makes constant-only expressions that the Evaluator can compute
+	std::string variables;
+	double variableShare;
+	int maxConstant;
+
+	// Largest integer exponent used on the right of '^'
+	int maxExponent;
+
+	GeneratorOptions();
+
+	// Sets weights from a list like "+:4,-:2,*:3,/:1,^:1,neg:1" or "sin:1,cos:1,ln:2"; names not listed get weight 0
+	// Returns false if the list contains an unknown name
+	bool setOperatorMix(const std::string& mix);
+	bool setFunctionMix(const std::string& mix);
+
+	// Sets the variables from a list of single letters like "xyz"; returns false, and changes nothing, if any
+	// character is not a letter, since every character becomes a leaf of its own
+	bool setVariables(const std::string& letters);
+};
+
+class ExpressionGenerator
+{
+	GeneratorOptions options;
+	unsigned long long state;
+
+	unsigned long long nextRandom();
+	double nextUnit();
+	int nextInt(int low, int high);
+	int pickWeighted(const double* weights, int count);
+
+	void generateNode(std::string& out, int size, int depth);
+	void generateLeaf(std::string& out);
+
+public:
+	ExpressionGenerator(const GeneratorOptions& t_options);
+
+	// Returns the next expression in the sequence
+	std::string generate();
+
+	// Returns the next count expressions
+	std::vector<std::string> generateCorpus(int count);
+};
+
+#endif // SCALP_GENERATOR_H_
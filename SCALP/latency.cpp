@@ -0,0 +1,97 @@
+/*
+* Implements the LatencyHistogram class in latency.h
+* See comments in latency.h for more details
+*/
+
+#include "latency.h"
+#include <cstring>
+#include <sstream>
+
+// Constructor
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+// Values below SUB_BUCKETS get a bucket each; above that, bucket = 8 * (octave) + the next three bits below the top bit
+int LatencyHistogram::bucketOf(unsigned long long nanoseconds) {
+	if (nanoseconds < SUB_BUCKETS) {
+		return (int)nanoseconds;
+	}
+	int topBit = 63;
+	while ((nanoseconds >> topBit) == 0) {
+		topBit--;
+	}
+	int octave = topBit - 2; // 8..15 lands in octave 1
+	int sub = (int)((nanoseconds >> (topBit - 3)) & (SUB_BUCKETS - 1));
+	return octave * SUB_BUCKETS + sub;
+}
+
+unsigned long long LatencyHistogram::bucketUpperBound(int bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return (unsigned long long)bucket;
+	}
+	int octave = bucket / SUB_BUCKETS;
+	int sub = bucket % SUB_BUCKETS;
+	int topBit = octave + 2;
+	unsigned long long lower = (1ULL << topBit) | ((unsigned long long)sub << (topBit - 3));
+	return lower + (1ULL << (topBit - 3)) - 1;
+}
+
+void LatencyHistogram::record(unsigned long long nanoseconds) {
+	counts[bucketOf(nanoseconds)]++;
+	total++;
+	if (nanoseconds > maximum) {
+		maximum = nanoseconds;
+	}
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+	for (int i = 0; i < BUCKETS; i++) {
+		counts[i] += other.counts[i];
+	}
+	total += other.total;
+	if (other.maximum > maximum) {
+		maximum = other.maximum;
+	}
+}
+
+void LatencyHistogram::reset() {
+	memset(counts, 0, sizeof(counts));
+	total = 0;
+	maximum = 0;
+}
+
+unsigned long long LatencyHistogram::count() const {
+	return total;
+}
+
+unsigned long long LatencyHistogram::percentile(double p) const {
+	if (total == 0) {
+		return 0;
+	}
+	unsigned long long rank = (unsigned long long)(p * total);
+	if (rank >= total) {
+		rank = total - 1;
+	}
+
+	unsigned long long seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		seen += counts[i];
+		if (seen > rank) {
+			unsigned long long bound = bucketUpperBound(i);
+			return (bound < maximum) ? bound : maximum;
+		}
+	}
+	return maximum;
+}
+
+std::string LatencyHistogram::summary() const {
+	std::stringstream sstr;
+	sstr << "count=" << total
+		<< " p50=" << percentile(0.50) / 1000.0 << "us"
+		<< " p90=" << percentile(0.90) / 1000.0 << "us"
+		<< " p99=" << percentile(0.99) / 1000.0 << "us"
+		<< " p99.9=" << percentile(0.999) / 1000.0 << "us"
+		<< " max=" << maximum / 1000.0 << "us";
+	return sstr.str();
+}
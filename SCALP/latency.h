@@ -0,0 +1,43 @@
+/*
+* Declares a LatencyHistogram class that records durations in log-linear buckets so that percentiles (p50, p99, ...)
+* can be reported without keeping every sample. Each power of two is split into 8 buckets, so a reported
+* percentile is within 12.5% of the true value.
+*
+* A histogram is not synchronized; keep one per thread and merge() them when reporting.
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_LATENCY_H_
+#define SCALP_LATENCY_H_
+
+#include <string>
+
+class LatencyHistogram
+{
+	static const int SUB_BUCKETS = 8;
+	static const int BUCKETS = 64 * SUB_BUCKETS;
+
+	unsigned long long counts[BUCKETS];
+	unsigned long long total;
+	unsigned long long maximum;
+
+	static int bucketOf(unsigned long long nanoseconds);
+	static unsigned long long bucketUpperBound(int bucket);
+
+public:
+	LatencyHistogram();
+
+	void record(unsigned long long nanoseconds);
+	void merge(const LatencyHistogram& other);
+	void reset();
+
+	unsigned long long count() const;
+
+	// Returns (an upper bound on) the duration below which fraction p of the samples fall, e.g. p = 0.99
+	unsigned long long percentile(double p) const;
+
+	// One line summary: count, p50, p90, p99, p99.9 and max, in microseconds
+	std::string summary() const;
+};
+
+#endif // SCALP_LATENCY_H_
@@ -1,12 +1,264 @@
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include "batch.h"
+#include "budget.h"
+#include "generator.h"
+#include "resultcache.h"
+#include "ruleorder.h"
+#include "server.h"
+#include "stats.h"
+#include "symbols.h"
 #include "tester.h"
+#include "trace.h"
 
-int main() {
+// Size cap of the on-disk result cache enabled with --cache
+const size_t CACHE_SIZE = 64 * 1024 * 1024;
+
+// Lets Ctrl+C (or a service manager's SIGTERM) shut the server down cleanly so it can print its latency report
+Server* activeServer = NULL;
+void stopServer(int) {
+	if (activeServer != NULL) activeServer->stop();
+}
+
+// Adds the rule hits of this run to the order loaded from path (if any) and saves it for the next run
+void saveRuleOrder(RuleOrder& ruleOrder, const std::string& path) {
+	if (path.empty()) {
+		return;
+	}
+	ruleOrder.adapt(Stats::collect());
+	if (!ruleOrder.save(path)) std::cerr << "Could not write rule order to \"" << path << "\"\n";
+}
+
+// Prints the pipeline stats to stderr and/or writes them as JSON, as requested on the command line
+void reportStats(bool print, const std::string& jsonPath) {
+	StatsSnapshot snapshot = Stats::collect();
+	if (print) {
+		std::cerr << snapshot.toText();
+	}
+	if (!jsonPath.empty()) {
+		std::ofstream file(jsonPath.c_str(), std::ios::trunc);
+		file << snapshot.toJson() << "\n";
+		if (!file) std::cerr << "Could not write stats to \"" << jsonPath << "\"\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
 	// All implementations have been moved to other files in an attempt to keep main.cpp clean
 	// The test function can still be called directly from here
 	// Oh and FYI, the parser exception positions correspond to the interpreted equation, not the original input
 	
-	Tester tester; std::string input;
+	Tester tester; std::string input; ResultCache cache;
+	std::string batchInput, batchOutput, serveEndpoint; unsigned int threads = 0;
+	GeneratorOptions generatorOptions; int generateCount = -1;
+	bool printStats = false; std::string statsJsonPath; bool printTrace = false;
+	std::string corpusPath, baselinePath; double tolerance = 0.25; bool updateBaseline = false;
+	std::string variable = "x";
+	BudgetLimits budget;
+	std::string ruleOrderPath; RuleOrder ruleOrder;
+
+	// Command line options:
+	//   --cache <file>    keeps integration results on disk so that a restarted SCALP answers repeat inputs immediately
+	//   --batch <file>    integrates every line of file ("-" for standard input) instead of running interactively
+	//   --serve <where>   answers requests on a Unix domain socket path or a localhost TCP port (see server.h)
+	//   --rule-order <file>  tries the integrator's most used table rules first, in the order saved in file by an earlier
+	//                     batch or server run, and saves the order learned from this one when it ends (see ruleorder.h)
+	//   --threads <n>     number of batch or server worker threads (default: one per hardware thread)
+	//   --output <file>   where batch or generated results go (default: standard output)
+	//   --variable <name> integrates with respect to name instead of x, interactively and in batch mode
+	//   --budget-ms <n>, --budget-nodes <n>, --budget-bytes <n>
+	//                     limits the time, AST nodes and arena storage of each batch line or server request (see budget.h)
+	//   --stats           prints per-phase timings and counters to standard error when batch or server mode ends;
+	//                     interactively, enter "!stats" to see them
+	//   --stats-json <file>  writes the same data as JSON when batch or server mode ends
+	//   --corpus <file>   checks the answers and timing budgets of a golden corpus (see Tester::runCorpus and golden.tsv)
+	//   --baseline <file> timings to compare the corpus run against; --tolerance <fraction> allowed slowdown (default 0.25)
+	//   --update-baseline rewrites the baseline file from this run instead of comparing
+	//   --let             interactively, also prints every answer with its repeated subterms named once
+	//   --trace           interactively, prints the rules and rewrites behind every answer (builds with SCALP_ENABLE_TRACE only)
+	//   --generate <n>    writes n random expressions, one per line, for use as a --batch corpus (see generator.h)
+	//   --seed <n>, --size <n>, --depth <n>, --ops <mix>, --functions <mix>, --variables <letters>
+	//                     shape the generated expressions, e.g. --ops "+:4,*:3,^:1" --functions "sin:1,ln:1"
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (option == "--cache" && i + 1 < argc) {
+			if (cache.open(argv[++i], CACHE_SIZE)) {
+				tester.setCache(&cache);
+			}
+			else {
+				std::cerr << "Could not open result cache \"" << argv[i] << "\"; continuing without it\n";
+			}
+		}
+		else if (option == "--batch" && i + 1 < argc) {
+			batchInput = argv[++i];
+		}
+		else if (option == "--serve" && i + 1 < argc) {
+			serveEndpoint = argv[++i];
+		}
+		else if (option == "--variable" && i + 1 < argc) {
+			variable = argv[++i];
+			if (!SymbolTable::isName(variable) || SymbolTable::intern(variable) < 0) {
+				std::cerr << "Invalid --variable name \"" << variable << "\"\n";
+				return 1;
+			}
+		}
+		else if (option == "--budget-ms" && i + 1 < argc) {
+			budget.seconds = atof(argv[++i]) / 1000;
+		}
+		else if (option == "--budget-nodes" && i + 1 < argc) {
+			budget.maxNodes = (size_t)strtoull(argv[++i], NULL, 10);
+		}
+		else if (option == "--budget-bytes" && i + 1 < argc) {
+			budget.maxArenaBytes = (size_t)strtoull(argv[++i], NULL, 10);
+		}
+		else if (option == "--rule-order" && i + 1 < argc) {
+			ruleOrderPath = argv[++i];
+		}
+		else if (option == "--threads" && i + 1 < argc) {
+			threads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (option == "--output" && i + 1 < argc) {
+			batchOutput = argv[++i];
+		}
+		else if (option == "--stats") {
+			printStats = true;
+		}
+		else if (option == "--stats-json" && i + 1 < argc) {
+			statsJsonPath = argv[++i];
+		}
+		else if (option == "--corpus" && i + 1 < argc) {
+			corpusPath = argv[++i];
+		}
+		else if (option == "--baseline" && i + 1 < argc) {
+			baselinePath = argv[++i];
+		}
+		else if (option == "--tolerance" && i + 1 < argc) {
+			tolerance = atof(argv[++i]);
+		}
+		else if (option == "--update-baseline") {
+			updateBaseline = true;
+		}
+		else if (option == "--let") {
+			tester.setShareOutput(true);
+		}
+		else if (option == "--trace") {
+			if (!Trace::enabled) {
+				std::cerr << "Tracing is not compiled into this build; rebuild with SCALP_ENABLE_TRACE=1\n";
+				return 1;
+			}
+			printTrace = true;
+		}
+		else if (option == "--generate" && i + 1 < argc) {
+			generateCount = atoi(argv[++i]);
+		}
+		else if (option == "--seed" && i + 1 < argc) {
+			generatorOptions.seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (option == "--size" && i + 1 < argc) {
+			generatorOptions.size = atoi(argv[++i]);
+		}
+		else if (option == "--depth" && i + 1 < argc) {
+			generatorOptions.maxDepth = atoi(argv[++i]);
+		}
+		else if (option == "--variables" && i + 1 < argc) {
+			if (!generatorOptions.setVariables(argv[++i])) {
+				std::cerr << "Invalid --variables list \"" << argv[i] << "\"; give single letters, such as \"xyz\"\n";
+				return 1;
+			}
+		}
+		else if ((option == "--ops" || option == "--functions") && i + 1 < argc) {
+			bool valid = (option == "--ops") ? generatorOptions.setOperatorMix(argv[++i]) : generatorOptions.setFunctionMix(argv[++i]);
+			if (!valid) {
+				std::cerr << "Invalid " << option << " list \"" << argv[i] << "\"\n";
+				return 1;
+			}
+		}
+		else {
+			std::cerr << "Unknown option \"" << option << "\"\n";
+			return 1;
+		}
+	}
+
+	if (!corpusPath.empty()) {
+		return tester.runCorpus(corpusPath, baselinePath, tolerance, updateBaseline, std::cerr) == 0 ? 0 : 1;
+	}
+
+	// A missing file is fine (this is the first run); it is written when the run ends
+	if (!ruleOrderPath.empty() && !ruleOrder.load(ruleOrderPath)) {
+		std::ifstream existing(ruleOrderPath.c_str());
+		if (existing) {
+			std::cerr << "\"" << ruleOrderPath << "\" is not a saved rule order\n";
+			return 1;
+		}
+	}
+
+	if (generateCount >= 0) {
+		std::ofstream outputFile;
+		if (!batchOutput.empty()) {
+			outputFile.open(batchOutput.c_str(), std::ios::binary | std::ios::trunc);
+			if (!outputFile) {
+				std::cerr << "Could not open generator output \"" << batchOutput << "\"\n";
+				return 1;
+			}
+		}
+		std::ostream& out = batchOutput.empty() ? std::cout : outputFile;
+
+		ExpressionGenerator generator(generatorOptions);
+		for (int i = 0; i < generateCount; i++) {
+			out << generator.generate() << "\n";
+		}
+		return 0;
+	}
+
+	// Batch mode reports to stderr so that stdout carries nothing but results
+	if (!batchInput.empty()) {
+		BatchRunner runner;
+		runner.setThreads(threads);
+		runner.setVariable(SymbolTable::intern(variable));
+		runner.setBudget(budget);
+		runner.setRuleOrder(ruleOrder);
+		if (cache.isOpen()) runner.setCache(&cache);
+
+		std::ofstream outputFile;
+		if (!batchOutput.empty()) {
+			outputFile.open(batchOutput.c_str(), std::ios::binary | std::ios::trunc);
+			if (!outputFile) {
+				std::cerr << "Could not open batch output \"" << batchOutput << "\"\n";
+				return 1;
+			}
+		}
+		else {
+			std::ios::sync_with_stdio(false);
+		}
+		bool succeeded = runner.run(batchInput, batchOutput.empty() ? std::cout : outputFile, std::cerr);
+		reportStats(printStats, statsJsonPath);
+		saveRuleOrder(ruleOrder, ruleOrderPath);
+		return succeeded ? 0 : 1;
+	}
+
+	if (!serveEndpoint.empty()) {
+		Server server;
+		server.setWorkers(threads);
+		server.setBudget(budget);
+		server.setRuleOrder(ruleOrder);
+		if (cache.isOpen()) server.setCache(&cache);
+		if (!server.listen(serveEndpoint, std::cerr)) {
+			return 1;
+		}
+
+		activeServer = &server;
+		signal(SIGINT, stopServer);
+		signal(SIGTERM, stopServer);
+		server.run();
+		activeServer = NULL;
+
+		std::cerr << server.latencyReport() << "\n";
+		reportStats(printStats, statsJsonPath);
+		saveRuleOrder(ruleOrder, ruleOrderPath);
+		return 0;
+	}
+
 	std::cout << "I am SCALP, created by Hung, Minh, and Hunter\n";
 	std::cout << "I can do symbolic integration!\n\n";
 
@@ -14,10 +266,23 @@ int main() {
 		std::cout << "Input: ";
 		getline(std::cin, input);
 		std::cout << "\n";
-		tester.test1(&input[0u], false);
+		if (input == "!stats") {
+			std::cout << Stats::collect().toText() << "\n";
+			continue;
+		}
+		Trace::clear();
+		tester.test1(&input[0u], false, variable.c_str());
+		if (printTrace) {
+			std::cout << "Derivation:\n" << Trace::dump() << "\n";
+		}
 	}
 
 	//tester.testIntergationI();
+	//tester.testMultivariate();
+	//tester.testBuilder();
+	//tester.testCompiled();
+	//tester.testSerialization();
+	//tester.testSymbolLimit();
 	//tester.testLogs();
 	//tester.testArithmetic();
 	//tester.testVariables();
@@ -0,0 +1,584 @@
+/*
+* Implements the Server class in server.h
+* See comments in server.h for the protocol
+*/
+
+#include "server.h"
+#include "arena.h"
+#include "evaluator.h"
+#include "integrator.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "stats.h"
+#include "symbols.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// A connection stops reading new requests while this many of its responses are still outstanding
+const unsigned long long MAX_PIPELINED_REQUESTS = 1024;
+
+const int MAX_EVENTS = 64;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Server::Connection {
+	int descriptor;
+	unsigned long long id;
+	std::string input;          // Bytes received but not yet split into requests
+	std::string output;         // Encoded responses not yet written
+	size_t outputSent;
+	unsigned long long nextSequence;  // Sequence number of the next request read
+	unsigned long long nextToSend;    // Sequence number of the next response to queue
+	std::map<unsigned long long, std::string> finished; // Encoded responses that arrived ahead of their turn
+	std::map<unsigned long long, std::string> statsRequests; // Stats requests, answered once their turn comes
+	bool peerClosed;
+	unsigned int interest;
+};
+
+struct Server::Job {
+	unsigned long long connectionId;
+	unsigned long long sequence;
+	std::string request;
+	Clock::time_point received;
+};
+
+struct Server::Completion {
+	unsigned long long connectionId;
+	unsigned long long sequence;
+	unsigned char status;
+	std::string text;
+	Clock::time_point received;
+};
+
+static void appendFrame(std::string& out, unsigned char status, const std::string& text) {
+	unsigned int length = (unsigned int)text.size() + 1;
+	out += (char)((length >> 24) & 0xFF);
+	out += (char)((length >> 16) & 0xFF);
+	out += (char)((length >> 8) & 0xFF);
+	out += (char)(length & 0xFF);
+	out += (char)status;
+	out += text;
+}
+
+// Constructor
+Server::Server() {
+	this->workerCount = 0;
+	this->cache = NULL;
+	this->listenDescriptor = -1;
+	this->epollDescriptor = -1;
+	this->wakeDescriptor = -1;
+	this->stopping = false;
+	this->nextConnectionId = 1;
+	this->workersStopping = false;
+}
+
+void Server::setWorkers(unsigned int t_workerCount) {
+	this->workerCount = t_workerCount;
+}
+
+void Server::setCache(ResultCache* t_cache) {
+	this->cache = t_cache;
+}
+
+void Server::setBudget(const BudgetLimits& t_budget) {
+	this->budget = t_budget;
+}
+
+void Server::setRuleOrder(const RuleOrder& t_ruleOrder) {
+	this->ruleOrder = t_ruleOrder;
+}
+
+std::string Server::latencyReport() const {
+	return "latency " + latency.summary();
+}
+
+// Workers parse into their own arena, which is emptied after every request instead of deleting the tree
+void Server::worker() {
+	Interpreter interpreter; Parser parser; NodeArena arena; Integrator integrator;
+	parser.setArena(&arena);
+	integrator.setCache(cache);
+	integrator.setRuleOrder(ruleOrder);
+
+	while (true) {
+		Job* job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			while (jobs.empty() && !workersStopping) {
+				jobAvailable.wait(lock);
+			}
+			if (jobs.empty()) {
+				return;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		Completion* completion = new Completion;
+		completion->connectionId = job->connectionId;
+		completion->sequence = job->sequence;
+		completion->received = job->received;
+		completion->status = RESPONSE_OK;
+
+		try {
+			// interpret() edits in place and may insert one '*' per character, so leave room for twice the input
+			std::vector<char> text(2 * job->request.size() + 4, 0);
+			memcpy(&text[0], job->request.data(), job->request.size());
+			interpreter.interpret(&text[0]);
+			Budget requestBudget(budget);
+			completion->text = integrator.integrate(parser.parse(&text[0]));
+		}
+		catch (const BudgetException& exception) {
+			completion->status = RESPONSE_BUDGET_EXCEEDED;
+			completion->text = exception.what();
+		}
+		catch (const ParserException& exception) {
+			completion->status = RESPONSE_INVALID;
+			completion->text = exception.what();
+		}
+		catch (const EvaluatorException& exception) {
+			completion->status = RESPONSE_INVALID;
+			completion->text = exception.what();
+		}
+		// Anything else, such as std::bad_alloc on a huge request, fails only this request, not the whole server
+		catch (const std::exception& exception) {
+			completion->status = RESPONSE_INVALID;
+			completion->text = std::string("Could not integrate: ") + exception.what();
+		}
+		arena.reset();
+		delete job;
+
+		bool wasEmpty;
+		{
+			std::lock_guard<std::mutex> lock(completionMutex);
+			wasEmpty = completions.empty();
+			completions.push_back(completion);
+		}
+		// One wake-up per batch of completions is enough; the event loop drains them all
+		if (wasEmpty) {
+#ifdef __linux__
+			unsigned long long one = 1;
+			ssize_t ignored = write(wakeDescriptor, &one, sizeof(one));
+			(void)ignored;
+#endif
+		}
+	}
+}
+
+#ifdef __linux__
+
+static bool setNonBlocking(int descriptor) {
+	int flags = fcntl(descriptor, F_GETFL, 0);
+	return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+Server::~Server() {
+	for (std::map<unsigned long long, Connection*>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		close(it->second->descriptor);
+		delete it->second;
+	}
+	if (listenDescriptor >= 0) close(listenDescriptor);
+	if (epollDescriptor >= 0) close(epollDescriptor);
+	if (wakeDescriptor >= 0) close(wakeDescriptor);
+	if (!socketPath.empty()) unlink(socketPath.c_str());
+	for (size_t i = 0; i < jobs.size(); i++) delete jobs[i];
+	for (size_t i = 0; i < completions.size(); i++) delete completions[i];
+}
+
+bool Server::listen(const std::string& endpoint, std::ostream& report) {
+	bool isPort = !endpoint.empty() && endpoint.find_first_not_of("0123456789") == std::string::npos;
+
+	if (isPort) {
+		listenDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		int reuse = 1;
+		setsockopt(listenDescriptor, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons((unsigned short)atoi(endpoint.c_str()));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local clients only
+		if (listenDescriptor < 0 || bind(listenDescriptor, (sockaddr*)&address, sizeof(address)) != 0) {
+			report << "Could not bind 127.0.0.1:" << endpoint << ": " << strerror(errno) << "\n";
+			return false;
+		}
+	}
+	else {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (endpoint.size() >= sizeof(address.sun_path)) {
+			report << "Socket path \"" << endpoint << "\" is too long\n";
+			return false;
+		}
+		strcpy(address.sun_path, endpoint.c_str());
+
+		listenDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+		unlink(endpoint.c_str()); // A socket file left by an earlier run would make bind fail
+		if (listenDescriptor < 0 || bind(listenDescriptor, (sockaddr*)&address, sizeof(address)) != 0) {
+			report << "Could not bind \"" << endpoint << "\": " << strerror(errno) << "\n";
+			return false;
+		}
+		socketPath = endpoint;
+	}
+
+	if (::listen(listenDescriptor, SOMAXCONN) != 0 || !setNonBlocking(listenDescriptor)) {
+		report << "Could not listen on \"" << endpoint << "\": " << strerror(errno) << "\n";
+		return false;
+	}
+
+	epollDescriptor = epoll_create1(0);
+	wakeDescriptor = eventfd(0, EFD_NONBLOCK);
+	if (epollDescriptor < 0 || wakeDescriptor < 0) {
+		report << "Could not set up the event loop: " << strerror(errno) << "\n";
+		return false;
+	}
+
+	// Connections are registered under their id, which starts at 1, so 0 and ~0 are free to mark the listener and the eventfd
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u64 = 0;
+	epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, listenDescriptor, &event);
+	event.data.u64 = ~0ULL;
+	epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeDescriptor, &event);
+
+	report << "Listening on " << (isPort ? "127.0.0.1:" : "") << endpoint << "\n";
+	return true;
+}
+
+void Server::run() {
+	unsigned int count = workerCount;
+	if (count == 0) {
+		count = std::thread::hardware_concurrency();
+		if (count == 0) count = 1;
+	}
+	workersStopping = false;
+	for (unsigned int i = 0; i < count; i++) {
+		workers.push_back(std::thread(&Server::worker, this));
+	}
+
+	epoll_event events[MAX_EVENTS];
+	while (!stopping) {
+		int ready = epoll_wait(epollDescriptor, events, MAX_EVENTS, -1);
+		if (ready < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		for (int i = 0; i < ready; i++) {
+			unsigned long long tag = events[i].data.u64;
+			if (tag == 0) {
+				acceptConnections();
+			}
+			else if (tag == ~0ULL) {
+				unsigned long long drained;
+				ssize_t ignored = read(wakeDescriptor, &drained, sizeof(drained));
+				(void)ignored;
+				handleCompletions();
+			}
+			else {
+				// The connection may already have been closed by an earlier event in this batch
+				std::map<unsigned long long, Connection*>::iterator it = connections.find(tag);
+				if (it == connections.end()) continue;
+				Connection* connection = it->second;
+
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+					closeConnection(connection);
+					continue;
+				}
+				if (events[i].events & EPOLLIN) {
+					readConnection(connection);
+				}
+				if (connections.count(tag) != 0 && (events[i].events & EPOLLOUT)) {
+					writeConnection(connection);
+				}
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		workersStopping = true;
+	}
+	jobAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void Server::stop() {
+	stopping = true;
+	if (wakeDescriptor >= 0) {
+		unsigned long long one = 1;
+		ssize_t ignored = write(wakeDescriptor, &one, sizeof(one));
+		(void)ignored;
+	}
+}
+
+void Server::acceptConnections() {
+	while (true) {
+		int descriptor = accept(listenDescriptor, NULL, NULL);
+		if (descriptor < 0) {
+			return; // EAGAIN once the backlog is empty; other errors are the client's problem
+		}
+		setNonBlocking(descriptor);
+		int noDelay = 1;
+		setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Fails harmlessly on Unix sockets
+
+		Connection* connection = new Connection;
+		connection->descriptor = descriptor;
+		connection->id = nextConnectionId++;
+		connection->outputSent = 0;
+		connection->nextSequence = 0;
+		connection->nextToSend = 0;
+		connection->peerClosed = false;
+		connection->interest = EPOLLIN;
+		connections[connection->id] = connection;
+
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.u64 = connection->id;
+		epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, descriptor, &event);
+	}
+}
+
+// Reads whatever has arrived and turns every complete frame into a job
+void Server::readConnection(Connection* connection) {
+	char buffer[16384];
+	while (true) {
+		ssize_t received = read(connection->descriptor, buffer, sizeof(buffer));
+		if (received > 0) {
+			connection->input.append(buffer, (size_t)received);
+			if (received < (ssize_t)sizeof(buffer)) break;
+		}
+		else if (received == 0) {
+			connection->peerClosed = true;
+			break;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			break;
+		}
+		else if (errno != EINTR) {
+			closeConnection(connection);
+			return;
+		}
+	}
+
+	size_t consumed = 0;
+	std::vector<Job*> newJobs;
+	Clock::time_point now = Clock::now();
+	while (connection->input.size() - consumed >= 4) {
+		const unsigned char* header = (const unsigned char*)connection->input.data() + consumed;
+		size_t length = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+		if (length > MAX_REQUEST_BYTES) {
+			closeConnection(connection);
+			return;
+		}
+		if (connection->input.size() - consumed - 4 < length) {
+			break;
+		}
+
+		std::string request = connection->input.substr(consumed + 4, length);
+		consumed += 4 + length;
+		unsigned long long sequence = connection->nextSequence++;
+
+		// Stats requests are answered by the event loop itself, in pipeline order, so that they include every
+		// request sent ahead of them on the connection
+		if (request == "!stats" || request == "!stats json") {
+			connection->statsRequests[sequence] = request;
+			continue;
+		}
+
+		Job* job = new Job;
+		job->connectionId = connection->id;
+		job->sequence = sequence;
+		job->request.swap(request);
+		job->received = now;
+		newJobs.push_back(job);
+	}
+	connection->input.erase(0, consumed);
+
+	if (!newJobs.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			jobs.insert(jobs.end(), newJobs.begin(), newJobs.end());
+		}
+		if (newJobs.size() == 1) jobAvailable.notify_one();
+		else jobAvailable.notify_all();
+	}
+
+	flushResponses(connection); // Sends any stats replies that are now in turn
+}
+
+void Server::handleCompletions() {
+	std::vector<Completion*> done;
+	{
+		std::lock_guard<std::mutex> lock(completionMutex);
+		done.swap(completions);
+	}
+
+	Clock::time_point now = Clock::now();
+	for (size_t i = 0; i < done.size(); i++) {
+		Completion* completion = done[i];
+		latency.record((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(now - completion->received).count());
+
+		std::map<unsigned long long, Connection*>::iterator it = connections.find(completion->connectionId);
+		if (it != connections.end()) {
+			PhaseTimer timer(phaseFormat);
+			std::string frame;
+			appendFrame(frame, completion->status, completion->text);
+			it->second->finished[completion->sequence] = frame;
+		}
+		delete completion;
+	}
+
+	// Move every response that is now in order into its connection's output and start writing
+	std::vector<Connection*> touched;
+	for (std::map<unsigned long long, Connection*>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		if (!it->second->finished.empty()) touched.push_back(it->second);
+	}
+	for (size_t i = 0; i < touched.size(); i++) {
+		flushResponses(touched[i]);
+	}
+}
+
+// Moves finished responses that are next in pipeline order into the output buffer and writes what it can
+// A stats request is answered when its turn comes, after every request ahead of it has been answered and counted
+void Server::flushResponses(Connection* connection) {
+	while (true) {
+		std::map<unsigned long long, std::string>::iterator it = connection->finished.begin();
+		std::map<unsigned long long, std::string>::iterator stats = connection->statsRequests.begin();
+		if (it != connection->finished.end() && it->first == connection->nextToSend) {
+			connection->output += it->second;
+			connection->finished.erase(it);
+		}
+		else if (stats != connection->statsRequests.end() && stats->first == connection->nextToSend) {
+			if (stats->second == "!stats") {
+				std::stringstream symbols;
+				symbols << "symbols " << SymbolTable::size() << " of " << MAX_SYMBOLS << "\n";
+				appendFrame(connection->output, RESPONSE_OK, latencyReport() + "\n" + symbols.str() + Stats::collect().toText());
+			}
+			else {
+				appendFrame(connection->output, RESPONSE_OK, Stats::collect().toJson());
+			}
+			connection->statsRequests.erase(stats);
+		}
+		else {
+			break;
+		}
+		connection->nextToSend++;
+	}
+	writeConnection(connection);
+}
+
+void Server::writeConnection(Connection* connection) {
+	while (connection->outputSent < connection->output.size()) {
+		// MSG_NOSIGNAL: a client that hangs up early must not kill the server with SIGPIPE
+		ssize_t sent = send(connection->descriptor, connection->output.data() + connection->outputSent, connection->output.size() - connection->outputSent, MSG_NOSIGNAL);
+		if (sent > 0) {
+			connection->outputSent += (size_t)sent;
+		}
+		else if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		else {
+			closeConnection(connection);
+			return;
+		}
+	}
+	if (connection->outputSent == connection->output.size()) {
+		connection->output.clear();
+		connection->outputSent = 0;
+	}
+
+	// A client that has stopped sending is closed once every response it asked for has gone out
+	if (connection->peerClosed && connection->nextToSend == connection->nextSequence && connection->output.empty()) {
+		closeConnection(connection);
+		return;
+	}
+	updateInterest(connection);
+}
+
+// Only ask for readability while the client has room in its pipeline, and for writability while output is pending
+void Server::updateInterest(Connection* connection) {
+	unsigned int interest = 0;
+	if (!connection->peerClosed && connection->nextSequence - connection->nextToSend < MAX_PIPELINED_REQUESTS) {
+		interest |= EPOLLIN;
+	}
+	if (!connection->output.empty()) {
+		interest |= EPOLLOUT;
+	}
+	if (interest != connection->interest) {
+		epoll_event event;
+		event.events = interest;
+		event.data.u64 = connection->id;
+		epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, connection->descriptor, &event);
+		connection->interest = interest;
+	}
+}
+
+// Responses still being computed for this connection are dropped when they complete
+void Server::closeConnection(Connection* connection) {
+	epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, connection->descriptor, NULL);
+	close(connection->descriptor);
+	connections.erase(connection->id);
+	delete connection;
+}
+
+#else
+
+Server::~Server() {
+}
+
+bool Server::listen(const std::string& endpoint, std::ostream& report) {
+	report << "Server mode is only available on Linux; cannot listen on \"" << endpoint << "\"\n";
+	return false;
+}
+
+void Server::run() {
+}
+
+void Server::stop() {
+	stopping = true;
+}
+
+void Server::acceptConnections() {
+}
+
+void Server::readConnection(Connection* connection) {
+}
+
+void Server::writeConnection(Connection* connection) {
+}
+
+void Server::handleCompletions() {
+}
+
+void Server::flushResponses(Connection* connection) {
+}
+
+void Server::updateInterest(Connection* connection) {
+}
+
+void Server::closeConnection(Connection* connection) {
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+* Declares a Server class that answers integration requests over a local socket, so that a service can keep one
+* SCALP process running instead of starting the interactive program for every request.
+*
+* The server listens on a Unix domain socket or on a TCP port bound to 127.0.0.1. A single thread runs an epoll
+* event loop that does all socket I/O; parsing and integration happen on a pool of worker threads, each with its
+* own Interpreter, Parser, NodeArena and Integrator. Server mode is only available on Linux.
+*
+* Protocol: every message in either direction is a frame made of a 4-byte big-endian length followed by that many
+* bytes. A request frame holds the integrand as text. A response frame holds a status byte (RESPONSE_OK,
+* RESPONSE_INVALID or RESPONSE_BUDGET_EXCEEDED) followed by the result text. Clients may pipeline: any number of
+* requests can be sent without waiting, and responses always come back in the order the requests were sent on that
+* connection.
+* Each request runs under a Budget (see budget.h) set with setBudget(); one that runs out is answered with
+* RESPONSE_BUDGET_EXCEEDED and the limit that was passed, and the worker moves on to the next request. Any other
+* failure of a request, such as running out of memory, is answered with RESPONSE_INVALID and never stops the server.
+* The request "!stats" is answered with the server's latency percentiles, how full the SymbolTable is and the
+* pipeline stats (see stats.h) instead of an integral, and "!stats json" with the pipeline stats as JSON.
+* Variable names are interned for the life of the process, so once MAX_SYMBOLS distinct names have been seen,
+* requests that use a new multi-letter name are answered RESPONSE_INVALID until the server restarts (see symbols.h).
+*
+*  Sample usage:
+*   Server server;
+*   server.setWorkers(8);
+*   if (server.listen("/tmp/scalp.sock", std::cerr)) server.run();
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_SERVER_H_
+#define SCALP_SERVER_H_
+
+#include "budget.h"
+#include "latency.h"
+#include "ruleorder.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ResultCache;
+
+const unsigned char RESPONSE_OK = 0;
+const unsigned char RESPONSE_INVALID = 1;
+const unsigned char RESPONSE_BUDGET_EXCEEDED = 2;
+
+// Largest request the server will accept; a bigger length prefix closes the connection
+const size_t MAX_REQUEST_BYTES = 1024 * 1024;
+
+class Server
+{
+	struct Connection;
+	struct Job;
+	struct Completion;
+
+	unsigned int workerCount;
+	ResultCache* cache;
+	BudgetLimits budget;
+	RuleOrder ruleOrder;
+
+	int listenDescriptor;
+	int epollDescriptor;
+	int wakeDescriptor;
+	std::string socketPath; // Unlinked on shutdown when listening on a Unix domain socket
+	std::atomic<bool> stopping;
+
+	std::map<unsigned long long, Connection*> connections;
+	unsigned long long nextConnectionId;
+
+	// Requests waiting for a worker
+	std::deque<Job*> jobs;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	bool workersStopping;
+	std::vector<std::thread> workers;
+
+	// Results waiting for the event loop
+	std::vector<Completion*> completions;
+	std::mutex completionMutex;
+
+	// Request latency from the moment a request is complete until its response is queued; event loop thread only
+	LatencyHistogram latency;
+
+	void worker();
+	void acceptConnections();
+	void readConnection(Connection* connection);
+	void writeConnection(Connection* connection);
+	void handleCompletions();
+	void updateInterest(Connection* connection);
+	void closeConnection(Connection* connection);
+	void flushResponses(Connection* connection);
+
+public:
+	Server();
+	~Server();
+
+	// Number of integration worker threads; 0 (the default) means one per hardware thread
+	void setWorkers(unsigned int t_workerCount);
+
+	// Optional shared persistent cache; NULL to disable
+	void setCache(ResultCache* t_cache);
+
+	// Limits for each request; by default there are none
+	void setBudget(const BudgetLimits& t_budget);
+
+	// Order in which workers try the integrator's table rules (see ruleorder.h); set before run()
+	void setRuleOrder(const RuleOrder& t_ruleOrder);
+
+	// Starts listening on endpoint: a number is a TCP port on 127.0.0.1, anything else is a Unix domain socket path
+	// Problems are described on report; returns false if the server cannot listen
+	bool listen(const std::string& endpoint, std::ostream& report);
+
+	// Runs the event loop until stop() is called
+	void run();
+
+	// Makes run() return; safe to call from a signal handler or another thread
+	void stop();
+
+	// The same text a client receives for "!stats"
+	std::string latencyReport() const;
+};
+
+#endif // SCALP_SERVER_H_
@@ -2,16 +2,44 @@
 * Implements the Tester class in test.h
 */
 
+#include "arena.h"
+#include "builder.h"
+#include "compiledfunction.h"
+#include "evaluator.h"
+#include "formatter.h"
 #include "interpreter.h"
 #include "parser.h"
+#include "scalp.h"
 #include "tester.h"
+#include "serializer.h"
+#include "stats.h"
+#include "symbols.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
 #include <sstream>
 
 const bool OUTPUT_AST_TREE = true;
 std::string astTypes[17] = { "UNDEF", "+", "-", "*", "/", "^", "-()", "NUM", "VAR", "sin()", "cos()", "tan()", "sec()", "csc()", "cot()", "log()", "ln()" };
-Interpreter interpreter;
+
+// Constructor
+Tester::Tester() {
+	this->cache = NULL;
+	this->shareOutput = false;
+}
+
+void Tester::setCache(ResultCache* t_cache) {
+	this->cache = t_cache;
+}
+
+void Tester::setShareOutput(bool t_shareOutput) {
+	this->shareOutput = t_shareOutput;
+}
 
 // Outputs a graphical representation of a horizontal AST tree to console
 void Tester::outputGraphicalAST(ASTNode* ast){
@@ -46,7 +74,7 @@ void Tester::generateGraphicalAST(std::vector<std::string>& nodes, ASTNode* ast,
 			std::stringstream sstr; 
 			for (int i = 0; i < t_maxIndent; i++) sstr << " ";
 			if (t_level != 0) sstr << "\\";
-			sstr << "[" << ast->var << "]";
+			sstr << "[" << SymbolTable::name(ast->symbol) << "]";
 			nodes.insert(nodes.begin() + t_vecPos, sstr.str());
 			maxIndent = sstr.str().length();
 		}
@@ -73,7 +101,7 @@ void Tester::generateGraphicalAST(std::vector<std::string>& nodes, ASTNode* ast,
 			std::stringstream sstr; 
 			for (int i = 0; i < t_maxIndent; i++) sstr << " ";
 			if (t_level != 0) sstr << "/";
-			sstr << "[" << ast->var << "]";
+			sstr << "[" << SymbolTable::name(ast->symbol) << "]";
 			nodes.insert(nodes.begin() + t_vecPos, sstr.str());
 			maxIndent = sstr.str().length();
 		}
@@ -99,7 +127,7 @@ void Tester::generateGraphicalAST(std::vector<std::string>& nodes, ASTNode* ast,
 // Outputs a representation of an AST tree to console
 void Tester::outputDetailedAST(ASTNode* ast, int t_level) {
 	int level = t_level + 1;
-	std::cout << ast << ":[" << astTypes[ast->type] << "]-[" << ast->value << "]-[" << ast->var << "]-[" << ast->left << "]-[" << ast->right << "]\n";
+	std::cout << ast << ":[" << astTypes[ast->type] << "]-[" << ast->value << "]-[" << ((ast->type == variableChar) ? SymbolTable::name(ast->symbol) : "") << "]-[" << ast->left << "]-[" << ast->right << "]\n";
 
 	if (ast->left != NULL) {
 		for (int i = 0; i < level; i++) { std::cout << " "; }
@@ -118,7 +146,7 @@ void Tester::outputAST(ASTNode* ast, int t_level) {
 		std::cout << " [" << ast->value << "]\n";
 	}
 	else if (astTypes[ast->type] == "VAR") {
-		std::cout << " [" << ast->var << "]\n";
+		std::cout << " [" << SymbolTable::name(ast->symbol) << "]\n";
 	}
 	else {
 		std::cout << " [" << astTypes[ast->type] << "]\n";
@@ -151,7 +179,7 @@ void Tester::test(char input[]) {
 	ASTNode* ast = NULL; // It's good practice to always initialize pointers to NULL (or so folks on the internet say)
 	char text[42]; // Picked 42 as an arbitrary number; could be extended later on to accomodate longer equations
 
-	strcpy_s(text, input); // Copies the input char array into an explicitly defined one so that it can be modified
+	snprintf(text, sizeof(text), "%s", input); // Copies the input char array into an explicitly defined one so that it can be modified
 	interpreter.interpret(text); // Directly modifies the text array to take out whitespace, add '*', etc.
 
 	// Main try/catch block that processes each equation
@@ -169,8 +197,8 @@ void Tester::test(char input[]) {
 	}
 }
 
-// Attempts to integrate the expression given, outputs "INVALID" to console if invalid
-void Tester::test1(char input[], bool outputInput = false) {
+// Attempts to integrate the expression given with respect to variable, outputs "INVALID" to console if invalid
+void Tester::test1(char input[], bool outputInput = false, const char* variable = "x") {
 	int size = interpreter.getSize(input);
 
 	if (outputInput) {
@@ -185,20 +213,183 @@ void Tester::test1(char input[], bool outputInput = false) {
 	ASTNode* ast = NULL; // It's good practice to always initialize pointers to NULL (or so folks on the internet say)
 	char text[42]; // Picked 42 as an arbitrary number; could be extended later on to accomodate longer equations
 
-	strcpy_s(text, input); // Copies the input char array into an explicitly defined one so that it can be modified
+	snprintf(text, sizeof(text), "%s", input); // Copies the input char array into an explicitly defined one so that it can be modified
 	interpreter.interpret(text); // Directly modifies the text array to take out whitespace, add '*', etc.
 
 	std::string solution; Integrator integrator;
+	integrator.setCache(cache);
 
 	try {
 		ASTNode* ast = parser.parse(text);
 		//outputGraphicalAST(ast);
-		solution = integrator.integrate(ast);
-		std::cout << "Output: int(" << text << ")dx = " << solution << "\n\n";
+		solution = integrator.integrate(ast, SymbolTable::intern(variable));
+		PhaseTimer timer(phaseFormat);
+		std::cout << "Output: int(" << text << ")d" << variable << " = " << solution << "\n\n";
+		if (shareOutput && solution.find("ERROR") == std::string::npos) {
+			std::cout << "Shared: " << Scalp::share(solution) << "\n\n";
+		}
 	}
 	catch (ParserException& exception1) {
-		std::cout << "Output: int(" << text << ")dx ->" << "  INVALID: " << exception1.what() << "\n\n";
+		std::cout << "Output: int(" << text << ")d" << variable << " ->" << "  INVALID: " << exception1.what() << "\n\n";
+	}
+}
+
+////////////// GOLDEN CORPUS ////////////////
+
+// Runs one corpus case through the pipeline and returns its answer in the form the corpus stores
+static std::string runCorpusCase(const std::string& mode, const std::string& input, Parser& parser, NodeArena& arena) {
+	// interpret() edits in place and may insert one '*' per character, so leave room for twice the input
+	std::vector<char> text(2 * input.size() + 4, 0);
+	input.copy(&text[0], input.size());
+	Interpreter interpreter;
+	interpreter.interpret(&text[0]);
+
+	arena.reset();
+	try {
+		ASTNode* ast = parser.parse(&text[0]);
+		if (mode == "parse") {
+			Formatter formatter;
+			return formatter.format(ast);
+		}
+		else if (mode == "shared") {
+			Formatter formatter;
+			return formatter.formatShared(ast);
+		}
+		else if (mode == "integrate") {
+			Integrator integrator;
+			return integrator.integrate(ast);
+		}
+		else if (mode.compare(0, 10, "integrate:") == 0) {
+			Integrator integrator;
+			return integrator.integrate(ast, SymbolTable::intern(mode.substr(10)));
+		}
+		else if (mode.compare(0, 9, "definite:") == 0) {
+			// Twelve digits, so that the last bits of a numerical answer do not make the case fail
+			char* separator = NULL;
+			double lower = strtod(mode.c_str() + 9, &separator);
+			double upper = strtod(separator + 1, NULL);
+			Integrator integrator;
+			char number[32];
+			snprintf(number, sizeof(number), "%.12g", integrator.integrateDefinite(ast, SymbolTable::letter('x'), lower, upper).value);
+			return number;
+		}
+		else {
+			// NaN is printed with a sign (and more) on some platforms, so it is written out here
+			Evaluator evaluator;
+			double value = evaluator.evaluate(ast);
+			char number[32];
+			snprintf(number, sizeof(number), "%.15g", value);
+			return std::isnan(value) ? "nan" : number;
+		}
+	}
+	catch (const ParserException&) {
+		return "INVALID";
+	}
+	catch (const EvaluatorException&) {
+		return "INVALID";
+	}
+}
+
+// Returns the fastest of five timed batches, in nanoseconds per run; the minimum is the measurement least disturbed
+// by whatever else the machine is doing
+static double timeCorpusCase(const std::string& mode, const std::string& input, Parser& parser, NodeArena& arena) {
+	typedef std::chrono::steady_clock Clock;
+	int repetitions = 1;
+	double best = 0;
+	for (int batch = 0; batch < 5; batch++) {
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < repetitions; i++) {
+			runCorpusCase(mode, input, parser, arena);
+		}
+		double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		// Grow the batch until it takes at least a millisecond before counting it
+		if (nanoseconds < 1e6 && repetitions < (1 << 16)) {
+			repetitions *= 4;
+			batch--;
+			continue;
+		}
+		double perRun = nanoseconds / repetitions;
+		if (batch == 0 || perRun < best) best = perRun;
+	}
+	return best;
+}
+
+int Tester::runCorpus(const std::string& corpusPath, const std::string& baselinePath, double tolerance, bool updateBaseline, std::ostream& report) {
+	std::ifstream corpus(corpusPath.c_str());
+	if (!corpus) {
+		report << "Could not open corpus \"" << corpusPath << "\"\n";
+		return 1;
+	}
+
+	std::map<std::string, double> baseline;
+	if (!baselinePath.empty() && !updateBaseline) {
+		std::ifstream baselineFile(baselinePath.c_str());
+		std::string line;
+		while (std::getline(baselineFile, line)) {
+			size_t tab = line.rfind('\t');
+			if (tab == std::string::npos) continue;
+			baseline[line.substr(0, tab)] = atof(line.c_str() + tab + 1);
+		}
+	}
+
+	Parser parser; NodeArena arena;
+	parser.setArena(&arena); // Trees are thrown away after every run, so nothing is deleted (or leaked)
+
+	std::stringstream newBaseline;
+	int cases = 0, wrong = 0, overBudget = 0, regressions = 0;
+	std::string line;
+	while (std::getline(corpus, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#') continue;
+
+		std::vector<std::string> fields;
+		std::stringstream sstr(line);
+		std::string field;
+		while (std::getline(sstr, field, '\t')) fields.push_back(field);
+		if (fields.size() != 4 || (fields[0] != "parse" && fields[0] != "shared" && fields[0] != "integrate" && fields[0].compare(0, 10, "integrate:") != 0 && fields[0].compare(0, 9, "definite:") != 0 && fields[0] != "evaluate")) {
+			report << "Skipping malformed corpus line: " << line << "\n";
+			continue;
+		}
+		const std::string& mode = fields[0];
+		const std::string& input = fields[1];
+		const std::string& expected = fields[2];
+		double budget = atof(fields[3].c_str()) * 1000;
+		cases++;
+
+		std::string actual = runCorpusCase(mode, input, parser, arena);
+		if (actual != expected) {
+			report << "FAIL " << mode << " \"" << input << "\": expected \"" << expected << "\", got \"" << actual << "\"\n";
+			wrong++;
+		}
+
+		double nanoseconds = timeCorpusCase(mode, input, parser, arena);
+		if (nanoseconds > budget) {
+			report << "SLOW " << mode << " \"" << input << "\": " << nanoseconds / 1000 << "us, budget " << budget / 1000 << "us\n";
+			overBudget++;
+		}
+
+		std::string key = mode + "\t" + input;
+		newBaseline << key << "\t" << nanoseconds << "\n";
+		std::map<std::string, double>::iterator old = baseline.find(key);
+		if (old != baseline.end() && old->second > 0 && nanoseconds > old->second * (1 + tolerance)) {
+			report << "REGRESSION " << mode << " \"" << input << "\": " << nanoseconds / 1000 << "us vs baseline " << old->second / 1000
+				<< "us (+" << (nanoseconds / old->second - 1) * 100 << "%)\n";
+			regressions++;
+		}
+	}
+
+	if (updateBaseline && !baselinePath.empty()) {
+		std::ofstream baselineFile(baselinePath.c_str(), std::ios::trunc);
+		baselineFile << newBaseline.str();
+		if (!baselineFile) {
+			report << "Could not write baseline \"" << baselinePath << "\"\n";
+			return 1;
+		}
 	}
+
+	report << "Corpus: " << cases << " cases, " << wrong << " wrong answers, " << overBudget << " over budget, " << regressions << " regressions\n";
+	return wrong + overBudget + regressions;
 }
 
 ////////////// TEST SUITES ////////////////
@@ -210,6 +401,171 @@ void Tester::testIntergationI() {
 	test1("x^99999 + 1/x + x");
 	//test1("hung, it's not nice to kill someone");
 }
+
+// Integrates a few expressions between bounds, by antiderivative where there is one and numerically otherwise
+void Tester::testDefinite() {
+	struct { const char* input; double lower; double upper; } cases[] = {
+		{ "x^2", 0, 1 }, { "cos(x)", 0, 1 }, { "1/x", 1, 2.718281828459045 }, { "1/x", -2, -1 },
+		{ "sin(x)", 0, 3.141592653589793 }, { "x*cos(x)", 0, 1 }, { "2.5x", 0, 2 }
+	};
+
+	Integrator integrator; Parser parser;
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		char text[42];
+		snprintf(text, sizeof(text), "%s", cases[i].input);
+		interpreter.interpret(text);
+		try {
+			ASTNode* ast = parser.parse(text);
+			DefiniteIntegral result = integrator.integrateDefinite(ast, SymbolTable::letter('x'), cases[i].lower, cases[i].upper);
+			std::cout << "Output: int(" << text << ")dx from " << cases[i].lower << " to " << cases[i].upper << " = " << result.value;
+			if (result.symbolic) {
+				std::cout << " (from " << result.antiderivative << ")\n\n";
+			}
+			else {
+				std::cout << " (numerical, error " << result.error << (result.converged ? "" : ", not converged") << ")\n\n";
+			}
+			delete ast;
+		}
+		catch (const ParserException& exception) {
+			std::cout << "Output: int(" << text << ")dx ->" << "  INVALID: " << exception.what() << "\n\n";
+		}
+		catch (const EvaluatorException& exception) {
+			std::cout << "Output: int(" << text << ")dx ->" << "  INVALID: " << exception.what() << "\n\n";
+		}
+	}
+}
+
+// Interns names until the SymbolTable is full, then checks that new names are rejected while old ones still parse
+void Tester::testSymbolLimit() {
+	Parser parser;
+	char first[] = "v_0 + x";
+	interpreter.interpret(first);
+	delete parser.parse(first);
+
+	int added = 0;
+	while (SymbolTable::intern("v_" + std::to_string(added + 1)) >= 0) {
+		added++;
+	}
+	std::cout << "Table full after " << added << " more names; size " << SymbolTable::size() << " of " << MAX_SYMBOLS << "\n\n";
+
+	const char* inputs[] = { "v_0 + x", "v_1 * y", "w_new + x", "a + B" };
+	const bool valid[] = { true, true, false, true };
+	for (int i = 0; i < 4; i++) {
+		char text[42];
+		snprintf(text, sizeof(text), "%s", inputs[i]);
+		interpreter.interpret(text);
+		bool parsed = true;
+		try {
+			delete parser.parse(text);
+		}
+		catch (const ParserException&) {
+			parsed = false;
+		}
+		std::cout << "Input: \"" << inputs[i] << "\"\nResult: " << (parsed == valid[i] ? "OK" : "MISMATCH") << " ("
+			<< (parsed ? "parsed" : "rejected") << ")\n\n";
+	}
+}
+
+// Builds expressions in code and checks each against the same expression parsed from text, at a sample point
+void Tester::testBuilder() {
+	Builder builder; Parser parser; Integrator integrator; Evaluator evaluator; Formatter formatter; NodeArena arena;
+	parser.setArena(&arena);
+	Expression x = builder.var("x"), y = builder.var("y");
+	struct { Expression built; const char* text; } cases[] = {
+		{ 3 * pow(x, 2) + 2 * x + 1, "3x^2 + 2x + 1" },
+		{ cos(x) * 1 + 0, "cos(x)" },
+		{ x * y / (5 + y), "x*y/(5+y)" },
+		{ 1 / x - pow(x, 4), "1/x - x^4" },
+		{ log(2, x * x) + sin(2 * 3 * x), "log(2, x*x) + sin(6*x)" },
+		{ pow(x, -1) + 3 * pow(x, -2), "1/x + 3/x^2" }
+	};
+
+	evaluator.bind(x.symbol(), 0.7);
+	evaluator.bind(y.symbol(), -1.5);
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		char text[42];
+		snprintf(text, sizeof(text), "%s", cases[i].text);
+		interpreter.interpret(text);
+		ASTNode* parsed = parser.parse(text);
+		ASTNode* built = cases[i].built.ast();
+		bool same = fabs(evaluator.evaluate(parsed) - evaluator.evaluate(built)) < 1e-12;
+		std::cout << "Input: \"" << cases[i].text << "\"\nBuilt: " << formatter.format(built) << "\nResult: " << (same ? "SAME VALUE" : "VALUE MISMATCH") << "\nOutput: int(" << cases[i].text << ")dx = " << integrator.integrate(built) << " + C\n\n";
+	}
+	builder.reset();
+	arena.reset();
+}
+
+// Compiles a few expressions and checks them against the Evaluator at a handful of points, one at a time and batched
+void Tester::testCompiled() {
+	const char* inputs[] = { "3x^2 + 2x + 1", "sin(x)/x - log(2, x)", "x*y - (5 + y)^3", "-cos(x)^2 + sec(2*x)", "x^x + 4*7", "sin(x^2)*cos(x^2) + x^2" };
+	const double points[] = { 0.5, 1.25, 2, 3.5, -0.75 };
+	const size_t count = sizeof(points) / sizeof(points[0]);
+
+	Parser parser; Evaluator evaluator; NodeArena arena;
+	parser.setArena(&arena);
+	int x = SymbolTable::letter('x');
+	evaluator.bind(SymbolTable::letter('y'), -1.5);
+	for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+		char text[42];
+		snprintf(text, sizeof(text), "%s", inputs[i]);
+		interpreter.interpret(text);
+		ASTNode* ast = parser.parse(text);
+		CompiledFunction compiled(ast, x, evaluator);
+
+		double batched[count];
+		compiled.evaluateBatch(points, batched, count);
+		bool same = true;
+		for (size_t k = 0; k < count; k++) {
+			evaluator.bind(x, points[k]);
+			double expected = evaluator.evaluate(ast);
+			same = same && (fabs(compiled.evaluate(points[k]) - expected) <= 1e-12 * fabs(expected) || (std::isnan(expected) && std::isnan(batched[k])));
+			same = same && (batched[k] == compiled.evaluate(points[k]) || std::isnan(batched[k]));
+		}
+		std::cout << "Input: \"" << inputs[i] << "\"\nSteps: " << compiled.size() << "\nResult: " << (same ? "SAME VALUE" : "VALUE MISMATCH") << "\n\n";
+	}
+	arena.reset();
+}
+
+void Tester::testMultivariate() {
+	test1("5Xy", true, "x");
+	test1("5Xy", true, "y");
+	test1("x^2 + y", true, "y");
+	test1("3x + sin(y)", true, "x");
+	test1("x_1^3 + x_2", true, "x_1");
+	test1("v_max * t / k", true, "t");
+}
+// Returns true if both trees have the same shape and the same node contents
+static bool sameAST(ASTNode* a, ASTNode* b) {
+	if (a == NULL || b == NULL) return a == b;
+	return a->type == b->type && a->value == b->value && a->symbol == b->symbol && sameAST(a->left, b->left) && sameAST(a->right, b->right);
+}
+
+// Round-trips a few parsed expressions through the binary AST format and reports whether each one survived intact
+void Tester::testSerialization() {
+	const char* inputs[] = { "5x^3 - 10x^6 + 4", "log(5, x)", "sin(x + 5)", "-300 + (-3.0554) * 141292", "x/(5+H)", "v_max * t_0" };
+	const int count = sizeof(inputs) / sizeof(inputs[0]);
+
+	Parser parser; ASTWriter writer; ASTNode* asts[count];
+	for (int i = 0; i < count; i++) {
+		char text[42];
+		snprintf(text, sizeof(text), "%s", inputs[i]);
+		interpreter.interpret(text);
+		asts[i] = parser.parse(text);
+		writer.add(asts[i]);
+	}
+
+	std::vector<unsigned char> bytes = writer.finish();
+	ASTImage image(&bytes[0], bytes.size());
+	std::cout << "Image holds " << image.rootCount() << " expressions in " << bytes.size() << " bytes\n\n";
+
+	for (int i = 0; i < count; i++) {
+		ASTNode* loaded = image.materialize(i);
+		std::cout << "Input: \"" << inputs[i] << "\"\nResult: " << (sameAST(asts[i], loaded) ? "ROUND TRIP OK" : "ROUND TRIP MISMATCH") << "\n\n";
+		delete loaded;
+		delete asts[i];
+	}
+}
+
 void Tester::testArithmetic(){
 	std::cout << "These should be valid:\n\n";
 
@@ -9,19 +9,53 @@
 
 #include "ast.h"
 #include "integrator.h"
+#include "interpreter.h"
+#include <iostream>
+#include <string>
 #include <vector>
 
+class ResultCache;
+
 class Tester {
+	// Optional persistent cache handed to the integrator by test1(); NULL when disabled
+	ResultCache* cache;
+
+	// Prepares the text of every test case for the parser
+	Interpreter interpreter;
+
+	// Whether test1() also prints its answer with repeated subterms named (see Formatter::formatShared)
+	bool shareOutput;
+
 public:
+	Tester();
+	void setCache(ResultCache* t_cache);
+	void setShareOutput(bool t_shareOutput);
+
 	void test(char input[]);
-	void test1(char input[], bool outputInput);
+	void test1(char input[], bool outputInput, const char* variable);
 	void outputAST(ASTNode* ast, int t_level);
 	void outputDetailedAST(ASTNode* ast, int t_level);
 	void outputGraphicalAST(ASTNode* ast);
 	void generateGraphicalAST(std::vector<std::string>& nodes, ASTNode* ast, int t_level, bool leftNode, int t_maxIndent, int t_vecPos);
 
+	// Runs every case of a golden corpus file and returns the number of failures (wrong answers, cases over their
+	// time budget, and cases slower than baselinePath by more than tolerance, e.g. 0.25 for 25%)
+	// Each line of the corpus is "mode<TAB>input<TAB>expected<TAB>budget in microseconds", where mode is parse
+	// (expected is the canonical AST text, see formatter.h), shared (the same with repeated subtrees named),
+	// integrate, integrate:<variable> (with respect to that variable instead of x), definite:<lower>:<upper> (with
+	// respect to x, to twelve digits) or evaluate; expected is INVALID for inputs that must be rejected. Lines starting with '#' are comments.
+	// The baseline holds "mode<TAB>input<TAB>nanoseconds" lines; with updateBaseline it is rewritten from this run
+	// instead of being compared against. An empty baselinePath skips the comparison.
+	int runCorpus(const std::string& corpusPath, const std::string& baselinePath, double tolerance, bool updateBaseline, std::ostream& report);
+
 	// Test suites II
 	void testIntergationI();
+	void testMultivariate();
+	void testDefinite();
+	void testBuilder();
+	void testCompiled();
+	void testSerialization();
+	void testSymbolLimit(); // Fills the process's SymbolTable; run it on its own
 
 	// Test suites I
 	void testArithmetic();
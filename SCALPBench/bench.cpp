@@ -0,0 +1,478 @@
+/*
+* Microbenchmarks for each phase of the SCALP pipeline: Interpreter::interpret, Parser::parse (including the simplify
+* passes), Integrator::integrate, Evaluator::evaluate and Integrator::integrateDefinite, on a few fixed inputs, on
+* inputs that grow in size (also built in code with the Builder, for comparison with parsing them), and on seeded
+* random expressions from ExpressionGenerator so that the scaling runs are not limited to one tree shape. The
+* sample/ runs evaluate an integrand at a batch of points the way quadrature does, through the Evaluator and through
+* a CompiledFunction. The stress/threads/N runs push the whole pipeline through libscalp from N threads at once.
+*
+* Every benchmark is run for at least --min-time seconds and reported as one JSON object per line:
+*   {"name":"parse/poly/100","iterations":1234,"ns_per_op":5678.9,"allocs_per_op":402,"nodes_per_op":401}
+* nodes_per_op is the size of the AST that the phase produced (parse) or worked on (integrate, evaluate).
+*
+* Command line options:
+*   --filter <text>      only run benchmarks whose name contains text
+*   --min-time <sec>     minimum measuring time per benchmark (default 0.2)
+*   --output <file>      write the JSON lines to file instead of standard output
+*   --compare <file>     compare against the JSON lines of an earlier run and print the change per benchmark
+*/
+
+#include "ast.h"
+#include "builder.h"
+#include "compiledfunction.h"
+#include "evaluator.h"
+#include "generator.h"
+#include "integrator.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scalp.h"
+#include "symbols.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////// Allocation counting ////////////////
+
+// Every heap allocation in the process goes through these replacements, so a benchmark can count its own
+// Each thread counts its own, so that counting does not make threads of the stress benchmarks contend on one counter;
+// worker threads add theirs to retiredAllocations before they finish
+thread_local unsigned long long threadAllocations = 0;
+std::atomic<unsigned long long> retiredAllocations(0);
+
+// Allocations made so far by the calling thread and by every worker that has finished
+static unsigned long long allocationCount() {
+	return retiredAllocations.load() + threadAllocations;
+}
+
+void* operator new(size_t size) {
+	threadAllocations++;
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == NULL) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* memory) throw() {
+	free(memory);
+}
+
+void operator delete[](void* memory) throw() {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) throw() {
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) throw() {
+	free(memory);
+}
+
+////////////// Inputs ////////////////
+
+static int countNodes(const ASTNode* ast) {
+	if (ast == NULL) return 0;
+	return 1 + countNodes(ast->left) + countNodes(ast->right);
+}
+
+// "1x^1 + 2x^2 + ... + nx^n": a polynomial the integrator handles term by term
+static std::string polynomial(int terms) {
+	std::stringstream sstr;
+	for (int i = 1; i <= terms; i++) {
+		if (i > 1) sstr << " + ";
+		sstr << i << "x^" << i;
+	}
+	return sstr.str();
+}
+
+// "1 + 2 + ... + n": a constant sum the evaluator can compute
+static std::string constantSum(int terms) {
+	std::stringstream sstr;
+	for (int i = 1; i <= terms; i++) {
+		if (i > 1) sstr << " + ";
+		sstr << i;
+	}
+	return sstr.str();
+}
+
+// A random expression of about size nodes; constant-only ones can also be evaluated
+static std::string randomExpression(int size, bool constantOnly) {
+	GeneratorOptions options;
+	options.seed = 2017 + size; // Fixed so that every run measures the same expressions
+	options.size = size;
+	options.maxDepth = 40;
+	if (constantOnly) {
+		options.variables = "";
+		options.setOperatorMix("+:4,-:2,*:3,/:1");
+		options.functionShare = 0;
+	}
+	ExpressionGenerator generator(options);
+	return generator.generate();
+}
+
+// A random polynomial-like expression in x with no division or functions, so it is defined on every interval
+static std::string smoothExpression(int size) {
+	GeneratorOptions options;
+	options.seed = 2017 + size;
+	options.size = size;
+	options.maxDepth = 40;
+	options.setOperatorMix("+:4,-:2,*:3");
+	options.functionShare = 0;
+	ExpressionGenerator generator(options);
+	return generator.generate();
+}
+
+// Runs the interpreter on a private copy of input, which needs room for the '*' characters it inserts
+static std::vector<char> interpreted(const std::string& input) {
+	std::vector<char> text(2 * input.size() + 4, 0);
+	memcpy(&text[0], input.data(), input.size());
+	Interpreter interpreter;
+	interpreter.interpret(&text[0]);
+	return text;
+}
+
+////////////// Benchmarks ////////////////
+
+struct Result {
+	std::string name;
+	unsigned long long iterations;
+	double nsPerOp;
+	double allocsPerOp;
+	double nodesPerOp;
+};
+
+// A benchmark runs its operation `iterations` times and returns the number of AST nodes involved in one run
+class Benchmark {
+public:
+	std::string name;
+	virtual ~Benchmark() {}
+	virtual int run(unsigned long long iterations) = 0;
+};
+
+class InterpretBenchmark : public Benchmark {
+	std::string input;
+	std::vector<char> buffer;
+public:
+	InterpretBenchmark(const std::string& t_name, const std::string& t_input) : input(t_input), buffer(2 * t_input.size() + 4, 0) { name = t_name; }
+	int run(unsigned long long iterations) {
+		Interpreter interpreter;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			memcpy(&buffer[0], input.c_str(), input.size() + 1);
+			interpreter.interpret(&buffer[0]);
+		}
+		return 0;
+	}
+};
+
+class ParseBenchmark : public Benchmark {
+	std::vector<char> text;
+public:
+	ParseBenchmark(const std::string& t_name, const std::string& input) : text(interpreted(input)) { name = t_name; }
+	int run(unsigned long long iterations) {
+		Parser parser; int nodes = 0;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			ASTNode* ast = parser.parse(&text[0]);
+			nodes = countNodes(ast);
+			delete ast;
+		}
+		return nodes;
+	}
+};
+
+// Builds polynomial(terms) with the Builder, the way code that already holds the expression would, instead of parsing it
+class BuildBenchmark : public Benchmark {
+	int terms;
+public:
+	BuildBenchmark(const std::string& t_name, int t_terms) : terms(t_terms) { name = t_name; }
+	int run(unsigned long long iterations) {
+		Builder builder; int nodes = 0;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			Expression x = builder.var(SymbolTable::letter('x'));
+			Expression sum = 1 * pow(x, 1);
+			for (int n = 2; n <= terms; n++) {
+				sum = sum + n * pow(x, n);
+			}
+			nodes = countNodes(sum.ast());
+			builder.reset();
+		}
+		return nodes;
+	}
+};
+
+class IntegrateBenchmark : public Benchmark {
+	ASTNode* ast;
+public:
+	IntegrateBenchmark(const std::string& t_name, const std::string& input) {
+		name = t_name;
+		std::vector<char> text = interpreted(input);
+		Parser parser;
+		ast = parser.parse(&text[0]);
+	}
+	~IntegrateBenchmark() { delete ast; }
+	int run(unsigned long long iterations) {
+		Integrator integrator; size_t length = 0;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			length += integrator.integrate(ast).size(); // Keeps the result observable so the call is not optimized away
+		}
+		return (length > 0) ? countNodes(ast) : 0;
+	}
+};
+
+class EvaluateBenchmark : public Benchmark {
+	ASTNode* ast;
+public:
+	double sink;
+	EvaluateBenchmark(const std::string& t_name, const std::string& input) {
+		name = t_name; sink = 0;
+		std::vector<char> text = interpreted(input);
+		Parser parser;
+		ast = parser.parse(&text[0]);
+	}
+	~EvaluateBenchmark() { delete ast; }
+	int run(unsigned long long iterations) {
+		Evaluator evaluator;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			sink += evaluator.evaluate(ast);
+		}
+		return countNodes(ast);
+	}
+};
+
+// Points one sample/ iteration evaluates at, spread over [0, 1]
+const size_t SAMPLE_POINTS = 64;
+
+// Evaluates an expression in x at SAMPLE_POINTS points per iteration, with Evaluator::evaluateBatch or with a
+// CompiledFunction built once up front
+class SampleBenchmark : public Benchmark {
+	ASTNode* ast;
+	bool compiled;
+public:
+	double sink;
+	SampleBenchmark(const std::string& t_name, const std::string& input, bool t_compiled) {
+		name = t_name; sink = 0; compiled = t_compiled;
+		std::vector<char> text = interpreted(input);
+		Parser parser;
+		ast = parser.parse(&text[0]);
+	}
+	~SampleBenchmark() { delete ast; }
+	int run(unsigned long long iterations) {
+		int x = SymbolTable::letter('x');
+		double points[SAMPLE_POINTS], values[SAMPLE_POINTS];
+		for (size_t k = 0; k < SAMPLE_POINTS; k++) {
+			points[k] = (k + 0.5) / SAMPLE_POINTS;
+		}
+		Evaluator evaluator;
+		CompiledFunction function(ast, x, evaluator);
+		for (unsigned long long i = 0; i < iterations; i++) {
+			if (compiled) function.evaluateBatch(points, values, SAMPLE_POINTS);
+			else evaluator.evaluateBatch(ast, x, points, values, SAMPLE_POINTS);
+			sink += values[i % SAMPLE_POINTS];
+		}
+		return countNodes(ast);
+	}
+};
+
+// Integrates from 0 to 1; by antiderivative when the integrator knows one, by quadrature otherwise
+class DefiniteBenchmark : public Benchmark {
+	ASTNode* ast;
+public:
+	double sink;
+	DefiniteBenchmark(const std::string& t_name, const std::string& input) {
+		name = t_name; sink = 0;
+		std::vector<char> text = interpreted(input);
+		Parser parser;
+		ast = parser.parse(&text[0]);
+	}
+	~DefiniteBenchmark() { delete ast; }
+	int run(unsigned long long iterations) {
+		Integrator integrator;
+		for (unsigned long long i = 0; i < iterations; i++) {
+			sink += integrator.integrateDefinite(ast, SymbolTable::letter('x'), 0, 1).value;
+		}
+		return countNodes(ast);
+	}
+};
+
+// Splits the iterations over threads, each integrating the fixed inputs in turn through Scalp::integrate (see scalp.h)
+// The library keeps no shared state on this path, so with enough cores ns_per_op falls in proportion to threads
+class StressBenchmark : public Benchmark {
+	unsigned int threads;
+	std::vector<std::string> inputs;
+public:
+	size_t sink;
+	StressBenchmark(const std::string& t_name, unsigned int t_threads, const std::vector<std::string>& t_inputs) : threads(t_threads), inputs(t_inputs) { name = t_name; sink = 0; }
+	int run(unsigned long long iterations) {
+		std::vector<std::thread> workers;
+		std::vector<size_t> lengths(threads, 0);
+		for (unsigned int t = 0; t < threads; t++) {
+			unsigned long long count = iterations / threads + (t < iterations % threads ? 1 : 0);
+			workers.push_back(std::thread([this, t, count, &lengths]() {
+				size_t length = 0; // Summed locally; neighbouring elements of lengths share a cache line
+				for (unsigned long long i = 0; i < count; i++) {
+					length += Scalp::integrate(inputs[(t + i) % inputs.size()]).size();
+				}
+				lengths[t] = length;
+				retiredAllocations += threadAllocations;
+			}));
+		}
+		for (unsigned int t = 0; t < threads; t++) {
+			workers[t].join();
+			sink += lengths[t];
+		}
+		return 0;
+	}
+};
+
+// Grows the iteration count until one batch takes at least minTime, then reports that batch
+static Result measure(Benchmark& benchmark, double minTime) {
+	typedef std::chrono::steady_clock Clock;
+	Result result;
+	result.name = benchmark.name;
+
+	unsigned long long iterations = 1;
+	while (true) {
+		unsigned long long allocationsBefore = allocationCount();
+		Clock::time_point start = Clock::now();
+		int nodes = benchmark.run(iterations);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		unsigned long long allocations = allocationCount() - allocationsBefore;
+
+		if (seconds >= minTime || iterations >= (1ULL << 40)) {
+			result.iterations = iterations;
+			result.nsPerOp = seconds * 1e9 / iterations;
+			result.allocsPerOp = (double)allocations / iterations;
+			result.nodesPerOp = nodes;
+			return result;
+		}
+		// Jump most of the way to the target in one step once a batch takes measurable time
+		unsigned long long next = (seconds > 1e-3) ? (unsigned long long)(iterations * minTime / seconds * 1.2) : iterations * 10;
+		iterations = (next > iterations) ? next : iterations * 2;
+	}
+}
+
+static std::string toJson(const Result& result) {
+	std::stringstream sstr;
+	sstr << "{\"name\":\"" << result.name << "\",\"iterations\":" << result.iterations << ",\"ns_per_op\":" << result.nsPerOp
+		<< ",\"allocs_per_op\":" << result.allocsPerOp << ",\"nodes_per_op\":" << result.nodesPerOp << "}";
+	return sstr.str();
+}
+
+// Reads "name" -> ns_per_op from the JSON lines written by an earlier run
+static std::map<std::string, double> loadBaseline(const std::string& path) {
+	std::map<std::string, double> baseline;
+	std::ifstream file(path.c_str());
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t nameStart = line.find("\"name\":\"");
+		size_t nsStart = line.find("\"ns_per_op\":");
+		if (nameStart == std::string::npos || nsStart == std::string::npos) continue;
+		nameStart += 8;
+		std::string name = line.substr(nameStart, line.find('"', nameStart) - nameStart);
+		baseline[name] = atof(line.c_str() + nsStart + 12);
+	}
+	return baseline;
+}
+
+int main(int argc, char* argv[]) {
+	std::string filter, outputPath, comparePath;
+	double minTime = 0.2;
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (option == "--filter" && i + 1 < argc) filter = argv[++i];
+		else if (option == "--min-time" && i + 1 < argc) minTime = atof(argv[++i]);
+		else if (option == "--output" && i + 1 < argc) outputPath = argv[++i];
+		else if (option == "--compare" && i + 1 < argc) comparePath = argv[++i];
+		else {
+			std::cerr << "Unknown option \"" << option << "\"\n";
+			return 1;
+		}
+	}
+
+	// Fixed inputs come from Tester::testIntergationI; scaling inputs grow by 10x per step
+	const char* fixedInputs[][2] = {
+		{ "poly", "5x^3 - 10x^6 + 4" },
+		{ "mixed", "x^99999 + 1/x + x" },
+		{ "cos", "8cos(x)" },
+	};
+	const int sizes[] = { 1, 10, 100, 1000 };
+
+	std::vector<Benchmark*> benchmarks;
+	for (int i = 0; i < 3; i++) {
+		std::string name = fixedInputs[i][0], input = fixedInputs[i][1];
+		benchmarks.push_back(new InterpretBenchmark("interpret/" + name, input));
+		benchmarks.push_back(new ParseBenchmark("parse/" + name, input));
+		benchmarks.push_back(new IntegrateBenchmark("integrate/" + name, input));
+	}
+	benchmarks.push_back(new EvaluateBenchmark("evaluate/arith", "8.99 * 10 + 8.85 * 1.60"));
+	for (int i = 0; i < 4; i++) {
+		std::string n = std::to_string(sizes[i]);
+		benchmarks.push_back(new InterpretBenchmark("interpret/poly/" + n, polynomial(sizes[i])));
+		benchmarks.push_back(new ParseBenchmark("parse/poly/" + n, polynomial(sizes[i])));
+		benchmarks.push_back(new BuildBenchmark("build/poly/" + n, sizes[i]));
+		benchmarks.push_back(new IntegrateBenchmark("integrate/poly/" + n, polynomial(sizes[i])));
+		benchmarks.push_back(new EvaluateBenchmark("evaluate/sum/" + n, constantSum(sizes[i])));
+	}
+	for (int size = 10; size <= 10000; size *= 10) {
+		std::string n = std::to_string(size), input = randomExpression(size, false);
+		benchmarks.push_back(new InterpretBenchmark("interpret/random/" + n, input));
+		benchmarks.push_back(new ParseBenchmark("parse/random/" + n, input));
+		benchmarks.push_back(new IntegrateBenchmark("integrate/random/" + n, input));
+		benchmarks.push_back(new EvaluateBenchmark("evaluate/random/" + n, randomExpression(size, true)));
+	}
+	benchmarks.push_back(new DefiniteBenchmark("definite/antiderivative", "5x^3 - 10x^6 + 4"));
+	benchmarks.push_back(new DefiniteBenchmark("definite/quadrature", "x*cos(x)"));
+	for (int size = 10; size <= 1000; size *= 10) {
+		std::string n = std::to_string(size), input = smoothExpression(size);
+		benchmarks.push_back(new SampleBenchmark("sample/evaluator/" + n, input, false));
+		benchmarks.push_back(new SampleBenchmark("sample/compiled/" + n, input, true));
+	}
+	for (int size = 10; size <= 1000; size *= 10) {
+		benchmarks.push_back(new DefiniteBenchmark("definite/quadrature/" + std::to_string(size), smoothExpression(size)));
+	}
+
+	std::vector<std::string> stressInputs;
+	for (int i = 0; i < 3; i++) {
+		stressInputs.push_back(fixedInputs[i][1]);
+	}
+	for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+		benchmarks.push_back(new StressBenchmark("stress/threads/" + std::to_string(threads), threads, stressInputs));
+	}
+
+	std::ofstream outputFile;
+	if (!outputPath.empty()) outputFile.open(outputPath.c_str());
+	std::ostream& out = outputPath.empty() ? std::cout : outputFile;
+
+	std::map<std::string, double> baseline;
+	if (!comparePath.empty()) baseline = loadBaseline(comparePath);
+
+	for (size_t i = 0; i < benchmarks.size(); i++) {
+		if (!filter.empty() && benchmarks[i]->name.find(filter) == std::string::npos) continue;
+		Result result = measure(*benchmarks[i], minTime);
+		out << toJson(result) << "\n";
+		out.flush();
+
+		// The comparison goes to stderr so that stdout stays machine-readable
+		std::map<std::string, double>::iterator old = baseline.find(result.name);
+		if (old != baseline.end() && old->second > 0) {
+			std::cerr << result.name << ": " << old->second << " -> " << result.nsPerOp << " ns/op ("
+				<< (result.nsPerOp / old->second - 1) * 100 << "%)\n";
+		}
+	}
+
+	for (size_t i = 0; i < benchmarks.size(); i++) {
+		delete benchmarks[i];
+	}
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+* Implements the analysis functions in analysis.h
+* See comments in analysis.h for more details
+*/
+
+#include "analysis.h"
+#include <cstddef>
+
+// Degrees beyond this are reported as "not a polynomial" rather than risking overflow
+const double MAX_DEGREE = 1e9;
+
+unsigned long long symbolBit(int symbol) {
+	if (symbol >= 0 && symbol < 63) return 1ULL << symbol;
+	return 1ULL << 63;
+}
+
+void analyzeNode(ASTNode* node) {
+	const ASTNode* left = node->left;
+	const ASTNode* right = node->right;
+
+	node->variables = ((left != NULL) ? left->variables : 0) | ((right != NULL) ? right->variables : 0);
+	node->hash = nodeHash(node, (left != NULL) ? left->hash : 0, (right != NULL) ? right->hash : 0);
+
+	// A missing operand (only possible in a malformed tree) counts as neither constant nor polynomial
+	bool leftConstant = (left != NULL) && left->constant, rightConstant = (right != NULL) && right->constant;
+	int leftDegree = (left != NULL) ? left->degree : -1, rightDegree = (right != NULL) ? right->degree : -1;
+
+	switch (node->type) {
+	case numberValue:
+		node->constant = true;
+		node->degree = 0;
+		break;
+	case variableChar:
+		node->variables = symbolBit(node->symbol);
+		node->constant = false;
+		node->degree = 1;
+		break;
+	case unaryMinus:
+		node->constant = leftConstant;
+		node->degree = leftDegree;
+		break;
+	case operatorPlus: case operatorMinus:
+		node->constant = leftConstant && rightConstant;
+		node->degree = (leftDegree < 0 || rightDegree < 0) ? -1 : (leftDegree > rightDegree ? leftDegree : rightDegree);
+		break;
+	case operatorMul:
+		node->constant = leftConstant && rightConstant;
+		node->degree = (leftDegree < 0 || rightDegree < 0 || (double)leftDegree + rightDegree > MAX_DEGREE) ? -1 : leftDegree + rightDegree;
+		break;
+	case operatorDivision:
+		node->constant = leftConstant && rightConstant;
+		node->degree = (rightConstant && leftDegree >= 0) ? leftDegree : -1;
+		break;
+	case operatorPower:
+		node->constant = leftConstant && rightConstant;
+		if (node->constant) {
+			node->degree = 0;
+		}
+		// Only a literal non-negative whole exponent keeps a polynomial a polynomial
+		else if (leftDegree >= 0 && right != NULL && right->type == numberValue && right->value >= 0 && right->value <= MAX_DEGREE
+			&& right->value == (double)(long long)right->value && leftDegree * right->value <= MAX_DEGREE) {
+			node->degree = (int)(leftDegree * right->value);
+		}
+		else {
+			node->degree = -1;
+		}
+		break;
+	case functionSin: case functionCos: case functionTan: case functionSec: case functionCsc: case functionCot:
+	case functionLog: case functionLn:
+		node->constant = (left == NULL || left->constant) && (right == NULL || right->constant);
+		node->degree = node->constant ? 0 : -1;
+		break;
+	default:
+		node->constant = false;
+		node->degree = -1;
+		break;
+	}
+	node->analyzed = true;
+}
+
+void analyzeTree(ASTNode* ast) {
+	if (ast == NULL) {
+		return;
+	}
+	analyzeTree(ast->left);
+	analyzeTree(ast->right);
+	analyzeNode(ast);
+}
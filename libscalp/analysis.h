@@ -0,0 +1,31 @@
+/*
+* Declares the functions that fill in the cached analysis attributes of ASTNodes (see ast.h): whether a subtree is
+* constant, which variables it uses, its polynomial degree and its structural hash.
+*
+* analyzeTree() computes them for a whole tree in one bottom-up pass. Afterwards, code that rewrites a node in place
+* calls analyzeNode() on it once its children are up to date; that costs O(1), so the attributes stay valid while
+* the simplifier works and rule guards can read them instead of walking the subtree again.
+*
+*  Sample usage:
+*   analyzeTree(ast);
+*   if (ast->constant) { ... }
+*   if ((ast->variables & symbolBit(x)) == 0) { ... } // Does not depend on the variable with symbol id x
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_ANALYSIS_H_
+#define SCALP_ANALYSIS_H_
+
+#include "ast.h"
+
+// Symbol ids 0-62 (every single letter among them, see symbols.h) have a bit each; all later ids share bit 63,
+// so a clear bit always means "does not depend on", but a set bit 63 only means "may depend on"
+unsigned long long symbolBit(int symbol);
+
+// Recomputes the attributes of node alone from those of its children, which must already be analyzed
+void analyzeNode(ASTNode* node);
+
+// Computes the attributes of every node in the tree
+void analyzeTree(ASTNode* ast);
+
+#endif // SCALP_ANALYSIS_H_
@@ -0,0 +1,57 @@
+/*
+* Implements the NodeArena class in arena.h
+* See comments in arena.h for more details
+*/
+
+#include "arena.h"
+#include "budget.h"
+#include <new>
+
+// Constructor
+NodeArena::NodeArena(size_t t_nodesPerBlock) {
+	this->nodesPerBlock = (t_nodesPerBlock == 0) ? 1 : t_nodesPerBlock;
+	this->currentBlock = 0;
+	this->usedInBlock = 0;
+}
+
+// Destructor; nodes are never destroyed individually, only their raw storage is released
+NodeArena::~NodeArena() {
+	for (size_t i = 0; i < blocks.size(); i++) {
+		::operator delete(blocks[i]);
+	}
+}
+
+ASTNode* NodeArena::allocate() {
+	// Each block is charged as it starts filling, whether it is new or kept from before a reset(), and before
+	// anything changes, so the arena is still whole if the charge throws
+	if (usedInBlock == 0 || usedInBlock == nodesPerBlock) {
+		Budget::chargeArenaBytes(nodesPerBlock * sizeof(ASTNode));
+	}
+	if (currentBlock < blocks.size() && usedInBlock == nodesPerBlock) {
+		currentBlock++;
+		usedInBlock = 0;
+	}
+	if (currentBlock == blocks.size()) {
+		blocks.push_back((ASTNode*)::operator new(nodesPerBlock * sizeof(ASTNode)));
+	}
+
+	ASTNode* slot = blocks[currentBlock] + usedInBlock;
+	usedInBlock++;
+	return new (slot) ASTNode;
+}
+
+void NodeArena::reset() {
+	currentBlock = 0;
+	usedInBlock = 0;
+}
+
+size_t NodeArena::bytesUsed() const {
+	if (blocks.empty()) {
+		return 0;
+	}
+	return (currentBlock * nodesPerBlock + usedInBlock) * sizeof(ASTNode);
+}
+
+size_t NodeArena::bytesReserved() const {
+	return blocks.size() * nodesPerBlock * sizeof(ASTNode);
+}
@@ -0,0 +1,53 @@
+/*
+* Declares a NodeArena class, a bump allocator for ASTNodes.
+* A Parser given an arena places every node it creates in the arena instead of on the heap, and the whole tree is
+* released at once by reset(). This makes per-request allocation in long-running workers cheap and keeps their
+* memory footprint from creeping up.
+*
+* Trees built in an arena must NOT be deleted: ASTNode's destructor deletes its children, which the arena owns.
+*
+*  Sample usage:
+*   NodeArena arena; Parser parser;
+*   parser.setArena(&arena);
+*   ASTNode* ast = parser.parse(text);
+*   ...
+*   arena.reset(); // ast and everything under it are gone
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_ARENA_H_
+#define SCALP_ARENA_H_
+
+#include "ast.h"
+#include <cstddef>
+#include <vector>
+
+class NodeArena
+{
+	// Each block holds nodesPerBlock nodes; blocks are kept across reset() so a warm arena stops allocating
+	std::vector<ASTNode*> blocks;
+	size_t nodesPerBlock;
+	size_t currentBlock;
+	size_t usedInBlock;
+
+	NodeArena(const NodeArena&);
+	NodeArena& operator=(const NodeArena&);
+
+public:
+	NodeArena(size_t t_nodesPerBlock = 1024);
+	~NodeArena();
+
+	// Returns a freshly constructed node that lives until the next reset()
+	ASTNode* allocate();
+
+	// Forgets every node handed out so far; their memory is reused by later allocations
+	void reset();
+
+	// Bytes of node storage handed out since the last reset()
+	size_t bytesUsed() const;
+
+	// Bytes of node storage reserved from the heap, whether in use or not
+	size_t bytesReserved() const;
+};
+
+#endif // SCALP_ARENA_H_
@@ -0,0 +1,78 @@
+/*
+* Implements the ASTNode class in ast.h
+* See comments in ast.h for more details
+*/
+
+#include "ast.h"
+#include "symbols.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Constructor
+ASTNode::ASTNode() {
+	this->type = undefined;
+	this->value = 0;
+	this->symbol = -1;
+	this->left = NULL;
+	this->right = NULL;
+	this->analyzed = false;
+	this->constant = false;
+	this->variables = 0;
+	this->degree = -1;
+	this->hash = 0;
+}
+
+// Destructor
+ASTNode::~ASTNode() {
+	delete left;
+	delete right;
+}
+
+// Finalizer from SplitMix64; spreads every input bit over the whole output
+static unsigned long long mixHash(unsigned long long h) {
+	h ^= h >> 30; h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27; h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
+
+unsigned long long structuralHash(const ASTNode* ast) {
+	if (ast == NULL) {
+		return 0;
+	}
+	return nodeHash(ast, structuralHash(ast->left), structuralHash(ast->right));
+}
+
+unsigned long long nodeHash(const ASTNode* ast, unsigned long long leftHash, unsigned long long rightHash) {
+	unsigned long long h = mixHash((unsigned long long)ast->type + 1);
+	if (ast->type == numberValue) {
+		double value = (ast->value == 0) ? 0.0 : ast->value; // -0 and 0 are the same number
+		unsigned long long bits;
+		memcpy(&bits, &value, sizeof(bits));
+		h = mixHash(h ^ bits);
+	}
+	else if (ast->type == variableChar) {
+		h = mixHash(h ^ SymbolTable::nameHash(ast->symbol)); // Ids differ between processes, names do not
+	}
+
+	// Addition is symmetric, so commutative operators do not depend on the order of their operands
+	if (ast->type == operatorPlus || ast->type == operatorMul) {
+		return mixHash(h ^ (mixHash(leftHash) + mixHash(rightHash)));
+	}
+	return mixHash(mixHash(h ^ leftHash) ^ (rightHash * 0x9E3779B97F4A7C15ULL));
+}
+
+bool sameTree(const ASTNode* a, const ASTNode* b) {
+	if (a == NULL || b == NULL) {
+		return a == b;
+	}
+	if (a->type != b->type || a->symbol != b->symbol) {
+		return false;
+	}
+	// -0 and 0 differ here, unlike in the hash, as 1/-0 and 1/0 do not evaluate alike
+	if (a->type == numberValue && (a->value != b->value || std::signbit(a->value) != std::signbit(b->value))) {
+		return false;
+	}
+	return sameTree(a->left, b->left) && sameTree(a->right, b->right);
+}
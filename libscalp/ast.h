@@ -32,7 +32,7 @@ enum ASTNodeType
 };
 
 // A single node in our AST can be represented as such:
-//     [TYPE]-[VALUE]-[CHAR]-[LEFT]-[RIGHT]
+//     [TYPE]-[VALUE]-[SYMBOL]-[LEFT]-[RIGHT]
 // 
 // A complete AST contains multiple nodes.
 // Here is a representation of a AST representing the expression "x+6*3":
@@ -46,12 +46,30 @@ class ASTNode
 public:
 	ASTNodeType type;
 	double value;
-	char var;
+	int symbol; // The variable's id in the SymbolTable (see symbols.h), or -1 if this is not a variable
 	ASTNode* left;
 	ASTNode* right;
 
+	// Facts about the subtree rooted here, filled in bottom-up by analyzeTree() and analyzeNode() (see analysis.h)
+	// They are only meaningful while analyzed is true; nodes start out unanalyzed
+	bool analyzed;
+	bool constant; // No variables anywhere below
+	unsigned long long variables; // Bit per variable that appears below; see symbolBit() in analysis.h
+	int degree; // Total polynomial degree, or -1 if the subtree is not a polynomial
+	unsigned long long hash; // structuralHash() of the subtree
+
 	ASTNode();
 	~ASTNode();
 };
 
+// Returns a 64-bit hash of the tree's structure and contents
+// The hash is canonical for the commutative operators, so "x+1" and "1+x" (or "2*x" and "x*2") hash alike
+unsigned long long structuralHash(const ASTNode* ast);
+
+// The hash of one node given the structural hashes of its children; structuralHash() applies this bottom-up
+unsigned long long nodeHash(const ASTNode* ast, unsigned long long leftHash, unsigned long long rightHash);
+
+// Whether both trees have the same shape and the same node contents, operands in the same order
+bool sameTree(const ASTNode* a, const ASTNode* b);
+
 #endif //SCALP_AST_H_
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+* Implements the Budget class in budget.h
+* See comments in budget.h for more details
+*/
+
+#include "budget.h"
+#include "stats.h"
+#include <sstream>
+
+// The innermost Budget of each thread; the others are reached through outer
+static thread_local Budget* currentBudget = NULL;
+
+// Constructor
+BudgetLimits::BudgetLimits() {
+	this->seconds = 0;
+	this->maxNodes = 0;
+	this->maxArenaBytes = 0;
+}
+
+// Constructor
+Budget::Budget(const BudgetLimits& t_limits) {
+	this->limits = t_limits;
+	this->deadline = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(t_limits.seconds));
+	this->nodes = 0;
+	this->arenaBytes = 0;
+	this->checksUntilClock = BUDGET_CLOCK_INTERVAL;
+	this->outer = currentBudget;
+	currentBudget = this;
+}
+
+// Destructor; budgets are destroyed in the reverse order they were made, so the outer one is in scope again
+Budget::~Budget() {
+	currentBudget = outer;
+}
+
+size_t Budget::nodesUsed() const {
+	return nodes;
+}
+
+size_t Budget::arenaBytesUsed() const {
+	return arenaBytes;
+}
+
+void Budget::checkClock(bool now) {
+	if (--checksUntilClock > 0 && !now) {
+		return;
+	}
+	checksUntilClock = BUDGET_CLOCK_INTERVAL;
+	if (limits.seconds > 0 && std::chrono::steady_clock::now() >= deadline) {
+		std::stringstream sstr;
+		sstr << "Budget exceeded: took longer than " << limits.seconds * 1000 << " ms.";
+		throw BudgetException(sstr.str(), budgetTime);
+	}
+}
+
+void Budget::check() {
+	for (Budget* budget = currentBudget; budget != NULL; budget = budget->outer) {
+		budget->checkClock(false);
+	}
+}
+
+void Budget::checkDeadline() {
+	for (Budget* budget = currentBudget; budget != NULL; budget = budget->outer) {
+		budget->checkClock(true);
+	}
+}
+
+void Budget::chargeNodes(size_t count) {
+	for (Budget* budget = currentBudget; budget != NULL; budget = budget->outer) {
+		budget->nodes += count;
+		if (budget->limits.maxNodes > 0 && budget->nodes > budget->limits.maxNodes) {
+			std::stringstream sstr;
+			sstr << "Budget exceeded: more than " << budget->limits.maxNodes << " nodes.";
+			throw BudgetException(sstr.str(), budgetNodes);
+		}
+		budget->checkClock(false);
+	}
+}
+
+void Budget::chargeArenaBytes(size_t bytes) {
+	for (Budget* budget = currentBudget; budget != NULL; budget = budget->outer) {
+		budget->arenaBytes += bytes;
+		if (budget->limits.maxArenaBytes > 0 && budget->arenaBytes > budget->limits.maxArenaBytes) {
+			std::stringstream sstr;
+			sstr << "Budget exceeded: more than " << budget->limits.maxArenaBytes << " bytes of arena storage.";
+			throw BudgetException(sstr.str(), budgetArenaBytes);
+		}
+	}
+}
+
+// BudgetException derived from std::runtime_error, which keeps a copy of the message for what()
+BudgetException::BudgetException(const std::string& message, BudgetResource t_resource) : std::runtime_error(message) {
+	this->resource = t_resource;
+	Stats::count(counterExceptions);
+	Stats::count(counterBudgetsExceeded);
+}
+
+BudgetResource BudgetException::exceeded() const {
+	return resource;
+}
@@ -0,0 +1,96 @@
+/*
+* Declares the Budget class, which limits the work one request may do: a deadline, a number of AST nodes and a
+* number of bytes of arena storage, so that a single pathological input cannot stall a worker or grow its memory
+* without bound.
+*
+* Budgets are cooperative. A Budget applies to the thread that creates it, for as long as it exists, and the
+* pipeline charges it at cheap points: the Parser, the LikeTerms pass and the Builder for every node they create,
+* NodeArena for every block it starts filling, Parser::simplify for every pass over the tree, the Integrator for
+* every subtree it integrates and Quadrature for every round. Once a limit is passed, the next charge throws a
+* BudgetException, which unwinds the request and leaves nothing behind but its arena (see arena.h) to reset. Reading
+* the clock costs more than the rest of a check, so most checks only read it every BUDGET_CLOCK_INTERVAL calls; with
+* no Budget in scope, a check is a test of one thread-local pointer.
+*
+* Budgets may be nested; the work is charged to all of them, so an inner one can only tighten an outer one.
+*
+*  Sample usage:
+*   BudgetLimits limits;
+*   limits.seconds = 0.05; limits.maxNodes = 1000000; limits.maxArenaBytes = 64 << 20;
+*   try {
+*     Budget budget(limits);
+*     solution = integrator.integrate(parser.parse(text));
+*   }
+*   catch (const BudgetException& e) { ... } // e.what() says which limit was passed
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_BUDGET_H_
+#define SCALP_BUDGET_H_
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Checks between two readings of the clock; a check costs a few nanoseconds, so the deadline is noticed within
+// microseconds of passing
+const unsigned int BUDGET_CLOCK_INTERVAL = 256;
+
+enum BudgetResource { budgetTime, budgetNodes, budgetArenaBytes };
+
+// A limit of 0 means no limit
+struct BudgetLimits {
+	double seconds;
+	size_t maxNodes;
+	size_t maxArenaBytes;
+
+	// No limits at all
+	BudgetLimits();
+};
+
+class Budget
+{
+	BudgetLimits limits;
+	std::chrono::steady_clock::time_point deadline;
+	size_t nodes;
+	size_t arenaBytes;
+	unsigned int checksUntilClock;
+
+	// The Budget that was in scope on this thread when this one was created
+	Budget* outer;
+
+	Budget(const Budget&);
+	Budget& operator=(const Budget&);
+
+	// Reads the clock every BUDGET_CLOCK_INTERVAL calls, or on this one if now is set
+	void checkClock(bool now);
+
+public:
+	// Starts the clock, and applies the budget to the calling thread until it is destroyed
+	Budget(const BudgetLimits& t_limits);
+	~Budget();
+
+	size_t nodesUsed() const;
+	size_t arenaBytesUsed() const;
+
+	// Each of these throws a BudgetException if a Budget of the calling thread has run out
+	// check() suits places reached often and cheaply; checkDeadline() reads the clock every time, for places that
+	// are reached rarely but may be far apart in time (a pass over a whole tree, a round of quadrature)
+	static void check();
+	static void checkDeadline();
+	static void chargeNodes(size_t count);
+	static void chargeArenaBytes(size_t bytes);
+};
+
+class BudgetException : public std::runtime_error
+{
+	BudgetResource resource;
+
+public:
+	BudgetException(const std::string& message, BudgetResource t_resource);
+
+	// The limit that was passed
+	BudgetResource exceeded() const;
+};
+
+#endif // SCALP_BUDGET_H_
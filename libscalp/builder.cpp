@@ -0,0 +1,251 @@
+/*
+* Implements the Builder class in builder.h
+* See comments in builder.h for more details
+*/
+
+#include "builder.h"
+#include "analysis.h"
+#include "budget.h"
+#include "stats.h"
+#include "symbols.h"
+#include <cmath>
+
+// Constructor
+Expression::Expression(Builder* t_builder, ASTNode* t_node) {
+	this->builder = t_builder;
+	this->node = t_node;
+}
+
+ASTNode* Expression::ast() const {
+	return node;
+}
+
+int Expression::symbol() const {
+	return (node->type == variableChar) ? node->symbol : -1;
+}
+
+Builder* Expression::owner() const {
+	return builder;
+}
+
+// Constructor
+Builder::Builder() : ownArena(256) {
+	this->arena = &ownArena;
+}
+
+void Builder::setArena(NodeArena* t_arena) {
+	this->arena = (t_arena != NULL) ? t_arena : &ownArena;
+}
+
+void Builder::reset() {
+	arena->reset();
+}
+
+ASTNode* Builder::allocateNode() {
+	Stats::count(counterNodesAllocated);
+	Budget::chargeNodes(1);
+	return arena->allocate();
+}
+
+ASTNode* Builder::createNumberNode(double value) {
+	ASTNode* node = allocateNode();
+	node->type = numberValue;
+	node->value = value;
+	analyzeNode(node);
+	return node;
+}
+
+ASTNode* Builder::createNode(ASTNodeType type, ASTNode* left, ASTNode* right) {
+	ASTNode* node = allocateNode();
+	node->type = type;
+	node->left = left;
+	node->right = right;
+	analyzeNode(node);
+	return node;
+}
+
+Expression Builder::var(const std::string& name) {
+	if (!SymbolTable::isName(name)) {
+		throw BuilderException("'" + name + "' is not a variable name");
+	}
+	int symbol = SymbolTable::intern(name);
+	if (symbol < 0) {
+		throw BuilderException("Too many distinct variable names; cannot add '" + name + "'");
+	}
+	return var(symbol);
+}
+
+Expression Builder::var(int symbol) {
+	ASTNode* node = allocateNode();
+	node->type = variableChar;
+	node->symbol = symbol;
+	analyzeNode(node);
+	return Expression(this, node);
+}
+
+Expression Builder::number(double value) {
+	return Expression(this, createNumberNode(value));
+}
+
+static bool isNumber(const ASTNode* node, double value) {
+	return node->type == numberValue && node->value == value;
+}
+
+Expression Builder::combine(ASTNodeType type, const Expression& t_left, const Expression* t_right) {
+	ASTNode* left = t_left.node;
+	ASTNode* right = (t_right != NULL) ? t_right->node : NULL;
+
+	// Operators on two numbers are computed now, unless the answer is not a number (1/0, for instance)
+	if (left->type == numberValue && (right == NULL || right->type == numberValue)) {
+		double value;
+		bool folded = true;
+		switch (type) {
+		case unaryMinus: value = -left->value; break;
+		case operatorPlus: value = left->value + right->value; break;
+		case operatorMinus: value = left->value - right->value; break;
+		case operatorMul: value = left->value * right->value; break;
+		case operatorDivision: value = left->value / right->value; break;
+		case operatorPower: value = std::pow(left->value, right->value); break;
+		default: folded = false; break;
+		}
+		if (folded && std::isfinite(value)) {
+			return number(value);
+		}
+	}
+
+	// Identities; the operand that is left over is already built, so nothing new is made
+	switch (type) {
+	case operatorPlus:
+		if (isNumber(left, 0)) return *t_right;
+		if (isNumber(right, 0)) return t_left;
+		break;
+	case operatorMinus:
+		if (isNumber(right, 0)) return t_left;
+		break;
+	case operatorMul:
+		if (isNumber(left, 1)) return *t_right;
+		if (isNumber(right, 1)) return t_left;
+		break;
+	case operatorDivision:
+		if (isNumber(right, 1)) return t_left;
+		break;
+	case operatorPower:
+		if (isNumber(left, 1) || isNumber(right, 1)) return t_left;
+		// The Parser never makes a negative number exponent and the Integrator's power rules do not expect one, so
+		// x^-n is built as 1/x^n (and x^-1 as 1/x), the shape the Parser gives "1/x^n"
+		if (right->type == numberValue && right->value < 0) {
+			Expression positive = number(-right->value);
+			Expression power = combine(operatorPower, t_left, &positive);
+			Expression one = number(1);
+			return combine(operatorDivision, one, &power);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return Expression(this, createNode(type, left, right));
+}
+
+Expression operator+(const Expression& left, const Expression& right) {
+	return left.owner()->combine(operatorPlus, left, &right);
+}
+
+Expression operator+(const Expression& left, double right) {
+	return left + left.owner()->number(right);
+}
+
+Expression operator+(double left, const Expression& right) {
+	return right.owner()->number(left) + right;
+}
+
+Expression operator-(const Expression& left, const Expression& right) {
+	return left.owner()->combine(operatorMinus, left, &right);
+}
+
+Expression operator-(const Expression& left, double right) {
+	return left - left.owner()->number(right);
+}
+
+Expression operator-(double left, const Expression& right) {
+	return right.owner()->number(left) - right;
+}
+
+Expression operator*(const Expression& left, const Expression& right) {
+	return left.owner()->combine(operatorMul, left, &right);
+}
+
+Expression operator*(const Expression& left, double right) {
+	return left * left.owner()->number(right);
+}
+
+Expression operator*(double left, const Expression& right) {
+	return right.owner()->number(left) * right;
+}
+
+Expression operator/(const Expression& left, const Expression& right) {
+	return left.owner()->combine(operatorDivision, left, &right);
+}
+
+Expression operator/(const Expression& left, double right) {
+	return left / left.owner()->number(right);
+}
+
+Expression operator/(double left, const Expression& right) {
+	return right.owner()->number(left) / right;
+}
+
+Expression operator-(const Expression& operand) {
+	return operand.owner()->combine(unaryMinus, operand, NULL);
+}
+
+Expression pow(const Expression& base, const Expression& exponent) {
+	return base.owner()->combine(operatorPower, base, &exponent);
+}
+
+Expression pow(const Expression& base, double exponent) {
+	return pow(base, base.owner()->number(exponent));
+}
+
+Expression pow(double base, const Expression& exponent) {
+	return pow(exponent.owner()->number(base), exponent);
+}
+
+Expression sin(const Expression& argument) {
+	return argument.owner()->combine(functionSin, argument, NULL);
+}
+
+Expression cos(const Expression& argument) {
+	return argument.owner()->combine(functionCos, argument, NULL);
+}
+
+Expression tan(const Expression& argument) {
+	return argument.owner()->combine(functionTan, argument, NULL);
+}
+
+Expression sec(const Expression& argument) {
+	return argument.owner()->combine(functionSec, argument, NULL);
+}
+
+Expression csc(const Expression& argument) {
+	return argument.owner()->combine(functionCsc, argument, NULL);
+}
+
+Expression cot(const Expression& argument) {
+	return argument.owner()->combine(functionCot, argument, NULL);
+}
+
+Expression ln(const Expression& argument) {
+	return argument.owner()->combine(functionLn, argument, NULL);
+}
+
+// The base goes on the left, as the Parser puts it
+Expression log(double base, const Expression& argument) {
+	Expression baseNode = argument.owner()->number(base);
+	return argument.owner()->combine(functionLog, baseNode, &argument);
+}
+
+// BuilderException derived from std::runtime_error, which keeps a copy of the message for what()
+BuilderException::BuilderException(const std::string& message) : std::runtime_error(message) {
+	Stats::count(counterExceptions);
+}
@@ -0,0 +1,128 @@
+/*
+* Declares a Builder class, which builds ASTs straight from C++ code, for library users who already hold an
+* expression in code and would otherwise have to write it out as text and send it through the Interpreter and Parser.
+*
+* A Builder hands out Expressions; the usual C++ operators (+ - * / and unary -) and the functions pow, sin, cos,
+* tan, sec, csc, cot, ln and log combine them into bigger ones. Every node is analyzed as it is made (see analysis.h)
+* and simplified on the spot: operators on two numbers are computed, and the identities x+0, x-0, x*1, x/1 and x^1
+* are applied, and a negative number exponent is turned into a division (pow(x, -2) is 1/x^2), so the result is
+* ready for the Integrator or Evaluator as is. Arithmetic between plain C++ numbers never reaches the Builder at
+* all; the compiler does it, so pow(x, 2) * (3.0 / 4) adds a single number node.
+*
+* Nodes are placed in a NodeArena (see arena.h): the Builder's own, or the one passed to setArena(). Trees built
+* this way must NOT be deleted; they live until the arena is reset. Since nothing is ever freed one node at a time,
+* an Expression can be used in any number of bigger ones, and its subtree is shared rather than copied.
+*
+* The trees have the natural shape of the expression (x-1 is a single operatorMinus node), which is not always the
+* shape the Parser would produce from the same text, so answers may be written differently but are equal.
+*
+*  Sample usage:
+*   Builder builder;
+*   Expression x = builder.var("x");
+*   ASTNode* ast = (3 * pow(x, 2) + sin(x) / 2).ast();
+*   std::string solution = integrator.integrate(ast, x.symbol());
+*   builder.reset(); // ast is gone
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_BUILDER_H_
+#define SCALP_BUILDER_H_
+
+#include "arena.h"
+#include "ast.h"
+#include <stdexcept>
+#include <string>
+
+class Builder;
+
+// A handle to a tree made by a Builder; cheap to copy
+class Expression
+{
+	friend class Builder;
+
+	Builder* builder;
+	ASTNode* node;
+
+	Expression(Builder* t_builder, ASTNode* t_node);
+public:
+	// The tree; owned by the builder's arena, so it must not be deleted
+	ASTNode* ast() const;
+
+	// The symbol id if this is a single variable (see symbols.h), or -1
+	int symbol() const;
+
+	Builder* owner() const;
+};
+
+class Builder
+{
+	// Used when no arena is set
+	NodeArena ownArena;
+
+	// Where new nodes are placed
+	NodeArena* arena;
+
+	Builder(const Builder&);
+	Builder& operator=(const Builder&);
+
+	ASTNode* allocateNode();
+	ASTNode* createNumberNode(double value);
+	ASTNode* createNode(ASTNodeType type, ASTNode* left, ASTNode* right);
+public:
+	Builder();
+
+	// Places the nodes built from now on in t_arena; pass NULL to go back to the builder's own arena
+	void setArena(NodeArena* t_arena);
+
+	// Forgets every node in the arena nodes are currently placed in
+	void reset();
+
+	// The variable called name, which must be a valid variable name (x, y, x_1, v_max, ...)
+	// Throws a BuilderException if it is not, or if the SymbolTable is full
+	Expression var(const std::string& name);
+
+	// The variable with symbol id symbol
+	Expression var(int symbol);
+
+	Expression number(double value);
+
+	// Makes the node type with operands left and right (right is NULL for unary minus and one-argument functions),
+	// after folding numbers and applying identities; the operator overloads below all go through here
+	Expression combine(ASTNodeType type, const Expression& left, const Expression* right);
+};
+
+Expression operator+(const Expression& left, const Expression& right);
+Expression operator+(const Expression& left, double right);
+Expression operator+(double left, const Expression& right);
+Expression operator-(const Expression& left, const Expression& right);
+Expression operator-(const Expression& left, double right);
+Expression operator-(double left, const Expression& right);
+Expression operator*(const Expression& left, const Expression& right);
+Expression operator*(const Expression& left, double right);
+Expression operator*(double left, const Expression& right);
+Expression operator/(const Expression& left, const Expression& right);
+Expression operator/(const Expression& left, double right);
+Expression operator/(double left, const Expression& right);
+Expression operator-(const Expression& operand);
+
+Expression pow(const Expression& base, const Expression& exponent);
+Expression pow(const Expression& base, double exponent);
+Expression pow(double base, const Expression& exponent);
+Expression sin(const Expression& argument);
+Expression cos(const Expression& argument);
+Expression tan(const Expression& argument);
+Expression sec(const Expression& argument);
+Expression csc(const Expression& argument);
+Expression cot(const Expression& argument);
+Expression ln(const Expression& argument);
+
+// Logarithm of argument in base base
+Expression log(double base, const Expression& argument);
+
+class BuilderException : public std::runtime_error
+{
+public:
+	BuilderException(const std::string& message);
+};
+
+#endif // SCALP_BUILDER_H_
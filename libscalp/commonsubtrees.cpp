@@ -0,0 +1,85 @@
+/*
+* Implements the CommonSubtrees class in commonsubtrees.h
+* See comments in commonsubtrees.h for more details
+*/
+
+#include "commonsubtrees.h"
+
+static bool isLeaf(const ASTNode* ast) {
+	return ast->left == NULL && ast->right == NULL;
+}
+
+// Constructor; hashes the whole tree first, then counts it top-down
+CommonSubtrees::CommonSubtrees(const ASTNode* ast) {
+	hashTree(ast);
+	count(ast);
+}
+
+unsigned long long CommonSubtrees::hashTree(const ASTNode* ast) {
+	if (ast == NULL) {
+		return 0;
+	}
+	if (ast->analyzed) {
+		return ast->hash; // Its children are analyzed too, so nothing below needs hashing
+	}
+	unsigned long long h = nodeHash(ast, hashTree(ast->left), hashTree(ast->right));
+	hashes[ast] = h;
+	return h;
+}
+
+unsigned long long CommonSubtrees::hashOf(const ASTNode* ast) const {
+	if (ast->analyzed) {
+		return ast->hash;
+	}
+	std::unordered_map<const ASTNode*, unsigned long long>::const_iterator found = hashes.find(ast);
+	return (found != hashes.end()) ? found->second : 0;
+}
+
+// A copy of a subtree that was already seen adds a use and is not looked into, so what lies below it is only
+// counted through the first copy
+void CommonSubtrees::count(const ASTNode* ast) {
+	if (ast == NULL || isLeaf(ast)) {
+		return;
+	}
+	int entry = find(ast);
+	if (entry >= 0) {
+		entries[entry].uses++;
+		return;
+	}
+
+	Entry added = { ast, 1 };
+	byHash.insert(std::make_pair(hashOf(ast), (int)entries.size()));
+	entries.push_back(added);
+	count(ast->left);
+	count(ast->right);
+}
+
+int CommonSubtrees::find(const ASTNode* ast) const {
+	if (ast == NULL || isLeaf(ast)) {
+		return -1;
+	}
+	typedef std::unordered_multimap<unsigned long long, int>::const_iterator Iterator;
+	std::pair<Iterator, Iterator> range = byHash.equal_range(hashOf(ast));
+	for (Iterator i = range.first; i != range.second; ++i) {
+		if (entries[i->second].subtree == ast || sameTree(entries[i->second].subtree, ast)) {
+			return i->second;
+		}
+	}
+	return -1;
+}
+
+size_t CommonSubtrees::uses(int entry) const {
+	return (entry >= 0 && (size_t)entry < entries.size()) ? entries[entry].uses : 0;
+}
+
+size_t CommonSubtrees::size() const {
+	return entries.size();
+}
+
+size_t CommonSubtrees::repeated() const {
+	size_t total = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].uses > 1) total++;
+	}
+	return total;
+}
@@ -0,0 +1,57 @@
+/*
+* Declares the CommonSubtrees class, which finds the subtrees that occur more than once in an AST, so that they can
+* be computed once and shared (see compiledfunction.h) or written once and named (see Formatter::formatShared).
+*
+* Candidates are grouped by structural hash (see ast.h) and confirmed with sameTree(), so a hash collision never
+* merges two different subtrees. Each distinct subtree is counted once per place it is used: a subtree inside a
+* repeated one counts once for all copies of its parent, since sharing the parent already shares it. Leaves are
+* never counted, as reading them again costs nothing.
+*
+*  Sample usage:
+*   CommonSubtrees common(ast);
+*   int entry = common.find(ast->left);
+*   if (entry >= 0 && common.uses(entry) > 1) { ... }
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_COMMONSUBTREES_H_
+#define SCALP_COMMONSUBTREES_H_
+
+#include "ast.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class CommonSubtrees
+{
+	struct Entry {
+		const ASTNode* subtree; // The first copy, in pre-order
+		size_t uses;
+	};
+	std::vector<Entry> entries;
+	std::unordered_multimap<unsigned long long, int> byHash;
+
+	// Structural hashes of nodes that were never analyzed; analyzed ones carry theirs (see analysis.h)
+	std::unordered_map<const ASTNode*, unsigned long long> hashes;
+
+	unsigned long long hashTree(const ASTNode* ast);
+	unsigned long long hashOf(const ASTNode* ast) const;
+	void count(const ASTNode* ast);
+
+public:
+	CommonSubtrees(const ASTNode* ast);
+
+	// The entry of the subtree equal to ast, which must be part of the tree this was built from, or -1 for a leaf
+	int find(const ASTNode* ast) const;
+
+	// Places the subtree of entry is used, counted as described above
+	size_t uses(int entry) const;
+
+	// Number of entries; they are numbered from 0
+	size_t size() const;
+
+	// Number of distinct subtrees used more than once
+	size_t repeated() const;
+};
+
+#endif // SCALP_COMMONSUBTREES_H_
@@ -0,0 +1,389 @@
+/*
+* Implements the CompiledFunction class in compiledfunction.h
+* See comments in compiledfunction.h for more details
+*/
+
+#include "compiledfunction.h"
+#include "analysis.h"
+#include "commonsubtrees.h"
+#include "symbols.h"
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// The operations a step can perform; the step templates below inline apply(), so each operator gets its own loop
+struct Add { static double apply(double a, double b) { return a + b; } };
+struct Subtract { static double apply(double a, double b) { return a - b; } };
+struct Multiply { static double apply(double a, double b) { return a * b; } };
+struct Divide { static double apply(double a, double b) { return a / b; } };
+struct Power { static double apply(double a, double b) { return pow(a, b); } };
+struct Log { static double apply(double base, double a) { return log(a) / log(base); } };
+struct LogKnownBase { static double apply(double logBase, double a) { return log(a) / logBase; } }; // log(base) precomputed
+
+struct Negate { static double apply(double a) { return -a; } };
+struct Square { static double apply(double a) { return a * a; } };
+struct Sin { static double apply(double a) { return sin(a); } };
+struct Cos { static double apply(double a) { return cos(a); } };
+struct Tan { static double apply(double a) { return tan(a); } };
+struct Sec { static double apply(double a) { return 1 / cos(a); } };
+struct Csc { static double apply(double a) { return 1 / sin(a); } };
+struct Cot { static double apply(double a) { return cos(a) / sin(a); } };
+struct Ln { static double apply(double a) { return log(a); } };
+
+// Steps on one point; slot k is slots[k]
+template <class Op> static void pointUnary(const CompiledStep& step, double* slots) {
+	slots[step.target] = Op::apply(slots[step.left]);
+}
+template <class Op> static void pointSlots(const CompiledStep& step, double* slots) {
+	slots[step.target] = Op::apply(slots[step.left], slots[step.right]);
+}
+template <class Op> static void pointSlotConstant(const CompiledStep& step, double* slots) {
+	slots[step.target] = Op::apply(slots[step.left], step.constant);
+}
+template <class Op> static void pointConstantSlot(const CompiledStep& step, double* slots) {
+	slots[step.target] = Op::apply(step.constant, slots[step.right]);
+}
+
+// Steps on a block of points; slot k is slots[k * COMPILED_BLOCK_SIZE] onwards
+// A step may write the slot it reads, which is fine because each point only reads its own entry before writing it
+template <class Op> static void blockUnary(const CompiledStep& step, double* slots, size_t count) {
+	double* target = slots + step.target * COMPILED_BLOCK_SIZE;
+	const double* left = slots + step.left * COMPILED_BLOCK_SIZE;
+	for (size_t i = 0; i < count; i++) target[i] = Op::apply(left[i]);
+}
+template <class Op> static void blockSlots(const CompiledStep& step, double* slots, size_t count) {
+	double* target = slots + step.target * COMPILED_BLOCK_SIZE;
+	const double* left = slots + step.left * COMPILED_BLOCK_SIZE;
+	const double* right = slots + step.right * COMPILED_BLOCK_SIZE;
+	for (size_t i = 0; i < count; i++) target[i] = Op::apply(left[i], right[i]);
+}
+template <class Op> static void blockSlotConstant(const CompiledStep& step, double* slots, size_t count) {
+	double* target = slots + step.target * COMPILED_BLOCK_SIZE;
+	const double* left = slots + step.left * COMPILED_BLOCK_SIZE;
+	double constant = step.constant;
+	for (size_t i = 0; i < count; i++) target[i] = Op::apply(left[i], constant);
+}
+template <class Op> static void blockConstantSlot(const CompiledStep& step, double* slots, size_t count) {
+	double* target = slots + step.target * COMPILED_BLOCK_SIZE;
+	const double* right = slots + step.right * COMPILED_BLOCK_SIZE;
+	double constant = step.constant;
+	for (size_t i = 0; i < count; i++) target[i] = Op::apply(constant, right[i]);
+}
+
+// The three operand shapes of one binary operator; both operands known is folded instead
+struct BinarySteps {
+	CompiledPointStep pointSlots, pointSlotConstant, pointConstantSlot;
+	CompiledBlockStep blockSlots, blockSlotConstant, blockConstantSlot;
+};
+
+template <class Op> static BinarySteps binarySteps() {
+	BinarySteps steps = {
+		pointSlots<Op>, pointSlotConstant<Op>, pointConstantSlot<Op>,
+		blockSlots<Op>, blockSlotConstant<Op>, blockConstantSlot<Op>
+	};
+	return steps;
+}
+
+// Runs a point step on known operands, so that folding uses exactly the arithmetic the step would have
+static double fold(CompiledPointStep point, double left, double right) {
+	double slots[3] = { 0, left, right };
+	CompiledStep step = { point, NULL, 0, 1, 2, 0 };
+	point(step, slots);
+	return slots[0];
+}
+
+// What compiling one tree keeps track of besides the steps themselves
+struct CompileState {
+	int variable;
+	Evaluator bindings; // Only looked up in, but Evaluator::tryEvaluate() is not const
+	CommonSubtrees common;
+	std::vector<int> entrySlots; // Slot holding each repeated subtree of common once it is computed, or -1
+	std::vector<size_t> pendingReads; // Steps still to read each slot; it is free again once this reaches 0
+	std::vector<int> freeSlots;
+
+	CompileState(const ASTNode* ast, int t_variable, const Evaluator& t_bindings);
+	void release(int slot);
+};
+
+// Constructor
+CompileState::CompileState(const ASTNode* ast, int t_variable, const Evaluator& t_bindings) : bindings(t_bindings), common(ast) {
+	this->variable = t_variable;
+	this->pendingReads.push_back(0); // Slot 0 holds the variable and is never released
+}
+
+void CompileState::release(int slot) {
+	if (slot > 0 && --pendingReads[slot] == 0) {
+		freeSlots.push_back(slot);
+	}
+}
+
+// Constructor
+CompiledFunction::CompiledFunction() {
+	this->slotCount = 1;
+	this->resultSlot = -1;
+	this->resultValue = 0;
+}
+
+// Constructor
+CompiledFunction::CompiledFunction(const ASTNode* ast, int variable, const Evaluator& bindings) {
+	CompileState state(ast, variable, bindings);
+	this->slotCount = 1;
+	this->resultValue = 0;
+	this->resultSlot = compile(ast, state, resultValue);
+}
+
+// Appends a step whose result goes to a free slot and returns that slot, which is expected to be read once
+// The operand slots are released first, so the step may write over an operand that nothing after it reads
+int CompiledFunction::addStep(CompiledPointStep point, CompiledBlockStep block, int left, int right, double constant, CompileState& state) {
+	state.release(left);
+	state.release(right);
+
+	int target;
+	if (state.freeSlots.empty()) {
+		target = (int)slotCount++;
+		state.pendingReads.push_back(1);
+	}
+	else {
+		target = state.freeSlots.back();
+		state.freeSlots.pop_back();
+		state.pendingReads[target] = 1;
+	}
+
+	CompiledStep step = { point, block, target, left, right, constant };
+	steps.push_back(step);
+	return target;
+}
+
+// Emits the steps for ast in post-order and returns the slot holding its value, or -1 with value set if the
+// subtree does not depend on the variable
+int CompiledFunction::compile(const ASTNode* ast, CompileState& state, double& value) {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	// A repeated subtree is compiled where it is first used; later copies read its slot, which is kept until the last
+	int entry = state.common.find(ast);
+	if (entry >= 0 && state.common.uses(entry) > 1) {
+		if (state.entrySlots.empty()) {
+			state.entrySlots.resize(state.common.size(), -1);
+		}
+		if (state.entrySlots[entry] >= 0) {
+			return state.entrySlots[entry];
+		}
+		int slot = compileNode(ast, state, value);
+		if (slot > 0) {
+			state.entrySlots[entry] = slot;
+			state.pendingReads[slot] = state.common.uses(entry);
+		}
+		return slot;
+	}
+	return compileNode(ast, state, value);
+}
+
+// Compiles ast itself, whether or not it is repeated
+int CompiledFunction::compileNode(const ASTNode* ast, CompileState& state, double& value) {
+	int variable = state.variable;
+
+	switch (ast->type) {
+	case numberValue:
+		value = ast->value;
+		return -1;
+	case variableChar:
+		if (ast->symbol == variable) {
+			return 0;
+		}
+		if (!state.bindings.tryEvaluate(ast, value)) {
+			throw EvaluatorException("Variable '" + SymbolTable::name(ast->symbol) + "' has no value");
+		}
+		return -1;
+	default:
+		break;
+	}
+
+	CompiledPointStep point = NULL;
+	CompiledBlockStep block = NULL;
+	switch (ast->type) {
+	case unaryMinus: point = pointUnary<Negate>; block = blockUnary<Negate>; break;
+	case functionSin: point = pointUnary<Sin>; block = blockUnary<Sin>; break;
+	case functionCos: point = pointUnary<Cos>; block = blockUnary<Cos>; break;
+	case functionTan: point = pointUnary<Tan>; block = blockUnary<Tan>; break;
+	case functionSec: point = pointUnary<Sec>; block = blockUnary<Sec>; break;
+	case functionCsc: point = pointUnary<Csc>; block = blockUnary<Csc>; break;
+	case functionCot: point = pointUnary<Cot>; block = blockUnary<Cot>; break;
+	case functionLn: point = pointUnary<Ln>; block = blockUnary<Ln>; break;
+	default: break;
+	}
+	if (point != NULL) {
+		double argument;
+		int slot = compile(ast->left, state, argument);
+		if (slot < 0) {
+			value = fold(point, argument, 0);
+			return -1;
+		}
+		return addStep(point, block, slot, 0, 0, state);
+	}
+
+	BinarySteps binary;
+	switch (ast->type) {
+	case operatorPlus: binary = binarySteps<Add>(); break;
+	case operatorMinus: binary = binarySteps<Subtract>(); break;
+	case operatorMul: binary = binarySteps<Multiply>(); break;
+	case operatorDivision: binary = binarySteps<Divide>(); break;
+	case operatorPower: binary = binarySteps<Power>(); break;
+	case functionLog: binary = binarySteps<Log>(); break;
+	default: throw EvaluatorException("Incorrect syntax tree.");
+	}
+
+	double leftValue, rightValue;
+	int left = compile(ast->left, state, leftValue);
+	int right = compile(ast->right, state, rightValue);
+	if (left < 0 && right < 0) {
+		value = fold(binary.pointSlots, leftValue, rightValue);
+		return -1;
+	}
+	if (left < 0) {
+		if (ast->type == functionLog) {
+			return addStep(pointConstantSlot<LogKnownBase>, blockConstantSlot<LogKnownBase>, 0, right, log(leftValue), state);
+		}
+		return addStep(binary.pointConstantSlot, binary.blockConstantSlot, 0, right, leftValue, state);
+	}
+	if (right < 0) {
+		if (ast->type == operatorPower && rightValue == 2) {
+			return addStep(pointUnary<Square>, blockUnary<Square>, left, 0, 0, state);
+		}
+		return addStep(binary.pointSlotConstant, binary.blockSlotConstant, left, 0, rightValue, state);
+	}
+	return addStep(binary.pointSlots, binary.blockSlots, left, right, 0, state);
+}
+
+double CompiledFunction::evaluate(double x) const {
+	if (resultSlot < 0) {
+		return resultValue;
+	}
+
+	double stackSlots[COMPILED_STACK_SLOTS];
+	std::vector<double> heapSlots;
+	double* slots = stackSlots;
+	if (slotCount > COMPILED_STACK_SLOTS) {
+		heapSlots.resize(slotCount);
+		slots = &heapSlots[0];
+	}
+
+	slots[0] = x;
+	for (size_t i = 0; i < steps.size(); i++) {
+		steps[i].point(steps[i], slots);
+	}
+	return slots[resultSlot];
+}
+
+void CompiledFunction::evaluateBatch(const double* points, double* results, size_t count) const {
+	if (resultSlot < 0) {
+		for (size_t i = 0; i < count; i++) results[i] = resultValue;
+		return;
+	}
+
+	double stackSlots[COMPILED_STACK_SLOTS * COMPILED_BLOCK_SIZE];
+	std::vector<double> heapSlots;
+	double* slots = stackSlots;
+	if (slotCount > COMPILED_STACK_SLOTS) {
+		heapSlots.resize(slotCount * COMPILED_BLOCK_SIZE);
+		slots = &heapSlots[0];
+	}
+
+	const double* result = slots + resultSlot * COMPILED_BLOCK_SIZE;
+	for (size_t first = 0; first < count; first += COMPILED_BLOCK_SIZE) {
+		size_t block = (count - first < COMPILED_BLOCK_SIZE) ? count - first : COMPILED_BLOCK_SIZE;
+		memcpy(slots, points + first, block * sizeof(double));
+		for (size_t i = 0; i < steps.size(); i++) {
+			steps[i].block(steps[i], slots, block);
+		}
+		memcpy(results + first, result, block * sizeof(double));
+	}
+}
+
+size_t CompiledFunction::size() const {
+	return steps.size();
+}
+
+// Cache keys spell out the tree exactly: a node type byte per node in pre-order, followed by the raw bits of a
+// number or the symbol id of a variable. Formatted text would not do, as it rounds numbers.
+static void appendKey(const ASTNode* ast, std::string& key) {
+	if (ast == NULL) {
+		key.push_back('\xff');
+		return;
+	}
+	key.push_back((char)ast->type);
+	if (ast->type == numberValue) {
+		key.append((const char*)&ast->value, sizeof(ast->value));
+	}
+	else if (ast->type == variableChar) {
+		key.append((const char*)&ast->symbol, sizeof(ast->symbol));
+	}
+	else {
+		appendKey(ast->left, key);
+		appendKey(ast->right, key);
+	}
+}
+
+struct FunctionCache {
+	std::mutex mutex;
+	std::unordered_map<std::string, const CompiledFunction*> functions;
+};
+
+// Created on first use, and never destroyed so that it outlives any thread still using an entry
+static FunctionCache& functionCache() {
+	static FunctionCache* cache = new FunctionCache;
+	return *cache;
+}
+
+const CompiledFunction* CompiledFunction::cached(const ASTNode* ast, int variable) {
+	if (ast == NULL || (ast->variables & ~symbolBit(variable)) != 0) {
+		return NULL;
+	}
+
+	// Reused by the thread's next lookup, so that a cache hit does not allocate
+	static thread_local std::string key;
+	key.assign((const char*)&variable, sizeof(variable));
+	appendKey(ast, key);
+
+	FunctionCache& cache = functionCache();
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		std::unordered_map<std::string, const CompiledFunction*>::const_iterator found = cache.functions.find(key);
+		if (found != cache.functions.end()) {
+			return found->second;
+		}
+		if (cache.functions.size() >= MAX_CACHED_FUNCTIONS) {
+			return NULL;
+		}
+	}
+
+	// Compiled without the lock held; symbol ids past the last dependency bit share it, so the check above can let
+	// through a tree that uses another variable, which compiling against no bindings catches
+	CompiledFunction* function;
+	try {
+		function = new CompiledFunction(ast, variable, Evaluator());
+	}
+	catch (const EvaluatorException&) {
+		return NULL;
+	}
+
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	if (cache.functions.size() >= MAX_CACHED_FUNCTIONS && cache.functions.count(key) == 0) {
+		delete function;
+		return NULL;
+	}
+	std::pair<std::unordered_map<std::string, const CompiledFunction*>::iterator, bool> inserted = cache.functions.insert(std::make_pair(key, (const CompiledFunction*)function));
+	if (!inserted.second) {
+		delete function; // Another thread compiled the same tree meanwhile
+	}
+	return inserted.first->second;
+}
+
+size_t CompiledFunction::cachedCount() {
+	FunctionCache& cache = functionCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.functions.size();
+}
@@ -0,0 +1,88 @@
+/*
+* Declares the CompiledFunction class, which turns an AST into a function of one variable that can be called many
+* times without walking the tree again.
+*
+* Compiling folds every subtree that does not depend on the variable into a number (other variables take their
+* bound values at that point) and lays the rest out as a flat list of steps. Each step is a call through a function
+* pointer picked for its operator and the shape of its operands, so there is no switch on the node type and no
+* recursion left when the function runs. A subtree that occurs more than once (see commonsubtrees.h) is computed
+* once and its slot read wherever it is used, so "sin(x^2)*cos(x^2)" squares x only once. Values live in numbered
+* slots that are reused once every step that needs them has run; evaluateBatch() gives every slot a block of points,
+* like Evaluator::evaluateBatch().
+*
+* The arithmetic is Evaluator's, except that x^2 is computed as x*x, which can differ from pow() in the last bit.
+* A CompiledFunction never changes after it is built, so one object can be used by any number of threads at once.
+*
+*  Sample usage:
+*   const CompiledFunction* f = CompiledFunction::cached(ast, SymbolTable::letter('x'));
+*   double value = f->evaluate(2.0);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_COMPILEDFUNCTION_H_
+#define SCALP_COMPILEDFUNCTION_H_
+
+#include "ast.h"
+#include "evaluator.h"
+#include <vector>
+
+// Points evaluateBatch() works on at a time
+const size_t COMPILED_BLOCK_SIZE = EVALUATOR_BATCH_SIZE;
+
+// Functions needing more slots than this keep them on the heap while they run instead of on the stack
+const size_t COMPILED_STACK_SLOTS = 64;
+
+// The most functions cached() keeps; once it is full, new expressions are not cached
+const size_t MAX_CACHED_FUNCTIONS = 4096;
+
+struct CompiledStep;
+struct CompileState;
+typedef void (*CompiledPointStep)(const CompiledStep& step, double* slots);
+typedef void (*CompiledBlockStep)(const CompiledStep& step, double* slots, size_t count);
+
+struct CompiledStep {
+	CompiledPointStep point;
+	CompiledBlockStep block;
+	int target; // Slot the step writes
+	int left, right; // Slots the step reads; unused ones are 0
+	double constant; // The operand that was known at compile time, for steps that take one
+};
+
+class CompiledFunction
+{
+	std::vector<CompiledStep> steps;
+	size_t slotCount; // Slot 0 holds the variable
+	int resultSlot; // -1 if the whole function folded into resultValue
+	double resultValue;
+
+	int compile(const ASTNode* ast, CompileState& state, double& value);
+	int compileNode(const ASTNode* ast, CompileState& state, double& value);
+	int addStep(CompiledPointStep point, CompiledBlockStep block, int left, int right, double constant, CompileState& state);
+
+public:
+	// The function that is 0 everywhere
+	CompiledFunction();
+
+	// Compiles ast as a function of the variable with symbol id variable (see symbols.h)
+	// Other variables take the values bound in bindings; throws an EvaluatorException if one has no value or the
+	// tree is malformed, where Evaluator would only throw once it got there.
+	CompiledFunction(const ASTNode* ast, int variable, const Evaluator& bindings);
+
+	double evaluate(double x) const;
+
+	// Writes the value at points[i] to results[i] for every i below count
+	void evaluateBatch(const double* points, double* results, size_t count) const;
+
+	// Number of steps one evaluation runs; 0 if the function is a constant or just the variable
+	size_t size() const;
+
+	// The compiled form of ast as a function of variable, compiled the first time an identical tree is asked for and
+	// shared by every caller and thread after that; entries are never removed. Returns NULL if ast uses any other
+	// variable (its value would depend on bindings), cannot be compiled, or is new while the cache is full.
+	static const CompiledFunction* cached(const ASTNode* ast, int variable);
+
+	// Number of functions cached() holds
+	static size_t cachedCount();
+};
+
+#endif // SCALP_COMPILEDFUNCTION_H_
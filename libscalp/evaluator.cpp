@@ -0,0 +1,230 @@
+/*
+* Implements the Evaluator class in evaluator.h
+*/
+
+#include "evaluator.h"
+#include "stats.h"
+#include "symbols.h"
+#include <cmath>
+
+void Evaluator::bind(int symbol, double value) {
+	if (symbol < 0) {
+		return;
+	}
+	if ((size_t)symbol >= values.size()) {
+		values.resize(symbol + 1, 0);
+		bound.resize(symbol + 1, false);
+	}
+	values[symbol] = value;
+	bound[symbol] = true;
+}
+
+void Evaluator::unbindAll() {
+	values.clear();
+	bound.clear();
+}
+
+bool Evaluator::lookup(int symbol, double& value) const {
+	if (symbol < 0 || (size_t)symbol >= bound.size() || !bound[symbol]) {
+		return false;
+	}
+	value = values[symbol];
+	return true;
+}
+
+// Applies the operator or function of a node to the values of its children
+// Unary functions only use value1; log has its base in value1 and its argument in value2
+double Evaluator::apply(ASTNodeType type, double value1, double value2) const {
+	switch (type) {
+	case operatorPlus: return value1 + value2;
+	case operatorMinus: return value1 - value2;
+	case operatorMul: return value1 * value2;
+	case operatorDivision: return value1 / value2;
+	case operatorPower: return pow(value1, value2);
+	case functionSin: return sin(value1);
+	case functionCos: return cos(value1);
+	case functionTan: return tan(value1);
+	case functionSec: return 1 / cos(value1);
+	case functionCsc: return 1 / sin(value1);
+	case functionCot: return cos(value1) / sin(value1);
+	case functionLog: return log(value2) / log(value1);
+	case functionLn: return log(value1);
+	default: return 0;
+	}
+}
+
+static bool isBinary(ASTNodeType type) {
+	return type == operatorPlus || type == operatorMinus || type == operatorMul || type == operatorDivision || type == operatorPower || type == functionLog;
+}
+
+static bool isUnaryFunction(ASTNodeType type) {
+	return type == functionSin || type == functionCos || type == functionTan || type == functionSec || type == functionCsc || type == functionCot || type == functionLn;
+}
+
+// This is a recursive function that traverses the abstract syntax tree
+// that is passed in and returns a double that is the evaluation of the 
+// expression that the abstract syntax tree represent.
+double Evaluator::evaluateSubtree(ASTNode* ast) {
+
+	// If ast is NULL, something has gone wrong
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	// If ast is a number, simply return that number
+	if (ast->type == numberValue) {
+		return ast->value;
+	}
+
+	// If ast is a variable, return the value bound to it
+	else if (ast->type == variableChar) {
+		double value;
+		if (!lookup(ast->symbol, value)) {
+			throw EvaluatorException("Variable '" + SymbolTable::name(ast->symbol) + "' has no value");
+		}
+		return value;
+	}
+
+	// If ast is a unaryMinus type, traverse down the tree
+	// by calling this function for ast->left
+	// Return the value that function returns, negated
+	else if (ast->type == unaryMinus) {
+		return -evaluateSubtree(ast->left);
+	}
+
+	// If ast is a function of one argument, traverse down ast->left only
+	else if (isUnaryFunction(ast->type)) {
+		return apply(ast->type, evaluateSubtree(ast->left), 0);
+	}
+
+	// Otherwise, traverse down the tree
+	// by calling this function for ast->left and ast->right.
+	else if (isBinary(ast->type)) {
+		double value1 = evaluateSubtree(ast->left);
+		double value2 = evaluateSubtree(ast->right);
+		return apply(ast->type, value1, value2);
+	}
+
+	throw EvaluatorException("Incorrect syntax tree.");
+}
+// Mirrors evaluateSubtree(): returns false exactly where that would throw
+bool Evaluator::tryEvaluateSubtree(const ASTNode* ast, double& value) {
+	if (ast == NULL) {
+		return false;
+	}
+	if (ast->type == numberValue) {
+		value = ast->value;
+		return true;
+	}
+	if (ast->type == variableChar) {
+		return lookup(ast->symbol, value);
+	}
+	if (ast->type == unaryMinus) {
+		if (!tryEvaluateSubtree(ast->left, value)) return false;
+		value = -value;
+		return true;
+	}
+	if (isUnaryFunction(ast->type)) {
+		if (!tryEvaluateSubtree(ast->left, value)) return false;
+		value = apply(ast->type, value, 0);
+		return true;
+	}
+	if (!isBinary(ast->type)) {
+		return false;
+	}
+
+	double value1, value2;
+	if (!tryEvaluateSubtree(ast->left, value1) || !tryEvaluateSubtree(ast->right, value2)) {
+		return false;
+	}
+	value = apply(ast->type, value1, value2);
+	return true;
+}
+
+bool Evaluator::tryEvaluate(const ASTNode* ast, double& value) {
+	double result;
+	if (!tryEvaluateSubtree(ast, result)) {
+		return false;
+	}
+	value = result;
+	return true;
+}
+
+// The main method of the evaluator class
+double Evaluator::evaluate(ASTNode* ast) {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+	return evaluateSubtree(ast);
+}
+
+// Evaluates ast at count (at most EVALUATOR_BATCH_SIZE) points into the scratch block for level
+// A left operand shares its parent's block and a right operand uses the next one, so a tree needs one block per
+// level of right operands rather than one per node
+void Evaluator::evaluateBlock(const ASTNode* ast, int variable, const double* points, size_t count, size_t level) {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	if (ast->type == numberValue || (ast->type == variableChar && ast->symbol != variable)) {
+		double value = ast->value;
+		if (ast->type == variableChar && !lookup(ast->symbol, value)) {
+			throw EvaluatorException("Variable '" + SymbolTable::name(ast->symbol) + "' has no value");
+		}
+		double* results = &scratch[level * EVALUATOR_BATCH_SIZE];
+		for (size_t i = 0; i < count; i++) results[i] = value;
+	}
+	else if (ast->type == variableChar) {
+		double* results = &scratch[level * EVALUATOR_BATCH_SIZE];
+		for (size_t i = 0; i < count; i++) results[i] = points[i];
+	}
+	else if (ast->type == unaryMinus) {
+		evaluateBlock(ast->left, variable, points, count, level);
+		double* results = &scratch[level * EVALUATOR_BATCH_SIZE];
+		for (size_t i = 0; i < count; i++) results[i] = -results[i];
+	}
+	else if (isUnaryFunction(ast->type)) {
+		evaluateBlock(ast->left, variable, points, count, level);
+		double* results = &scratch[level * EVALUATOR_BATCH_SIZE];
+		for (size_t i = 0; i < count; i++) results[i] = apply(ast->type, results[i], 0);
+	}
+	else if (isBinary(ast->type)) {
+		evaluateBlock(ast->left, variable, points, count, level);
+		if (scratch.size() < (level + 2) * EVALUATOR_BATCH_SIZE) {
+			scratch.resize((level + 2) * EVALUATOR_BATCH_SIZE);
+		}
+		evaluateBlock(ast->right, variable, points, count, level + 1);
+
+		// Only now that both operands are done can the blocks be addressed, since the recursion may grow scratch
+		double* results = &scratch[level * EVALUATOR_BATCH_SIZE];
+		const double* right = &scratch[(level + 1) * EVALUATOR_BATCH_SIZE];
+		switch (ast->type) {
+		case operatorPlus: for (size_t i = 0; i < count; i++) results[i] += right[i]; break;
+		case operatorMinus: for (size_t i = 0; i < count; i++) results[i] -= right[i]; break;
+		case operatorMul: for (size_t i = 0; i < count; i++) results[i] *= right[i]; break;
+		case operatorDivision: for (size_t i = 0; i < count; i++) results[i] /= right[i]; break;
+		default: for (size_t i = 0; i < count; i++) results[i] = apply(ast->type, results[i], right[i]); break;
+		}
+	}
+	else {
+		throw EvaluatorException("Incorrect syntax tree.");
+	}
+}
+
+void Evaluator::evaluateBatch(const ASTNode* ast, int variable, const double* points, double* results, size_t count) {
+	if (scratch.size() < EVALUATOR_BATCH_SIZE) {
+		scratch.resize(EVALUATOR_BATCH_SIZE);
+	}
+	for (size_t first = 0; first < count; first += EVALUATOR_BATCH_SIZE) {
+		size_t block = (count - first < EVALUATOR_BATCH_SIZE) ? count - first : EVALUATOR_BATCH_SIZE;
+		evaluateBlock(ast, variable, points + first, block, 0);
+		for (size_t i = 0; i < block; i++) {
+			results[first + i] = scratch[i];
+		}
+	}
+}
+
+// EvaluatorException derived from std::runtime_error, which keeps a copy of the message for what()
+EvaluatorException::EvaluatorException(const std::string& message) : std::runtime_error(message) {
+	Stats::count(counterExceptions);
+}
@@ -0,0 +1,62 @@
+/*
+* Declares a Evaluator class, which takes in a AST and splits out the evaluated form of the expression
+* that the AST represents.
+*
+* Variables have no value until one is bound to them with bind(); evaluating an unbound variable is an error.
+*
+*  Sample usage:
+*   Evaluator evaluator;
+*   evaluator.bind(SymbolTable::intern("x"), 2.0);
+*   double value = evaluator.evaluate(ast);
+*/
+
+//#define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_EVALUATOR_H_
+#define SCALP_EVALUATOR_H_
+
+#include "ast.h"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Points evaluateBatch() works on at a time
+const size_t EVALUATOR_BATCH_SIZE = 16;
+
+class Evaluator
+{
+	// Value bound to each symbol id, and whether one has been bound at all
+	std::vector<double> values;
+	std::vector<bool> bound;
+
+	// One block of EVALUATOR_BATCH_SIZE values per level of right operands that evaluateBatch() is inside of
+	std::vector<double> scratch;
+
+	bool lookup(int symbol, double& value) const;
+	double apply(ASTNodeType type, double value1, double value2) const;
+	double evaluateSubtree(ASTNode* ast);
+	bool tryEvaluateSubtree(const ASTNode* ast, double& value);
+	void evaluateBlock(const ASTNode* ast, int variable, const double* points, size_t count, size_t level);
+public:
+	// Gives the variable with symbol id symbol (see symbols.h) a value for every evaluation from now on
+	void bind(int symbol, double value);
+	void unbindAll();
+
+	double evaluate(ASTNode* ast);
+
+	// Same as evaluate(), but reports failure by returning false instead of throwing; value is only set on success
+	// Use this where a subtree that cannot be evaluated (for instance one containing a variable) is a normal case
+	bool tryEvaluate(const ASTNode* ast, double& value);
+
+	// Evaluates ast at count values of the variable with symbol id variable, writing the value at points[i] to
+	// results[i]; other variables keep their bound values. Walking the tree once per block of points instead of once
+	// per point is what makes sampling an integrand (see quadrature.h) cheap. Throws where evaluate() would.
+	void evaluateBatch(const ASTNode* ast, int variable, const double* points, double* results, size_t count);
+};
+
+class EvaluatorException : public std::runtime_error
+{
+public:
+	EvaluatorException(const std::string& message);
+};
+
+#endif //SCALP_EVALUATOR_H_
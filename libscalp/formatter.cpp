@@ -0,0 +1,166 @@
+/*
+* Implements the Formatter class in formatter.h
+* See comments in formatter.h for more details
+*/
+
+#include "formatter.h"
+#include "commonsubtrees.h"
+#include "symbols.h"
+#include <cstdio>
+#include <vector>
+
+const char* FORMATTED_FUNCTIONS[] = { "sin(", "cos(", "tan(", "sec(", "csc(", "cot(", "log(", "ln(" };
+const char FORMATTED_OPERATORS[] = "?+-*/^";
+
+// Appends text to buffer[length..capacity) and returns the new length
+static size_t append(char* buffer, size_t length, size_t capacity, const char* text) {
+	while (*text != 0 && length + 1 < capacity) {
+		buffer[length++] = *text++;
+	}
+	buffer[length] = 0;
+	return length;
+}
+
+size_t Formatter::formatInto(const ASTNode* ast, char* buffer, size_t length, size_t capacity) {
+	if (ast == NULL) {
+		return append(buffer, length, capacity, "?");
+	}
+
+	char text[32];
+	switch (ast->type) {
+	case numberValue:
+		snprintf(text, sizeof(text), "%.15g", ast->value);
+		return append(buffer, length, capacity, text);
+	case variableChar:
+		return append(buffer, length, capacity, SymbolTable::name(ast->symbol).c_str());
+	case unaryMinus:
+		length = append(buffer, length, capacity, "(-");
+		length = formatInto(ast->left, buffer, length, capacity);
+		return append(buffer, length, capacity, ")");
+	case operatorPlus: case operatorMinus: case operatorMul: case operatorDivision: case operatorPower:
+		text[0] = FORMATTED_OPERATORS[ast->type]; text[1] = 0;
+		length = append(buffer, length, capacity, "(");
+		length = formatInto(ast->left, buffer, length, capacity);
+		length = append(buffer, length, capacity, text);
+		length = formatInto(ast->right, buffer, length, capacity);
+		return append(buffer, length, capacity, ")");
+	case functionSin: case functionCos: case functionTan: case functionSec: case functionCsc: case functionCot:
+	case functionLog: case functionLn:
+		length = append(buffer, length, capacity, FORMATTED_FUNCTIONS[ast->type - functionSin]);
+		length = formatInto(ast->left, buffer, length, capacity);
+		// Logs keep their base on the left and their argument on the right
+		if (ast->right != NULL) {
+			length = append(buffer, length, capacity, ",");
+			length = formatInto(ast->right, buffer, length, capacity);
+		}
+		return append(buffer, length, capacity, ")");
+	default:
+		return append(buffer, length, capacity, "?");
+	}
+}
+
+std::string Formatter::format(const ASTNode* ast) {
+	// Grow until the text fits; a tree of n nodes rarely needs more than about 8n characters
+	std::string text(256, '\0');
+	while (true) {
+		size_t length = formatInto(ast, &text[0], 0, text.size());
+		if (length + 1 < text.size()) {
+			text.resize(length);
+			return text;
+		}
+		text.assign(text.size() * 4, '\0');
+	}
+}
+
+// What formatShared() knows about the repeated subtrees of one tree
+struct SharedNames {
+	const CommonSubtrees* common;
+	std::vector<int> names; // Temporary number of each entry of common, -1 once it was found not worth naming, else 0
+	std::string definitions;
+	int count;
+};
+
+// Appends the text of ast to text like formatInto() does, writing the repeated subtrees as temporaries
+// A repeated subtree is formatted where it first occurs and then named if that shortens the whole: its uses copies
+// of length characters become uses names, plus one definition "$k=<text>, "
+static void appendShared(const ASTNode* ast, SharedNames& shared, std::string& text) {
+	int entry = shared.common->find(ast);
+	size_t uses = shared.common->uses(entry);
+	if (uses > 1 && shared.names[entry] != 0) {
+		if (shared.names[entry] > 0) {
+			text += "$" + std::to_string(shared.names[entry]);
+			return;
+		}
+		uses = 1; // Found not worth naming; write it out again
+	}
+
+	std::string own;
+	std::string& out = (uses > 1) ? own : text;
+	char number[32];
+	switch (ast->type) {
+	case numberValue:
+		snprintf(number, sizeof(number), "%.15g", ast->value);
+		out += number;
+		break;
+	case variableChar:
+		out += SymbolTable::name(ast->symbol);
+		break;
+	case unaryMinus:
+		out += "(-";
+		appendShared(ast->left, shared, out);
+		out += ")";
+		break;
+	case operatorPlus: case operatorMinus: case operatorMul: case operatorDivision: case operatorPower:
+		out += "(";
+		appendShared(ast->left, shared, out);
+		out += FORMATTED_OPERATORS[ast->type];
+		appendShared(ast->right, shared, out);
+		out += ")";
+		break;
+	case functionSin: case functionCos: case functionTan: case functionSec: case functionCsc: case functionCot:
+	case functionLog: case functionLn:
+		out += FORMATTED_FUNCTIONS[ast->type - functionSin];
+		appendShared(ast->left, shared, out);
+		if (ast->right != NULL) {
+			out += ",";
+			appendShared(ast->right, shared, out);
+		}
+		out += ")";
+		break;
+	default:
+		out += "?";
+		break;
+	}
+	if (uses <= 1) {
+		return;
+	}
+
+	std::string name = "$" + std::to_string(shared.count + 1);
+	if (uses * own.size() <= uses * name.size() + name.size() + own.size() + 3) {
+		shared.names[entry] = -1;
+		text += own;
+		return;
+	}
+	shared.names[entry] = ++shared.count;
+	shared.definitions += (shared.count > 1) ? ", " : "";
+	shared.definitions += name + "=" + own;
+	text += name;
+}
+
+std::string Formatter::formatShared(const ASTNode* ast) {
+	if (ast == NULL) {
+		return "?";
+	}
+	CommonSubtrees common(ast);
+	if (common.repeated() == 0) {
+		return format(ast);
+	}
+
+	SharedNames shared;
+	shared.common = &common;
+	shared.names.assign(common.size(), 0);
+	shared.count = 0;
+	std::string text;
+	appendShared(ast, shared, text);
+	return (shared.count == 0) ? text : "let " + shared.definitions + " in " + text;
+}
@@ -0,0 +1,38 @@
+/*
+* Declares a Formatter class, which turns an AST back into text in one canonical form, so that trees can be compared
+* as strings (for instance against the expected answers of the golden corpus, see Tester::runCorpus).
+*
+* Every operator and unary minus is wrapped in parentheses, numbers are written with up to 15 significant digits and
+* there is no whitespace: "x+6*3" is written "(x+(6*3))" and "log(5, x)" is written "log(5,x)".
+*
+* formatShared() writes the same text, but names subtrees that occur more than once when that makes the text shorter:
+* "let $1=sin((x^2)+1) in (($1*$1)+$1)". Each temporary is defined before the first one that uses it.
+*
+*  Sample usage:
+*   Formatter formatter;
+*   std::cout << formatter.format(ast);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_FORMATTER_H_
+#define SCALP_FORMATTER_H_
+
+#include "ast.h"
+#include <string>
+
+class Formatter
+{
+public:
+	// Returns the canonical text of ast
+	std::string format(const ASTNode* ast);
+
+	// Appends the canonical text of ast to buffer, which already holds length characters, without allocating
+	// The text is cut off when the buffer (capacity bytes including the terminating 0) is full; returns the new length
+	static size_t formatInto(const ASTNode* ast, char* buffer, size_t length, size_t capacity);
+
+	// Returns the canonical text of ast with repeated subtrees written once as temporaries $1, $2 and so on, in a
+	// "let <name>=<text>, ... in <text>" form; the same as format() if no subtree is worth naming
+	std::string formatShared(const ASTNode* ast);
+};
+
+#endif // SCALP_FORMATTER_H_
@@ -0,0 +1,102 @@
+/*
+* Implements Fraction in fraction.h
+* See comments in fraction.h for more details
+*/
+
+#include "fraction.h"
+#include <climits>
+#include <cstdlib>
+
+static long long greatestDivisor(long long a, long long b) {
+	a = llabs(a); b = llabs(b);
+	while (b != 0) {
+		long long rest = a % b;
+		a = b;
+		b = rest;
+	}
+	return a;
+}
+
+static bool productFits(long long a, long long b) {
+	return a == 0 || llabs(b) <= LLONG_MAX / llabs(a);
+}
+
+static bool sumFits(long long a, long long b) {
+	return (b > 0) ? a <= LLONG_MAX - b : a >= -LLONG_MAX - b;
+}
+
+Fraction fraction(long long numerator, long long denominator) {
+	if (denominator < 0) {
+		numerator = -numerator;
+		denominator = -denominator;
+	}
+	long long divisor = greatestDivisor(numerator, denominator);
+	Fraction result = { numerator / divisor, denominator / divisor };
+	return result;
+}
+
+bool multiply(Fraction a, Fraction b, Fraction& result) {
+	long long divisor = greatestDivisor(a.numerator, b.denominator);
+	a.numerator /= divisor; b.denominator /= divisor;
+	divisor = greatestDivisor(b.numerator, a.denominator);
+	b.numerator /= divisor; a.denominator /= divisor;
+	if (!productFits(a.numerator, b.numerator) || !productFits(a.denominator, b.denominator)) {
+		return false;
+	}
+	result.numerator = a.numerator * b.numerator;
+	result.denominator = a.denominator * b.denominator;
+	return true;
+}
+
+bool add(Fraction a, Fraction b, Fraction& result) {
+	// Over the least common denominator, so the products stay as small as they can
+	long long divisor = greatestDivisor(a.denominator, b.denominator);
+	long long aScale = b.denominator / divisor, bScale = a.denominator / divisor;
+	if (!productFits(a.numerator, aScale) || !productFits(b.numerator, bScale) || !productFits(a.denominator, aScale)) {
+		return false;
+	}
+	long long left = a.numerator * aScale, right = b.numerator * bScale;
+	if (!sumFits(left, right)) {
+		return false;
+	}
+	result = fraction(left + right, a.denominator * aScale);
+	return true;
+}
+
+// Whether factor needs parentheses to take a coefficient or a divisor: "sin(x)^2" does, "ln(sin(x)+1)" does not
+static bool needsParentheses(const std::string& factor) {
+	int depth = 0;
+	for (size_t i = 0; i < factor.size(); i++) {
+		if (factor[i] == '(') depth++;
+		else if (factor[i] == ')') depth--;
+		else if (depth == 0 && (factor[i] == '^' || factor[i] == '*')) return true;
+	}
+	return false;
+}
+
+std::string formatTerms(const std::vector<Fraction>& coefficients, const std::vector<std::string>& factors) {
+	std::string text;
+	for (size_t i = 0; i < factors.size(); i++) {
+		const Fraction& c = coefficients[i];
+		if (i == 0) {
+			text += (c.numerator < 0) ? "-" : "";
+		}
+		else {
+			text += (c.numerator < 0) ? " - " : " + ";
+		}
+		bool scaled = llabs(c.numerator) != 1 || c.denominator != 1;
+		if (llabs(c.numerator) != 1 || factors[i].empty()) {
+			text += std::to_string(llabs(c.numerator));
+		}
+		text += (scaled && needsParentheses(factors[i])) ? "(" + factors[i] + ")" : factors[i];
+		if (c.denominator != 1) {
+			text += "/" + std::to_string(c.denominator);
+		}
+	}
+
+	if (text.empty()) {
+		return "0";
+	}
+	bool leadingNumber = text[0] >= '0' && text[0] <= '9';
+	return (factors.size() > 1 || text[0] == '-' || leadingNumber) ? "(" + text + ")" : text;
+}
@@ -0,0 +1,36 @@
+/*
+* Declares Fraction, the exact rational coefficients of the closed-form integrals in trigintegrals.h and
+* partsintegrals.h, with overflow-checked arithmetic and the text those integrals are written as.
+*
+*  Sample usage:
+*   Fraction half = fraction(1, 2), quarter;
+*   if (!multiply(half, half, quarter)) { ... } // Would not fit in 64 bits
+*   formatTerms(coefficients, factors); // "(x/2 - (sin(x)*cos(x))/2)"
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_FRACTION_H_
+#define SCALP_FRACTION_H_
+
+#include <string>
+#include <vector>
+
+// Always reduced and with a positive denominator
+struct Fraction {
+	long long numerator;
+	long long denominator;
+};
+
+// numerator / denominator in lowest terms; denominator must not be 0
+Fraction fraction(long long numerator, long long denominator);
+
+// Set result to a * b or a + b; return false, leaving result alone, if it would not fit in 64 bits
+bool multiply(Fraction a, Fraction b, Fraction& result);
+bool add(Fraction a, Fraction b, Fraction& result);
+
+// Writes the sum of coefficients[i] times factors[i], such as "-(sin(x)*cos(x))/2 + x/2"; a factor that is a
+// product or a power is put in parentheses when it has a coefficient or a divisor. A sum of more than one term, or
+// one that starts with a minus sign or a number, comes in parentheses so that it can be scaled or subtracted as it is.
+std::string formatTerms(const std::vector<Fraction>& coefficients, const std::vector<std::string>& factors);
+
+#endif // SCALP_FRACTION_H_
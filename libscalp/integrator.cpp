@@ -0,0 +1,401 @@
+/*
+* Implements the Integrator class in integrator.h
+* See comments in integrator.h for more details
+*/
+
+#include "integrator.h"
+#include "analysis.h"
+#include "arena.h"
+#include "budget.h"
+#include "evaluator.h"
+#include "formatter.h"
+#include "interpreter.h"
+#include "interval.h"
+#include "parser.h"
+#include "partsintegrals.h"
+#include "resultcache.h"
+#include "ruleorder.h"
+#include "stats.h"
+#include "substitution.h"
+#include "symbols.h"
+#include "tablerules.h"
+#include "trace.h"
+#include "trigintegrals.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+const std::string TABLE_LOOKUP_FAIL = "ERROR";
+
+// The variable u that substitutions integrate with respect to; a name no one is likely to integrate with themselves
+const char* SUBSTITUTION_VARIABLE = "u_substitution";
+
+const char* INTEGRATOR_RULE_NAMES[INTEGRATOR_RULE_COUNT] = {
+	"constant_sum", "sum", "difference", "unit_factor", "constant_factor", "reciprocal",
+	"power", "variable", "cosine", "constant", "zero", "independent", "independent_factor", "trig_power", "by_parts", "substitution", "table_miss"
+};
+
+// The built-in integrals, tried in order by lookInTable(); see tablerules.h for how patterns and results are written
+// Every pattern has a different kind of node at its root (or, for the numbers, a different value), so no node
+// matches two of them and setRuleOrder() may put them in any order
+typedef TableRules<
+	// (a) 1 / x integrates to ln x
+	TableRule<ruleReciprocal, Div<Number<1>, Var>,
+		Result<Text<'l', 'n', '('>, Name, Text<')'> > >,
+	// (b) x^n integrates to (x^(n + 1)) / (n + 1)
+	TableRule<rulePower, Pow<Var, NonZeroNumber>,
+		Result<Text<'('>, Name, Text<'^'>, Captured<0, 1>, Text<')', '/'>, Captured<0, 1> > >,
+	// (c) x integrates to (x^2) / 2
+	TableRule<ruleVariable, Var,
+		Result<Text<'('>, Name, Text<'^', '2', ')', '/', '2'> > >,
+	// (d) cos x integrates to sin x
+	TableRule<ruleCosine, Cos<Var>,
+		Result<Text<'s', 'i', 'n', '('>, Name, Text<')'> > >,
+	// (e) A non-zero number n integrates to n * x
+	TableRule<ruleConstant, NonZeroNumber,
+		Result<Captured<0>, Name> >,
+	// (f) Zero integrates to nothing
+	TableRule<ruleZero, Number<0>,
+		Result<> >
+> BuiltinTable;
+
+// Counts (and traces) one use of an integration rule on ast
+static inline void applyRule(IntegratorRule rule, const ASTNode* ast) {
+	Stats::countRule(rule);
+	Trace::rule(rule, ast);
+}
+
+// Combines the integral of f with a factor c that does not depend on the variable: c*(integral), or (integral)/c
+static std::string scaleIntegral(const std::string& integral, const ASTNode* factor, bool divide) {
+	if (integral == TABLE_LOOKUP_FAIL) {
+		return integral;
+	}
+	Formatter formatter;
+	if (divide) {
+		return "(" + integral + ")/" + formatter.format(factor);
+	}
+	return formatter.format(factor) + "*(" + integral + ")";
+}
+
+// Puts text in parentheses unless it already is in one pair
+static std::string parenthesized(const std::string& text) {
+	int depth = 0;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '(') depth++;
+		else if (text[i] == ')') depth--;
+		if (depth == 0 && i + 1 < text.size()) {
+			return "(" + text + ")";
+		}
+	}
+	return (text.empty() || text[0] != '(') ? "(" + text + ")" : text;
+}
+
+// n times the integral of f: n written in front of it, as in 2(x^3)/3, but with the integral in parentheses when it
+// is a sum or starts with a number, which n would otherwise only multiply the first term of or run into
+static std::string scaleByCoefficient(double coefficient, const std::string& integral) {
+	if (integral.empty()) {
+		return integral; // The integral of 0, which stays 0
+	}
+	bool wrap = isdigit((unsigned char)integral[0]) || integral[0] == '.';
+	int depth = 0;
+	for (size_t i = 0; i < integral.size() && !wrap; i++) {
+		if (integral[i] == '(') depth++;
+		else if (integral[i] == ')') depth--;
+		else if (depth == 0 && i > 0 && (integral[i] == '+' || integral[i] == '-')) wrap = true;
+	}
+	return formatCoefficient(coefficient) + (wrap ? parenthesized(integral) : integral);
+}
+
+// Constructor
+Integrator::Integrator() {
+	this->cache = NULL;
+	this->tableReordered = false;
+	for (size_t i = 0; i < BuiltinTable::size; i++) {
+		this->tableOrder[i] = (unsigned char)i;
+	}
+}
+
+void Integrator::setCache(ResultCache* t_cache) {
+	this->cache = t_cache;
+}
+
+void Integrator::setQuadratureOptions(const QuadratureOptions& t_options) {
+	quadrature.setOptions(t_options);
+}
+
+void Integrator::setRuleOrder(const RuleOrder& t_order) {
+	size_t count = 0;
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		size_t position = BuiltinTable::indexOf(t_order.at(i));
+		if (position < BuiltinTable::size) {
+			tableOrder[count++] = (unsigned char)position;
+		}
+	}
+
+	// The order the rules are written in is the one the inlined chain of checks already has
+	tableReordered = false;
+	for (size_t i = 0; i < count; i++) {
+		tableReordered = tableReordered || tableOrder[i] != i;
+	}
+}
+
+ASTNode* Integrator::applySafeTransform(ASTNode* t_ast) const {
+	// If ast is NULL, something has gone wrong
+	if (t_ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	ASTNode* ast = t_ast;
+	return ast;
+}
+
+// Integrates f(u) with respect to u for the first substitution u = g(x) that has an answer, and writes g(x) back in
+// for u; outer is smaller than the integrand, since g is a leaf in it, so this always ends
+bool Integrator::integrateBySubstitution(const ASTNode* ast, int variable, std::string& solution) const {
+	static const int substitute = SymbolTable::intern(SUBSTITUTION_VARIABLE);
+	if (substitute < 0) {
+		return false;
+	}
+
+	NodeArena nodes(64);
+	Substitutions found(ast, variable, substitute, nodes);
+	const std::string& name = SymbolTable::name(substitute);
+	for (size_t i = 0; i < found.size(); i++) {
+		const SubstitutionCandidate& candidate = found.candidate(i);
+		std::string integral = (candidate.outer != NULL) ? integrateSubtree(candidate.outer, substitute) : name;
+		if (integral.empty() || integral.find(TABLE_LOOKUP_FAIL) != std::string::npos) {
+			continue;
+		}
+
+		// The canonical text of a subtree is always either atomic or in parentheses, so it can stand in for u as is
+		Formatter formatter;
+		std::string inner = formatter.format(candidate.inner), text;
+		size_t start = 0;
+		for (size_t at = integral.find(name); at != std::string::npos; at = integral.find(name, start)) {
+			text += integral.substr(start, at - start) + inner;
+			start = at + name.size();
+		}
+		text += integral.substr(start);
+
+		// Scales such as 1/6 are written as a division, so that they stay exact
+		double scale = fabs(candidate.scale);
+		long long divisor = 1;
+		while (divisor < 1000 && fabs(scale * divisor - floor(scale * divisor + 0.5)) > 1e-9 * scale * divisor) {
+			divisor++;
+		}
+		if (divisor < 1000) {
+			double numerator = floor(scale * divisor + 0.5);
+			solution = ((numerator != 1) ? formatCoefficient(numerator) : "") + parenthesized(text)
+				+ ((divisor != 1) ? "/" + std::to_string(divisor) : "");
+		}
+		else {
+			solution = formatCoefficient(scale) + parenthesized(text);
+		}
+		solution = (candidate.scale < 0) ? "(-" + solution + ")" : parenthesized(solution);
+		return true;
+	}
+	return false;
+}
+
+std::string Integrator::lookInTable(ASTNode* t_ast, int variable) const {
+
+	ASTNode* ast = t_ast;
+
+	// If ast is NULL, something has gone wrong
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	// If ast is not in table, return TABLE_LOOKUP_FAIL
+	// Trigonometric powers, integration by parts and substitution are not fixed patterns, so they are tried once
+	// nothing in the table matched
+	std::string solution;
+	IntegratorRule rule = tableReordered ? BuiltinTable::apply(ast, variable, solution, tableOrder) : BuiltinTable::apply(ast, variable, solution);
+	if (rule == ruleTableMiss && TrigIntegrals::integrate(ast, variable, solution)) {
+		rule = ruleTrigPower;
+	}
+	else if (rule == ruleTableMiss && PartsIntegrals::integrate(ast, variable, solution)) {
+		rule = ruleByParts;
+	}
+	else if (rule == ruleTableMiss && integrateBySubstitution(ast, variable, solution)) {
+		rule = ruleSubstitution;
+	}
+	applyRule(rule, ast);
+	if (rule == ruleTableMiss) {
+		return TABLE_LOOKUP_FAIL;
+	}
+	return solution;
+}
+
+// The main method of the integrator class; integrates with respect to x
+std::string Integrator::integrate(ASTNode* t_ast) const {
+	return integrate(t_ast, SymbolTable::letter('x'));
+}
+
+// Answers from the cache when it can
+std::string Integrator::integrate(ASTNode* t_ast, int t_variable) const {
+	if (t_ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	PhaseTimer timer(phaseIntegrate);
+	// Trees that did not come from the Parser (deserialized ones, for instance) are analyzed here, once
+	if (!t_ast->analyzed) {
+		analyzeTree(t_ast);
+	}
+
+	std::string solution;
+	if (cache != NULL && cache->lookup(t_ast, t_variable, solution)) {
+		return solution;
+	}
+
+	solution = integrateSubtree(t_ast, t_variable);
+	Trace::result(solution);
+	if (cache != NULL) {
+		cache->store(t_ast, t_variable, solution);
+	}
+	return solution;
+}
+
+// This is a recursive function that integrates the abstract syntax tree that is passed in term by term
+std::string Integrator::integrateSubtree(ASTNode* t_ast, int variable) const {
+	Budget::check();
+	TraceScope scope;
+	ASTNode* ast = t_ast; 
+	std::string solution = "";
+
+	// Every node's variables mask is already filled in, so "does not depend on the variable" is one AND
+	unsigned long long variableMask = symbolBit(variable);
+
+	// If ast represents the integral of a sum such as "1+2", return the integral of the evaluated sum "3"
+	// If ast reprsents the integral of a sum such as "x^2 + x", return the sum of the integrals
+	if (ast->type == operatorPlus) {
+		// Sums with a variable in them are the common case here; the cached constant flag rules them out in O(1)
+		Evaluator evaluator; double val;
+		if (ast->constant && evaluator.tryEvaluate(ast, val)) {
+			ASTNode constant;
+			constant.type = numberValue; constant.value = val;
+			applyRule(ruleConstantSum, ast);
+			return integrateSubtree(&constant, variable);
+		}
+		applyRule(ruleSum, ast);
+		return integrateSubtree(ast->left, variable) + " + " + integrateSubtree(ast->right, variable);
+	}
+	// If ast reprsents the integral of a sum such as "x^2 - x", return the sum of the integrals
+	else if (ast->type == operatorMinus) {
+		applyRule(ruleDifference, ast);
+		return integrateSubtree(ast->left, variable) + " - " + integrateSubtree(ast->right, variable);
+	}
+
+	// If ast does not depend on the variable at all, such as "y^2" or "sin(5)" with respect to x, return ast times x
+	else if (ast->type != numberValue && (ast->variables & variableMask) == 0) {
+		applyRule(ruleIndependent, ast);
+		Formatter formatter;
+		return formatter.format(ast) + "*" + SymbolTable::name(variable);
+	}
+
+	// If ast represents the integral of a product of x times 1, return the integral of x
+	else if (ast->type == operatorMul && (ast->left->value == 1)) {
+		applyRule(ruleUnitFactor, ast);
+		return integrateSubtree(ast->right, variable);
+	}
+	// If ast represents the integral of a product of 1 times x, return the integral of x
+	else if (ast->type == operatorMul && (ast->right->value == 1)) {
+		applyRule(ruleUnitFactor, ast);
+		return integrateSubtree(ast->left, variable);
+	}
+
+	// If ast represents the integral of a product of x times n, return n times the integral of x
+	else if (ast->type == operatorMul && (ast->left->value > 0)) {
+		applyRule(ruleConstantFactor, ast);
+		return scaleByCoefficient(ast->left->value, integrateSubtree(ast->right, variable));
+	}
+	// If ast represents the integral of a product of n times x, return n times the integral of x
+	else if (ast->type == operatorMul && (ast->right->value > 0)) {
+		applyRule(ruleConstantFactor, ast);
+		return scaleByCoefficient(ast->right->value, integrateSubtree(ast->left, variable));
+	}
+
+	// If ast represents the integral of c times f (or f times c, or f divided by c) where c does not depend on the
+	// variable, such as "y*x" with respect to x, return c times the integral of f
+	else if ((ast->type == operatorMul || ast->type == operatorDivision) && (ast->right->variables & variableMask) == 0) {
+		applyRule(ruleIndependentFactor, ast);
+		return scaleIntegral(integrateSubtree(ast->left, variable), ast->right, ast->type == operatorDivision);
+	}
+	else if (ast->type == operatorMul && (ast->left->variables & variableMask) == 0) {
+		applyRule(ruleIndependentFactor, ast);
+		return scaleIntegral(integrateSubtree(ast->right, variable), ast->left, false);
+	}
+
+	solution = lookInTable(ast, variable);
+
+	return solution;
+}
+
+// Reads antiderivative back in and sets value to its change from lower to upper
+// Returns false if it cannot be read, or is undefined or infinite at either bound (ln(x) at x = -1, for instance)
+bool Integrator::evaluateAntiderivative(const std::string& antiderivative, int variable, double lower, double upper, double& value) const {
+	if (antiderivative.empty() || antiderivative.find(TABLE_LOOKUP_FAIL) != std::string::npos) {
+		return false;
+	}
+
+	// interpret() edits in place and may insert one '*' per character, so leave room for twice the text
+	std::vector<char> text(2 * antiderivative.size() + 4, 0);
+	antiderivative.copy(&text[0], antiderivative.size());
+	Interpreter interpreter;
+	interpreter.interpret(&text[0]);
+
+	// A small arena of its own keeps this reentrant; the tree is a few dozen nodes at most
+	NodeArena nodes(64);
+	try {
+		Parser parser;
+		parser.setArena(&nodes);
+		ASTNode* ast = parser.parse(&text[0]);
+		Evaluator evaluator;
+		evaluator.bind(variable, upper);
+		double atUpper = evaluator.evaluate(ast);
+		evaluator.bind(variable, lower);
+		double atLower = evaluator.evaluate(ast);
+
+		value = atUpper - atLower;
+		return std::isfinite(atUpper) && std::isfinite(atLower);
+	}
+	catch (const ParserException&) {
+		return false;
+	}
+	catch (const EvaluatorException&) {
+		return false;
+	}
+}
+
+DefiniteIntegral Integrator::integrateDefinite(ASTNode* t_ast, int t_variable, double t_lower, double t_upper) const {
+	if (!std::isfinite(t_lower) || !std::isfinite(t_upper)) {
+		throw EvaluatorException("Definite integrals need finite bounds");
+	}
+
+	DefiniteIntegral result;
+	result.antiderivative = integrate(t_ast, t_variable);
+
+	// F(upper) - F(lower) is only the integral if the integrand is defined and bounded all the way between the
+	// bounds; across a singularity (1/x^2 from -1 to 1) it would be finite but wrong
+	IntervalEvaluator ranges(t_variable, Evaluator());
+	ValueRange range = ranges.evaluate(t_ast, std::min(t_lower, t_upper), std::max(t_lower, t_upper));
+	bool bounded = range.domain == domainAll && std::isfinite(range.lower) && std::isfinite(range.upper);
+	if (bounded && evaluateAntiderivative(result.antiderivative, t_variable, t_lower, t_upper, result.value)) {
+		result.error = 0;
+		result.symbolic = true;
+		result.converged = true;
+		return result;
+	}
+
+	// Any variable other than t_variable is left unbound, so quadrature throws if the integrand has one
+	Evaluator evaluator;
+	QuadratureResult numeric = quadrature.integrate(t_ast, t_variable, t_lower, t_upper, evaluator);
+	result.value = numeric.value;
+	result.error = numeric.error;
+	result.symbolic = false;
+	result.converged = numeric.converged;
+	return result;
+}
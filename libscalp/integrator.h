@@ -0,0 +1,107 @@
+/*
+* Declares an Integrator class, which is the main class that handles the actual integration process.
+* Its purpose is to take in a AST that represents something to be integrated, such as the integral of 2x, and
+* to output a symbolic result, such as x^2. It will require help from other classes in order to do this, but it is 
+* the "guy in charge."
+*
+* integrate() and integrateDefinite() do not change the Integrator, so one Integrator (and the ResultCache it uses)
+* may serve several threads at once; only the setters must not be called while they run. Threads may also share a
+* tree, as long as it is analyzed (see analysis.h), which trees from the Parser and Builder always are.
+*/
+
+//#define guard prevents multiple inclusion
+#ifndef SCALP_INTEGRATOR_H_
+#define SCALP_INTEGRATOR_H_
+
+#include "ast.h"
+#include "quadrature.h"
+#include <string>
+
+class ResultCache;
+class RuleOrder;
+
+// Identifies the integration rules that results were produced with
+// Bump this whenever a rule changes what integrate() returns, so that persistent caches of old results are discarded
+const unsigned int INTEGRATOR_RULES_VERSION = 6;
+
+// The rules integrateSubtree() and lookInTable() can apply; counted per use in the pipeline stats (see stats.h)
+enum IntegratorRule {
+	ruleConstantSum, // A sum with no variables is evaluated first
+	ruleSum,
+	ruleDifference,
+	ruleUnitFactor, // 1 * f
+	ruleConstantFactor, // n * f
+	ruleReciprocal, // 1/x
+	rulePower, // x^n
+	ruleVariable, // x
+	ruleCosine, // cos(x)
+	ruleConstant, // n
+	ruleZero, // 0
+	ruleIndependent, // c, where c does not depend on the variable of integration
+	ruleIndependentFactor, // c * f or f / c, where c does not depend on the variable of integration
+	ruleTrigPower, // sin(x)^m * cos(x)^n, tan(x)^n, sec(x)^n, csc(x)^n or cot(x)^n; see trigintegrals.h
+	ruleByParts, // Products of ln(x)^k, x^n, sin(x) or cos(x), and e^x; see partsintegrals.h
+	ruleSubstitution, // f(g(x)) * g'(x), as f(u) with u = g(x); see substitution.h
+	ruleTableMiss, // Nothing matched
+	INTEGRATOR_RULE_COUNT
+};
+
+// Short names of the rules, used in stats output
+extern const char* INTEGRATOR_RULE_NAMES[INTEGRATOR_RULE_COUNT];
+
+// The result of Integrator::integrateDefinite()
+struct DefiniteIntegral {
+	double value;
+	double error; // Estimated absolute error; 0 when value comes from the antiderivative
+	bool symbolic; // value is F(upper) - F(lower) for the antiderivative F that integrate() found
+	bool converged; // Always true when symbolic; otherwise whether quadrature met its tolerance (see quadrature.h)
+	std::string antiderivative; // What integrate() returned, which may be ERROR
+};
+
+class Integrator
+{
+	// Optional persistent cache consulted before any integration work; NULL when disabled
+	ResultCache* cache;
+
+	// Used by integrateDefinite() when there is no usable antiderivative
+	Quadrature quadrature;
+
+	// Positions in the built-in table, in the order lookInTable() tries them; unused while tableReordered is false,
+	// when it tries them in the order they are written
+	unsigned char tableOrder[INTEGRATOR_RULE_COUNT];
+	bool tableReordered;
+
+	bool evaluateAntiderivative(const std::string& antiderivative, int variable, double lower, double upper, double& value) const;
+
+	ASTNode* applySafeTransform(ASTNode* t_ast) const;
+	ASTNode* applyHeuristicTransform(ASTNode* t_ast);
+	bool integrateBySubstitution(const ASTNode* ast, int variable, std::string& solution) const;
+	std::string lookInTable(ASTNode* t_ast, int variable) const;
+	std::string integrateSubtree(ASTNode* t_ast, int variable) const;
+public:
+	Integrator();
+
+	// Results are looked up in and added to t_cache from now on; pass NULL to stop using a cache
+	void setCache(ResultCache* t_cache);
+
+	// Integrates with respect to x
+	std::string integrate(ASTNode* t_ast) const;
+
+	// Integrates with respect to the variable whose id in the SymbolTable is t_variable (see symbols.h)
+	// Subtrees that do not depend on that variable are treated as constants, whatever other variables they contain
+	std::string integrate(ASTNode* t_ast, int t_variable) const;
+
+	// Integrates from t_lower to t_upper with respect to the variable with symbol id t_variable
+	// The antiderivative from integrate() is evaluated at the bounds when there is one, it is defined at both and the
+	// integrand is defined and bounded in between (see interval.h); otherwise the integral is computed numerically within the quadrature options' tolerance and deadline
+	// Throws an EvaluatorException if the integrand has variables other than t_variable or the bounds are not finite
+	DefiniteIntegral integrateDefinite(ASTNode* t_ast, int t_variable, double t_lower, double t_upper) const;
+
+	void setQuadratureOptions(const QuadratureOptions& t_options);
+
+	// Tries the rules of the built-in table in the order of t_order, most hits first (see ruleorder.h)
+	// Answers are the same in any order; only the time it takes to find the matching rule changes
+	void setRuleOrder(const RuleOrder& t_order);
+};
+
+#endif //SCALP_INTEGRATOR_H_
\ No newline at end of file
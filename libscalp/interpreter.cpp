@@ -4,6 +4,7 @@
 */
 
 #include "interpreter.h"
+#include "stats.h"
 #include <iostream>
 
 // Helper function called by interpret() in order to identify functions within the input text
@@ -36,8 +37,10 @@ bool Interpreter::isLnFunction(int i, char text[]){
 // Currently takes care of implicit multiplication by adding in '*' where needed
 // Example: turns 5(x+2) into 5*(x+2)
 // Example2: turns 7x into 7*x
+// Example3: turns xy into x*y; multi-character variable names such as x_1 or v_max are left whole
 // Ignores the parentheses following a function such as sin(x)
 void Interpreter::interpret(char text[]){
+	PhaseTimer timer(phaseInterpret);
 	int size = getSize(text);
 
 	// Remove whitespace, shift stuff down to close the gap
@@ -58,8 +61,13 @@ void Interpreter::interpret(char text[]){
 	// Add '*' where necessary
 	for (int i = 1; i < size; i++){
 		// Calls the helper function defined above to skip any function tokens and their opening parentheses
-		if (is3CharFunction(i - 1, text)) i += 4;
-		else if (isLnFunction(i - 1, text)) i += 3;
+		// The next pair checked is the parenthesis and the first character of the argument, which may be a function
+		if (is3CharFunction(i - 1, text)) i += 2;
+		else if (isLnFunction(i - 1, text)) i += 1;
+		// Skips to the last character of a multi-character variable name (see Parser::getVariable())
+		else if (isalpha(text[i - 1]) && text[i] == '_' && isalnum(text[i + 1])) {
+			while (isalnum(text[i + 1]) || text[i + 1] == '_') i++;
+		}
 		// Check for familiar patters indicating implied multiplication
 		else if (isdigit(text[i - 1]) && isalpha(text[i]) || // 5x -> 5*x
 			isdigit(text[i - 1]) && text[i] == '(' || // 5(x) -> 5*(x)
@@ -70,7 +78,8 @@ void Interpreter::interpret(char text[]){
 			isalpha(text[i - 1]) && is3CharFunction(i, text) || // xsin(x) -> x*sin(x)
 			isalpha(text[i - 1]) && isLnFunction(i, text) || // xln(x) -> x*ln(x)
 			text[i - 1] == ')' && isdigit(text[i]) || // (x)5 = (x)*5
-			text[i - 1] == ')' && isalpha(text[i])  // (2)x = (2)*x
+			text[i - 1] == ')' && isalpha(text[i]) || // (2)x = (2)*x
+			isalpha(text[i - 1]) && isalpha(text[i]) // xy -> x*y
 			){
 			// Iterate backwards to shift the entire string up so there's room to stick the '*' in
 			for (int j = size + 1; j > i && j > 0; j--){
@@ -0,0 +1,290 @@
+/*
+* Implements the IntervalEvaluator class in interval.h
+* See comments in interval.h for more details
+*/
+
+#include "interval.h"
+#include "symbols.h"
+#include <algorithm>
+#include <cmath>
+
+const double PI = 3.14159265358979323846;
+
+// Beyond this magnitude a double holds no fraction of a period, so the periodic functions take their full range
+const double MAX_PERIODIC_ARGUMENT = 1e15;
+
+static ValueRange makeRange(double lower, double upper, RangeDomain domain) {
+	ValueRange range = { lower, upper, domain };
+	return range;
+}
+
+static ValueRange nowhere() {
+	return makeRange(NAN, NAN, domainNone);
+}
+
+static ValueRange everyValue(RangeDomain domain) {
+	return makeRange(-INFINITY, INFINITY, domain);
+}
+
+// The domain of an expression made from parts with domains a and b: undefined anywhere either is
+static RangeDomain combined(RangeDomain a, RangeDomain b) {
+	if (a == domainNone || b == domainNone) return domainNone;
+	return (a == domainPart || b == domainPart) ? domainPart : domainAll;
+}
+
+// Moves each end of range outward by ulps units in the last place, to cover the rounding of whatever computed them;
+// an end that came out NaN (inf - inf, say) gives up its bound
+static ValueRange rounded(ValueRange range, int ulps) {
+	if (range.domain == domainNone) {
+		return nowhere();
+	}
+	range.lower = std::isnan(range.lower) ? -INFINITY : range.lower;
+	range.upper = std::isnan(range.upper) ? INFINITY : range.upper;
+	for (int i = 0; i < ulps; i++) {
+		range.lower = nextafter(range.lower, -INFINITY);
+		range.upper = nextafter(range.upper, INFINITY);
+	}
+	return range;
+}
+
+// 0 times an infinite bound is 0: the values themselves are always finite, however large the bound on them
+static double product(double a, double b) {
+	return (a == 0 || b == 0) ? 0 : a * b;
+}
+
+static ValueRange add(const ValueRange& a, const ValueRange& b) {
+	return rounded(makeRange(a.lower + b.lower, a.upper + b.upper, combined(a.domain, b.domain)), 1);
+}
+
+static ValueRange negate(const ValueRange& a) {
+	return makeRange(-a.upper, -a.lower, a.domain);
+}
+
+static ValueRange multiply(const ValueRange& a, const ValueRange& b) {
+	double p[4] = { product(a.lower, b.lower), product(a.lower, b.upper), product(a.upper, b.lower), product(a.upper, b.upper) };
+	return rounded(makeRange(*std::min_element(p, p + 4), *std::max_element(p, p + 4), combined(a.domain, b.domain)), 1);
+}
+
+// 1/a, which is undefined where a is 0
+static ValueRange reciprocal(const ValueRange& a) {
+	if (a.domain == domainNone || (a.lower == 0 && a.upper == 0)) {
+		return nowhere();
+	}
+	if (a.lower > 0 || a.upper < 0) {
+		return rounded(makeRange(1 / a.upper, 1 / a.lower, a.domain), 1);
+	}
+	// Only one side of 0 is left once 0 itself is taken out
+	if (a.lower == 0) {
+		return rounded(makeRange(1 / a.upper, INFINITY, domainPart), 1);
+	}
+	if (a.upper == 0) {
+		return rounded(makeRange(-INFINITY, 1 / a.lower, domainPart), 1);
+	}
+	return everyValue(domainPart);
+}
+
+// Keeps the part of a that is at least (or, when strict, above) minimum, the domain of ln and of fractional powers
+static ValueRange restrictBelow(const ValueRange& a, double minimum, bool strict) {
+	if (a.domain == domainNone || a.upper < minimum || (strict && a.upper <= minimum)) {
+		return nowhere();
+	}
+	if (a.lower > minimum || (!strict && a.lower == minimum)) {
+		return a;
+	}
+	return makeRange(minimum, a.upper, domainPart);
+}
+
+static ValueRange naturalLog(const ValueRange& a) {
+	ValueRange positive = restrictBelow(a, 0, true);
+	if (positive.domain == domainNone) {
+		return positive;
+	}
+	return rounded(makeRange(log(positive.lower), log(positive.upper), positive.domain), 2);
+}
+
+static ValueRange exponential(const ValueRange& a) {
+	if (a.domain == domainNone) {
+		return a;
+	}
+	return rounded(makeRange(std::max(0.0, exp(a.lower)), exp(a.upper), a.domain), 2);
+}
+
+// Whether [lower, upper] may hold point + k * period for some whole k; a point just outside it still counts, since
+// lower and upper may themselves be off by a few units in the last place
+static bool mayHold(double lower, double upper, double point, double period) {
+	double slack = 8 * 2.220446049250313e-16 * std::max(1.0, std::max(fabs(lower), fabs(upper)));
+	double k = ceil((lower - slack - point) / period);
+	return point + k * period <= upper + slack;
+}
+
+static bool periodic(const ValueRange& a, double period) {
+	return a.upper - a.lower >= period || fabs(a.lower) > MAX_PERIODIC_ARGUMENT || fabs(a.upper) > MAX_PERIODIC_ARGUMENT;
+}
+
+// sin(a), or cos(a) when shift is PI / 2, since cos has the extremes of sin moved left by that much
+static ValueRange sine(const ValueRange& a, double shift) {
+	if (a.domain == domainNone) {
+		return a;
+	}
+	if (periodic(a, 2 * PI)) {
+		return makeRange(-1, 1, a.domain);
+	}
+	double atLower = (shift == 0) ? sin(a.lower) : cos(a.lower);
+	double atUpper = (shift == 0) ? sin(a.upper) : cos(a.upper);
+	ValueRange range = rounded(makeRange(std::min(atLower, atUpper), std::max(atLower, atUpper), a.domain), 2);
+	if (mayHold(a.lower, a.upper, PI / 2 - shift, 2 * PI)) {
+		range.upper = 1;
+	}
+	if (mayHold(a.lower, a.upper, -PI / 2 - shift, 2 * PI)) {
+		range.lower = -1;
+	}
+	range.lower = std::max(range.lower, -1.0);
+	range.upper = std::min(range.upper, 1.0);
+	return range;
+}
+
+// tan(a), which rises between poles at PI / 2 + k * PI, or cot(a), which falls between poles at k * PI
+static ValueRange tangent(const ValueRange& a, bool cotangent) {
+	if (a.domain == domainNone) {
+		return a;
+	}
+	if (periodic(a, PI) || mayHold(a.lower, a.upper, cotangent ? 0 : PI / 2, PI)) {
+		return everyValue(domainPart);
+	}
+	if (cotangent) {
+		return rounded(makeRange(cos(a.upper) / sin(a.upper), cos(a.lower) / sin(a.lower), a.domain), 3);
+	}
+	return rounded(makeRange(tan(a.lower), tan(a.upper), a.domain), 2);
+}
+
+static bool isWhole(double value) {
+	return value == floor(value) && fabs(value) < 9007199254740992.0;
+}
+
+// a^n for a whole number n; a is defined somewhere
+static ValueRange wholePower(const ValueRange& a, double n) {
+	if (n == 0) {
+		return makeRange(1, 1, a.domain);
+	}
+	if (n < 0) {
+		return reciprocal(wholePower(a, -n));
+	}
+	double atLower = pow(a.lower, n), atUpper = pow(a.upper, n);
+	bool even = fmod(n, 2) == 0;
+	if (!even || a.lower >= 0) {
+		return rounded(makeRange(atLower, atUpper, a.domain), 2);
+	}
+	if (a.upper <= 0) {
+		return rounded(makeRange(atUpper, atLower, a.domain), 2);
+	}
+	return rounded(makeRange(0, std::max(atLower, atUpper), a.domain), 2);
+}
+
+static ValueRange power(const ValueRange& base, const ValueRange& exponent) {
+	if (base.domain == domainNone || exponent.domain == domainNone) {
+		return nowhere();
+	}
+	if (exponent.lower == exponent.upper) {
+		double p = exponent.lower;
+		if (isWhole(p)) {
+			ValueRange range = wholePower(base, p);
+			range.domain = combined(range.domain, exponent.domain);
+			return range;
+		}
+
+		// A fractional power is only defined for a base of at least 0 (above 0 when p is negative), and is monotonic there
+		ValueRange allowed = restrictBelow(base, 0, p < 0);
+		if (allowed.domain == domainNone) {
+			return allowed;
+		}
+		double atLower = pow(allowed.lower, p), atUpper = pow(allowed.upper, p);
+		return rounded(makeRange(std::min(atLower, atUpper), std::max(atLower, atUpper), combined(allowed.domain, exponent.domain)), 2);
+	}
+
+	// base^exponent is e^(exponent * ln(base)) where the base is above 0; 0^exponent is 0 for exponents above 0
+	if (base.lower > 0) {
+		return exponential(multiply(exponent, naturalLog(base)));
+	}
+	if (base.lower == 0 && base.upper == 0) {
+		return (exponent.lower > 0) ? makeRange(0, 0, exponent.domain) : makeRange(0, INFINITY, domainPart);
+	}
+	if (base.lower == 0 && exponent.lower > 0) {
+		ValueRange range = exponential(multiply(exponent, naturalLog(base)));
+		return makeRange(0, range.upper, combined(base.domain, exponent.domain));
+	}
+	return everyValue(domainPart);
+}
+
+// Constructor
+IntervalEvaluator::IntervalEvaluator(int t_variable, const Evaluator& t_bindings) : bindings(t_bindings) {
+	this->variable = t_variable;
+}
+
+ValueRange IntervalEvaluator::evaluateSubtree(const ASTNode* ast, const ValueRange& over) {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+
+	switch (ast->type) {
+	case numberValue:
+		return makeRange(ast->value, ast->value, domainAll);
+	case variableChar:
+	{
+		if (ast->symbol == variable) {
+			return over;
+		}
+		double value;
+		if (!bindings.tryEvaluate(ast, value)) {
+			throw EvaluatorException("Variable '" + SymbolTable::name(ast->symbol) + "' has no value");
+		}
+		return makeRange(value, value, domainAll);
+	}
+	case unaryMinus:
+		return negate(evaluateSubtree(ast->left, over));
+	case operatorPlus:
+		return add(evaluateSubtree(ast->left, over), evaluateSubtree(ast->right, over));
+	case operatorMinus:
+		return add(evaluateSubtree(ast->left, over), negate(evaluateSubtree(ast->right, over)));
+	case operatorMul:
+		return multiply(evaluateSubtree(ast->left, over), evaluateSubtree(ast->right, over));
+	case operatorDivision:
+	{
+		ValueRange numerator = evaluateSubtree(ast->left, over);
+		return multiply(numerator, reciprocal(evaluateSubtree(ast->right, over)));
+	}
+	case operatorPower:
+	{
+		ValueRange base = evaluateSubtree(ast->left, over);
+		return power(base, evaluateSubtree(ast->right, over));
+	}
+	case functionSin:
+		return sine(evaluateSubtree(ast->left, over), 0);
+	case functionCos:
+		return sine(evaluateSubtree(ast->left, over), PI / 2);
+	case functionTan:
+		return tangent(evaluateSubtree(ast->left, over), false);
+	case functionCot:
+		return tangent(evaluateSubtree(ast->left, over), true);
+	case functionSec:
+		return reciprocal(sine(evaluateSubtree(ast->left, over), PI / 2));
+	case functionCsc:
+		return reciprocal(sine(evaluateSubtree(ast->left, over), 0));
+	case functionLn:
+		return naturalLog(evaluateSubtree(ast->left, over));
+	case functionLog:
+	{
+		// The base is in the left child and the argument in the right, as in Evaluator
+		ValueRange base = naturalLog(evaluateSubtree(ast->left, over));
+		return multiply(naturalLog(evaluateSubtree(ast->right, over)), reciprocal(base));
+	}
+	default:
+		throw EvaluatorException("Incorrect syntax tree.");
+	}
+}
+
+ValueRange IntervalEvaluator::evaluate(const ASTNode* ast, double lower, double upper) {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+	return evaluateSubtree(ast, makeRange(lower, upper, domainAll));
+}
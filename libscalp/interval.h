@@ -0,0 +1,61 @@
+/*
+* Declares the IntervalEvaluator class, which evaluates an AST over a whole range of its variable at once: instead of
+* the value at one point, it gives bounds that every value over the range is guaranteed to lie within, and whether
+* the expression is defined over all of the range, over none of it, or possibly only over part of it.
+*
+* Each node is evaluated with interval arithmetic on the ranges of its children: sums and products combine the
+* endpoints, monotonic functions map them, and sin, cos, tan and cot check whether the range holds one of their
+* extremes or poles. Every computed endpoint is rounded outward, so the bounds hold despite floating-point rounding.
+* Since a variable that appears twice is treated as two independent ones ("x - x" over [0, 1] is [-1, 1]), the bounds
+* are often wider than the true range of values, but never narrower.
+*
+* This lets callers reason about a whole range without sampling it point by point: an integrand that is undefined
+* (domainNone) everywhere can be rejected outright, and one that is defined and bounded everywhere (domainAll, with
+* finite bounds) has no singularity for an antiderivative to jump across.
+*
+*  Sample usage:
+*   IntervalEvaluator ranges(SymbolTable::letter('x'), Evaluator());
+*   ValueRange range = ranges.evaluate(ast, -1, 1);
+*   if (range.domain == domainAll && std::isfinite(range.lower) && std::isfinite(range.upper)) { ... }
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_INTERVAL_H_
+#define SCALP_INTERVAL_H_
+
+#include "ast.h"
+#include "evaluator.h"
+
+enum RangeDomain {
+	domainAll, // Defined at every point of the range
+	domainPart, // May be undefined at some points (1/x over [-1, 1]); also used when that cannot be ruled out
+	domainNone // Undefined at every point of the range (ln(x) over [-2, -1])
+};
+
+// Every value the expression takes where it is defined lies in [lower, upper], which may be infinite at either end;
+// both are NaN when domain is domainNone
+struct ValueRange {
+	double lower;
+	double upper;
+	RangeDomain domain;
+};
+
+class IntervalEvaluator
+{
+	// Other variables are looked up in here
+	Evaluator bindings;
+	int variable;
+
+	ValueRange evaluateSubtree(const ASTNode* ast, const ValueRange& over);
+
+public:
+	// Evaluates over ranges of the variable with symbol id t_variable (see symbols.h); every other variable takes
+	// the value bound to it in t_bindings
+	IntervalEvaluator(int t_variable, const Evaluator& t_bindings);
+
+	// The range of ast's values while the variable runs over [lower, upper] (lower <= upper)
+	// Throws an EvaluatorException where Evaluator::evaluate() would: a NULL or malformed tree, or an unbound variable
+	ValueRange evaluate(const ASTNode* ast, double lower, double upper);
+};
+
+#endif // SCALP_INTERVAL_H_
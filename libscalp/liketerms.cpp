@@ -0,0 +1,376 @@
+/*
+* Implements the LikeTerms class in liketerms.h
+* See comments in liketerms.h for more details
+*/
+
+#include "liketerms.h"
+#include "analysis.h"
+#include "budget.h"
+#include "stats.h"
+#include "trace.h"
+#include <cmath>
+
+// Rewrite numbers reported to Trace::transform, after the identity rewrites 1-7 of Parser::simplify
+const int REWRITE_LIKE_TERMS = 8;
+const int REWRITE_LIKE_FACTORS = 9;
+
+// Constructor
+LikeTerms::LikeTerms(NodeArena* t_arena) {
+	this->arena = t_arena;
+
+	// Enough for most sums and products, so a short parse grows none of them
+	operands.reserve(16);
+	groups.reserve(16);
+	slots.reserve(32);
+	spentNodes.reserve(32);
+}
+
+ASTNode* LikeTerms::createNode(ASTNodeType type, ASTNode* left, ASTNode* right) {
+	Stats::count(counterNodesAllocated);
+	Budget::chargeNodes(1);
+	ASTNode* node = (arena != NULL) ? arena->allocate() : new ASTNode;
+	node->type = type;
+	node->left = left;
+	node->right = right;
+	analyzeNode(node);
+	return node;
+}
+
+ASTNode* LikeTerms::createNumberNode(double value) {
+	Stats::count(counterNodesAllocated);
+	Budget::chargeNodes(1);
+	ASTNode* node = (arena != NULL) ? arena->allocate() : new ASTNode;
+	node->type = numberValue;
+	node->value = value;
+	analyzeNode(node);
+	return node;
+}
+
+// Whether node has a value wherever its variables have one: it is made of numbers and variables with +, -, *, sin,
+// cos, whole powers that are not negative and powers of a number above 0. Only then may 0 times node become 0
+static bool definedEverywhere(const ASTNode* node) {
+	switch (node->type) {
+	case numberValue:
+	case variableChar:
+		return true;
+	case unaryMinus:
+	case functionSin:
+	case functionCos:
+		return definedEverywhere(node->left);
+	case operatorPlus:
+	case operatorMinus:
+	case operatorMul:
+		return definedEverywhere(node->left) && definedEverywhere(node->right);
+	case operatorPower:
+		if (node->right->type == numberValue && node->right->value >= 0 && node->right->value == floor(node->right->value)) {
+			return definedEverywhere(node->left);
+		}
+		return node->left->type == numberValue && node->left->value > 0 && definedEverywhere(node->right);
+	default:
+		return false;
+	}
+}
+
+static bool isOperandOf(const ASTNode* node, bool sum) {
+	if (sum) {
+		return node->type == operatorPlus || node->type == operatorMinus || node->type == unaryMinus;
+	}
+	return node->type == operatorMul || node->type == operatorDivision || node->type == unaryMinus;
+}
+
+void LikeTerms::collectOperands(ASTNode* node, bool sum, bool& changed) {
+	bool childChanged = false;
+	ASTNode** children[2] = { &node->left, &node->right };
+	for (int i = 0; i < 2; i++) {
+		ASTNode*& child = *children[i];
+		if (child == NULL) {
+			continue;
+		}
+		if (isOperandOf(child, sum)) {
+			collectOperands(child, sum, childChanged);
+		}
+		else {
+			child = collect(child, childChanged);
+		}
+	}
+	if (childChanged) {
+		analyzeNode(node);
+		changed = true;
+	}
+}
+
+void LikeTerms::addTerms(ASTNode* node, double sign, double& constant, int& numbers) {
+	if (isOperandOf(node, true)) {
+		spentNodes.push_back(node);
+		if (node->type == unaryMinus) {
+			addTerms(node->left, -sign, constant, numbers);
+			return;
+		}
+		addTerms(node->left, sign, constant, numbers);
+		addTerms(node->right, (node->type == operatorMinus) ? -sign : sign, constant, numbers);
+		return;
+	}
+	if (node->type == numberValue) {
+		spentNodes.push_back(node);
+		constant += sign * node->value;
+		numbers += (node->value != 0) ? 1 : 0;
+		return;
+	}
+
+	// A collected product keeps its coefficient on the left, but one the Parser made may have it on either side, and
+	// may still hold the 1s it put in as placeholders ("2*(1*sin(x))")
+	LikeGroup term = { node, sign };
+	while (term.node->type == operatorMul && (term.node->left->type == numberValue || term.node->right->type == numberValue)) {
+		ASTNode* number = (term.node->left->type == numberValue) ? term.node->left : term.node->right;
+		spentNodes.push_back(term.node);
+		spentNodes.push_back(number);
+		term.amount *= number->value;
+		term.node = (number == term.node->left) ? term.node->right : term.node->left;
+	}
+	operands.push_back(term);
+}
+
+void LikeTerms::addFactors(ASTNode* node, double exponentSign, double& numerator, double& denominator, int& numbers) {
+	if (isOperandOf(node, false)) {
+		spentNodes.push_back(node);
+		if (node->type == unaryMinus) {
+			numerator = -numerator;
+			addFactors(node->left, exponentSign, numerator, denominator, numbers);
+			return;
+		}
+		addFactors(node->left, exponentSign, numerator, denominator, numbers);
+		addFactors(node->right, (node->type == operatorDivision) ? -exponentSign : exponentSign, numerator, denominator, numbers);
+		return;
+	}
+
+	// A division by 0 is kept as a factor, so that it still fails when evaluated
+	if (node->type == numberValue && (exponentSign > 0 || node->value != 0)) {
+		spentNodes.push_back(node);
+		(exponentSign > 0 ? numerator : denominator) *= node->value;
+		numbers += (node->value != 1) ? 1 : 0;
+		return;
+	}
+
+	LikeGroup factor = { node, exponentSign };
+	if (node->type == operatorPower && node->right->type == numberValue) {
+		spentNodes.push_back(node);
+		spentNodes.push_back(node->right);
+		factor.node = node->left;
+		factor.amount *= node->right->value;
+
+		// (-b)^n is b^n, negated when n is odd; the Parser reads "-x*x" as (-x)^1 * x
+		if (factor.node->type == unaryMinus && factor.amount == floor(factor.amount)) {
+			spentNodes.push_back(factor.node);
+			numerator = (fmod(factor.amount, 2) != 0) ? -numerator : numerator;
+			factor.node = factor.node->left;
+		}
+	}
+	operands.push_back(factor);
+}
+
+// Whether the exponents of factor may be added to those of group, which has the same base: b^p * b^q is b^(p + q)
+// for whole p and q, but for fractional ones only when b is above 0 ((-2)^0.5 * (-2)^0.5 is not -2), and a divisor
+// only cancels a factor when it is a number other than 0 (x/x is undefined at x = 0, so it is not 1)
+static bool mayAddExponents(const LikeGroup& group, const LikeGroup& factor) {
+	bool positiveBase = group.node->type == numberValue && group.node->value > 0;
+	bool nonZeroBase = group.node->type == numberValue && group.node->value != 0;
+	bool whole = group.amount == floor(group.amount) && factor.amount == floor(factor.amount);
+	bool sameSide = (group.amount < 0) == (factor.amount < 0);
+	return (positiveBase || whole) && (nonZeroBase || sameSide);
+}
+
+bool LikeTerms::groupOperands(bool product) {
+	size_t size = 8;
+	while (size < 2 * operands.size()) {
+		size *= 2;
+	}
+	slots.assign(size, 0);
+	groups.clear();
+
+	for (size_t i = 0; i < operands.size(); i++) {
+		const LikeGroup& operand = operands[i];
+		size_t slot = (size_t)operand.node->hash & (size - 1);
+		while (slots[slot] != 0) {
+			LikeGroup& group = groups[slots[slot] - 1];
+			if (group.node->hash == operand.node->hash && (!product || mayAddExponents(group, operand)) && sameTree(group.node, operand.node)) {
+				group.amount += operand.amount;
+				spentTrees.push_back(operand.node);
+				break;
+			}
+			slot = (slot + 1) & (size - 1);
+		}
+		if (slots[slot] == 0) {
+			groups.push_back(operand);
+			slots[slot] = groups.size();
+		}
+	}
+
+	bool merged = groups.size() < operands.size();
+	for (size_t i = 0; i < groups.size(); i++) {
+		merged = merged || groups[i].amount == 0;
+	}
+	return merged;
+}
+
+ASTNode* LikeTerms::rebuildSum(double constant) {
+	ASTNode* sum = NULL;
+	for (size_t i = 0; i <= groups.size(); i++) {
+		double coefficient = (i < groups.size()) ? groups[i].amount : constant;
+		bool undefinedSomewhere = i < groups.size() && !definedEverywhere(groups[i].node);
+		if (coefficient == 0 && !undefinedSomewhere) {
+			if (i < groups.size()) {
+				spentTrees.push_back(groups[i].node);
+			}
+			continue;
+		}
+
+		// A term that cancels out but is not defined everywhere (ln(x) - ln(x)) stays as 0 times itself, so that the
+		// sum is still undefined where it is
+		ASTNode* term;
+		if (i == groups.size()) {
+			term = createNumberNode(fabs(coefficient));
+		}
+		else if (coefficient == 0) {
+			term = createNode(operatorMul, createNumberNode(0), groups[i].node);
+		}
+		else {
+			term = (fabs(coefficient) == 1) ? groups[i].node : createNode(operatorMul, createNumberNode(fabs(coefficient)), groups[i].node);
+		}
+		if (sum == NULL) {
+			sum = (coefficient < 0) ? createNode(unaryMinus, term, NULL) : term;
+		}
+		else {
+			sum = createNode((coefficient < 0) ? operatorMinus : operatorPlus, sum, term);
+		}
+	}
+	return (sum != NULL) ? sum : createNumberNode(0);
+}
+
+bool LikeTerms::vanishes(double numerator) const {
+	if (numerator != 0) {
+		return false;
+	}
+	for (size_t i = 0; i < groups.size(); i++) {
+		const LikeGroup& group = groups[i];
+		if (group.amount < 0 || group.amount != floor(group.amount) || !definedEverywhere(group.node)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+ASTNode* LikeTerms::rebuildProduct(double numerator, double denominator) {
+	if (vanishes(numerator)) {
+		for (size_t i = 0; i < groups.size(); i++) {
+			spentTrees.push_back(groups[i].node);
+		}
+		return createNumberNode(0);
+	}
+
+	// Numbers and factors with positive exponents go above the line, the rest below it
+	bool negative = (numerator < 0) != (denominator < 0);
+	ASTNode* parts[2] = { NULL, NULL };
+	double coefficients[2] = { fabs(numerator), fabs(denominator) };
+	for (int part = 0; part < 2; part++) {
+		if (coefficients[part] != 1) {
+			parts[part] = createNumberNode(coefficients[part]);
+		}
+		for (size_t i = 0; i < groups.size(); i++) {
+			double exponent = (part == 0) ? groups[i].amount : -groups[i].amount;
+			if (exponent <= 0) {
+				if (exponent == 0 && part == 0) {
+					spentTrees.push_back(groups[i].node);
+				}
+				continue;
+			}
+			ASTNode* factor = (exponent == 1) ? groups[i].node : createNode(operatorPower, groups[i].node, createNumberNode(exponent));
+			parts[part] = (parts[part] == NULL) ? factor : createNode(operatorMul, parts[part], factor);
+		}
+	}
+
+	ASTNode* product = (parts[0] != NULL) ? parts[0] : createNumberNode(1);
+	if (parts[1] != NULL) {
+		product = createNode(operatorDivision, product, parts[1]);
+	}
+	return negative ? createNode(unaryMinus, product, NULL) : product;
+}
+
+void LikeTerms::releaseSpent(bool rebuilt) {
+	if (rebuilt && arena == NULL) {
+		for (size_t i = 0; i < spentNodes.size(); i++) {
+			spentNodes[i]->left = NULL;
+			spentNodes[i]->right = NULL;
+			delete spentNodes[i];
+		}
+		for (size_t i = 0; i < spentTrees.size(); i++) {
+			delete spentTrees[i];
+		}
+	}
+	operands.clear();
+	spentNodes.clear();
+	spentTrees.clear();
+}
+
+ASTNode* LikeTerms::collectSum(ASTNode* node, bool& changed) {
+	collectOperands(node, true, changed);
+
+	double constant = 0;
+	int numbers = 0;
+	addTerms(node, 1, constant, numbers);
+	if (!groupOperands(false) && numbers < 2) {
+		releaseSpent(false);
+		return node;
+	}
+
+	ASTNode* sum = rebuildSum(constant);
+	releaseSpent(true);
+	Stats::count(counterSimplifyRewrites);
+	Trace::transform(REWRITE_LIKE_TERMS, sum);
+	changed = true;
+	return sum;
+}
+
+ASTNode* LikeTerms::collectProduct(ASTNode* node, bool& changed) {
+	collectOperands(node, false, changed);
+
+	double numerator = 1, denominator = 1;
+	int numbers = 0;
+	addFactors(node, 1, numerator, denominator, numbers);
+	bool merged = groupOperands(true);
+	if (!merged && numbers < 2 && !vanishes(numerator)) {
+		releaseSpent(false);
+		return node;
+	}
+
+	ASTNode* product = rebuildProduct(numerator, denominator);
+	releaseSpent(true);
+	Stats::count(counterSimplifyRewrites);
+	Trace::transform(REWRITE_LIKE_FACTORS, product);
+	changed = true;
+	return product;
+}
+
+ASTNode* LikeTerms::collect(ASTNode* ast, bool& changed) {
+	if (ast == NULL) {
+		return NULL;
+	}
+	if (ast->type == operatorPlus || ast->type == operatorMinus) {
+		return collectSum(ast, changed);
+	}
+	if (ast->type == operatorMul || ast->type == operatorDivision) {
+		return collectProduct(ast, changed);
+	}
+
+	bool childChanged = false;
+	if (ast->left != NULL) {
+		ast->left = collect(ast->left, childChanged);
+	}
+	if (ast->right != NULL) {
+		ast->right = collect(ast->right, childChanged);
+	}
+	if (childChanged) {
+		analyzeNode(ast);
+		changed = true;
+	}
+	return ast;
+}
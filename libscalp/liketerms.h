@@ -0,0 +1,96 @@
+/*
+* Declares the LikeTerms class, the pass of the simplifier that collects like terms: "x + x + 3*x" becomes 5*x and
+* "x*x*x" becomes x^3. The Parser runs it once the identity rewrites of Parser::simplify are done.
+*
+* The nested binary operators of a sum (+, - and unary minus) are read as one n-ary sum, and each term is split into
+* a numeric coefficient and the rest; terms whose rests have the same structural hash (see ast.h), confirmed with
+* sameTree(), are one group and their coefficients are added up. Products (*, / and unary minus) are read the same
+* way, with each factor split into a base and a numeric exponent, and the exponents of each base are added up; the
+* numbers among the factors are multiplied into one coefficient. The groups are found through an open-addressing
+* table keyed by the cached hashes, so each sum or product takes one linear pass however many terms it has, and the
+* trees are never compared pairwise.
+*
+* The tree is collected bottom-up, so the terms of a sum are already collected products when they are grouped. A sum
+* or product in which nothing combines is left exactly as it was; one that does is rebuilt from its groups, in the
+* order they first appeared, with the numbers last in a sum and first in a product.
+*
+* Collecting never makes an expression defined where it was not: a product with a coefficient of 0 only becomes 0,
+* and a term that cancels out is only dropped, when what they multiply is defined everywhere ("0*x" is 0, but "0/0"
+* and "0*ln(x)" stay as they are). Exponents that are not whole numbers are only added up for a base that is a
+* number above 0 ("x^0.5*x^0.5" is not x where x < 0), and a divisor only cancels a factor when it is a number other
+* than 0: "x*y*x/y" becomes (x^2*y)/y, which is still undefined at y = 0, not x^2.
+*
+*  Sample usage:
+*   LikeTerms collector(arena); // NULL if the tree's nodes are on the heap
+*   bool changed = false;
+*   ast = collector.collect(ast, changed);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_LIKETERMS_H_
+#define SCALP_LIKETERMS_H_
+
+#include "arena.h"
+#include "ast.h"
+#include <vector>
+
+// A base (or the rest of a term) and the exponents (or coefficients) added up for it
+struct LikeGroup {
+	ASTNode* node;
+	double amount;
+};
+
+class LikeTerms
+{
+	// Where new nodes are placed; NULL means they are allocated on the heap with new, and the nodes a rebuilt sum or
+	// product no longer uses are deleted
+	NodeArena* arena;
+
+	// Scratch space for the sum or product being collected, kept between them so a warm collector stops allocating
+	std::vector<LikeGroup> operands; // Every term (or factor), in order
+	std::vector<LikeGroup> groups; // The distinct ones, with their amounts added up
+	std::vector<size_t> slots; // Open-addressing table of group index + 1, or 0 for an empty slot
+	std::vector<ASTNode*> spentNodes; // Operator and number nodes that are not reused when the operands are rebuilt
+	std::vector<ASTNode*> spentTrees; // Whole subtrees that are not reused: the repeats of a group's node
+
+	LikeTerms(const LikeTerms&);
+	LikeTerms& operator=(const LikeTerms&);
+
+	ASTNode* createNode(ASTNodeType type, ASTNode* left, ASTNode* right);
+	ASTNode* createNumberNode(double value);
+
+	// Collects every operand of the sum (or product) rooted at node, down to the first nodes that are not part of it
+	void collectOperands(ASTNode* node, bool sum, bool& changed);
+
+	// Fill operands; numbers are added up into constant (or multiplied into numerator and denominator) instead,
+	// and counted unless they are the 0 (or 1) the Parser puts in as a placeholder
+	void addTerms(ASTNode* node, double sign, double& constant, int& numbers);
+	void addFactors(ASTNode* node, double exponentSign, double& numerator, double& denominator, int& numbers);
+
+	// Merges operands into groups; returns whether anything was merged or added up to 0
+	// The factors of a product (product set) that have the same base are only merged where that keeps their value
+	bool groupOperands(bool product);
+
+	// Whether a product with coefficient numerator and the current groups is 0 wherever its variables have a value:
+	// numerator is 0 and no group is a divisor, a fractional power or anything else that may be undefined (0/0,
+	// 0*ln(x)), since those keep the product undefined where they are
+	bool vanishes(double numerator) const;
+
+	ASTNode* rebuildSum(double constant);
+	ASTNode* rebuildProduct(double numerator, double denominator);
+
+	// Frees what the rebuilt operands no longer use (on the heap only) and empties the lists
+	void releaseSpent(bool rebuilt);
+
+	ASTNode* collectSum(ASTNode* node, bool& changed);
+	ASTNode* collectProduct(ASTNode* node, bool& changed);
+
+public:
+	LikeTerms(NodeArena* t_arena);
+
+	// Collects like terms throughout the analyzed tree ast and returns its new root, which may be a different node;
+	// sets changed if anything was combined. Every node of the result is analyzed (see analysis.h).
+	ASTNode* collect(ASTNode* ast, bool& changed);
+};
+
+#endif // SCALP_LIKETERMS_H_
@@ -0,0 +1,235 @@
+/*
+* Implements the MappedFile class in mappedfile.h
+* See comments in mappedfile.h for more details
+*/
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Constructor
+MappedFile::MappedFile() {
+	this->mappedData = NULL;
+	this->mappedSize = 0;
+	this->writable = false;
+#ifdef _WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = NULL;
+#else
+	this->fileDescriptor = -1;
+#endif
+}
+
+// Destructor
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize)) {
+		close();
+		return false;
+	}
+
+	// CreateFileMapping refuses zero-length files, so an empty file is simply left unmapped
+	mappedSize = (size_t)fileSize.QuadPart;
+	if (mappedSize == 0) {
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		close();
+		return false;
+	}
+
+	mappedData = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (mappedData == NULL) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::openWritable(const std::string& path, size_t size) {
+	close();
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize)) {
+		close();
+		return false;
+	}
+	if ((size_t)fileSize.QuadPart > size) {
+		size = (size_t)fileSize.QuadPart;
+	}
+	if (size == 0) {
+		close();
+		return false;
+	}
+
+	// Mapping a view larger than the file extends the file, and the new bytes read as zero
+	LARGE_INTEGER mappingSize;
+	mappingSize.QuadPart = (LONGLONG)size;
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, NULL);
+	if (mappingHandle == NULL) {
+		close();
+		return false;
+	}
+
+	mappedData = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0);
+	if (mappedData == NULL) {
+		close();
+		return false;
+	}
+	mappedSize = size;
+	writable = true;
+	return true;
+}
+
+void MappedFile::close() {
+	if (mappedData != NULL) {
+		UnmapViewOfFile(mappedData);
+	}
+	if (mappingHandle != NULL) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+	}
+	mappedData = NULL;
+	mappedSize = 0;
+	writable = false;
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::flush(size_t offset, size_t length) {
+	if (!writable || offset + length > mappedSize) {
+		return false;
+	}
+	return FlushViewOfFile(mappedData + offset, length) != 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0) {
+		close();
+		return false;
+	}
+
+	// mmap refuses zero-length mappings, so an empty file is simply left unmapped
+	mappedSize = (size_t)info.st_size;
+	if (mappedSize == 0) {
+		return true;
+	}
+
+	void* view = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED) {
+		close();
+		return false;
+	}
+	mappedData = (unsigned char*)view;
+	return true;
+}
+
+bool MappedFile::openWritable(const std::string& path, size_t size) {
+	close();
+
+	fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fileDescriptor < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0) {
+		close();
+		return false;
+	}
+	if ((size_t)info.st_size > size) {
+		size = (size_t)info.st_size;
+	}
+	// ftruncate zero-fills the bytes it adds
+	if (size == 0 || ((size_t)info.st_size < size && ftruncate(fileDescriptor, (off_t)size) != 0)) {
+		close();
+		return false;
+	}
+
+	void* view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if (view == MAP_FAILED) {
+		close();
+		return false;
+	}
+	mappedData = (unsigned char*)view;
+	mappedSize = size;
+	writable = true;
+	return true;
+}
+
+void MappedFile::close() {
+	if (mappedData != NULL) {
+		munmap(mappedData, mappedSize);
+	}
+	if (fileDescriptor >= 0) {
+		::close(fileDescriptor);
+	}
+	mappedData = NULL;
+	mappedSize = 0;
+	writable = false;
+	fileDescriptor = -1;
+}
+
+bool MappedFile::flush(size_t offset, size_t length) {
+	if (!writable || offset + length > mappedSize) {
+		return false;
+	}
+	// msync wants a page-aligned start address
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = offset - (offset % pageSize);
+	return msync(mappedData + start, offset + length - start, MS_SYNC) == 0;
+}
+
+#endif
+
+const unsigned char* MappedFile::data() const {
+	return mappedData;
+}
+
+size_t MappedFile::size() const {
+	return mappedSize;
+}
+
+unsigned char* MappedFile::writableData() {
+	return writable ? mappedData : NULL;
+}
@@ -0,0 +1,64 @@
+/*
+* Declares a MappedFile class, which maps a file on disk into memory so that its bytes can be read in place.
+* Used to load serialized ASTs without copying them into a separate buffer first, and (in writable mode) to back
+* on-disk structures such as the ResultCache that must survive a restart.
+*
+*  Sample usage:
+*   MappedFile file;
+*   if (file.open("corpus.sast")) {
+*     const unsigned char* bytes = file.data(); size_t size = file.size();
+*   }
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_MAPPEDFILE_H_
+#define SCALP_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+	// Start and length of the mapped view; data is NULL while nothing is mapped
+	unsigned char* mappedData;
+	size_t mappedSize;
+	bool writable;
+
+	// Platform specific handles (a HANDLE pair on Windows, a file descriptor elsewhere)
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	// A mapping owns OS resources, so copying one would unmap it twice
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the whole file at path read-only; returns false if the file cannot be opened or mapped
+	// An empty file opens successfully with data() == NULL and size() == 0
+	bool open(const std::string& path);
+
+	// Maps the file at path read-write so that stores go straight to the file, creating it if it does not exist
+	// The file is grown (zero-filled) to at least size bytes first; returns false on failure
+	bool openWritable(const std::string& path, size_t size);
+
+	// Unmaps the file; safe to call when nothing is mapped
+	void close();
+
+	// Asks the OS to write [offset, offset + length) of a writable mapping back to disk before returning
+	bool flush(size_t offset, size_t length);
+
+	const unsigned char* data() const;
+	size_t size() const;
+
+	// Same bytes as data(), but NULL unless the file was opened with openWritable()
+	unsigned char* writableData();
+};
+
+#endif // SCALP_MAPPEDFILE_H_
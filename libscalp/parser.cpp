@@ -6,76 +6,154 @@
 */
 
 #include "parser.h"
+#include "analysis.h"
+#include "arena.h"
 #include "ast.h"
+#include "budget.h"
+#include "liketerms.h"
+#include "stats.h"
+#include "symbols.h"
+#include "trace.h"
 #include <ctype.h>
+#include <string.h>
 #include <stdlib.h>
 #include <sstream>
 
+// Constructor
+Parser::Parser() {
+	this->text = NULL;
+	this->index = 0;
+	this->arena = NULL;
+	this->token.type = endOfText;
+	this->token.value = 0;
+	this->token.symbol = 0;
+	this->token.variable = -1;
+}
+
+void Parser::setArena(NodeArena* t_arena) {
+	this->arena = t_arena;
+}
+
 // Parse expression passed in as t_text and return an AST; this is the main function of the class
-ASTNode* Parser::parse(const char* t_text) {
+ASTNode* Parser::parse(const char* t_text) const {
+	Parser run(*this);
+	return run.parseText(t_text);
+}
+
+ASTNode* Parser::parseText(const char* t_text) {
 	this->text = t_text;
 	this->index = 0;
-	this->getNextToken();
+	ASTNode* ast;
+	{
+		PhaseTimer timer(phaseParse);
+		this->getNextToken();
+		ast = this->expression();
 
-	ASTNode* ast = this->expression();
+		// Anything left over (an unmatched ')', for instance) would otherwise be silently ignored
+		if (token.type != endOfText) {
+			std::stringstream sstr;
+			sstr << "Unexpected token '" << text[index - 1] << "' at position: " << index - 1 << ".";
+			if (arena == NULL) delete ast; // Arena nodes go when the arena is reset
+			throw ParserException(sstr.str(), index - 1);
+		}
+		analyzeTree(ast);
+	}
 
 	//Simplify ast
-	for (int i = 0; i < 100; i++) {
-		ast = simplify(ast);
+	PhaseTimer timer(phaseSimplify);
+	ast = simplifyIdentities(ast);
+
+	// Then like terms and like factors are combined, in one bottom-up pass (see liketerms.h); a term that came to 0
+	// is left for the identity rules to take out
+	LikeTerms collector(arena);
+	bool collected = false;
+	ast = collector.collect(ast, collected);
+	if (collected) {
+		ast = simplifyIdentities(ast);
 	}
 
 	return ast;
 }
 
+ASTNode* Parser::simplifyIdentities(ASTNode* t_ast) {
+	ASTNode* ast = t_ast;
+	for (int i = 0; i < 100; i++) {
+		Budget::checkDeadline();
+		bool changed = false;
+		ast = simplify(ast, changed);
+		if (!changed) break; // Another pass over an unchanged tree would not change it either
+	}
+	return ast;
+}
+
+// Counts (and traces) one identity rewrite done by simplify()
+static inline void recordRewrite(int rewrite, const ASTNode* ast) {
+	Stats::count(counterSimplifyRewrites);
+	Trace::transform(rewrite, ast);
+}
+
 // Takes in a AST a returns a more simplified AST
 // Should be called multiple times to fully simplify a AST
-ASTNode* Parser::simplify(ASTNode* t_ast)
+ASTNode* Parser::simplify(ASTNode* t_ast, bool& changed)
 {
 	ASTNode* ast = t_ast;
+	bool childChanged = false, rewritten = false;
 
 	// Move down the tree
 	if ((ast->left != NULL)) {
-		simplify(ast->left);
+		simplify(ast->left, childChanged);
 	}
 	if ((ast->right != NULL)) {
-		simplify(ast->right);
+		simplify(ast->right, childChanged);
 	}
 
 	// Use identity rules (x^1 = x, x*1 = x; x+0 = x) to simplify bottom of tree where ast->left here is a number
 	if (((ast->left != NULL) && (ast->left->type == numberValue) && (ast->right != NULL) && (ast->right->type == numberValue)) && (((ast->type == operatorPower) && (ast->left->value == 1)) || ((ast->type == operatorPower) && (ast->right->value == 1)) || ((ast->type == operatorMul) && (ast->right->value == 1)) || ((ast->type == operatorPlus) && (ast->right->value == 0)))) {
 		ast->type = numberValue; ast->value = ast->left->value; ast->left = NULL; ast->right = NULL;
+		recordRewrite(1, ast); rewritten = true;
 	}
 
 	// Use identity rules (x^1 = x, x*1 = x; x+0 = x) to simplify bottom of tree where ast->left here is a variable
 	else if (((ast->left != NULL) && (ast->left->type == variableChar) && (ast->right != NULL) && (ast->right->type == numberValue)) && (((ast->type == operatorPower) && (ast->right->value == 1)) || ((ast->type == operatorMul) && (ast->right->value == 1)) || ((ast->type == operatorPlus) && (ast->right->value == 0)))) {
-		ast->type = variableChar; ast->var = ast->left->var; ast->left = NULL; ast->right = NULL;
+		ast->type = variableChar; ast->symbol = ast->left->symbol; ast->left = NULL; ast->right = NULL;
+		recordRewrite(2, ast); rewritten = true;
 	}
 
 	// Use identity rules (x^1 = x, x*1 = x; x+0 = x) to simplify bottom of tree where ast->left here is a function
 	else if  ( (ast->left != NULL) &&  ((ast->left->type == functionSin) || (ast->left->type == functionCos) || (ast->left->type == functionTan) || (ast->left->type == functionSec) || (ast->left->type == functionCsc) || (ast->left->type == functionCot) || (ast->type == functionLog) || (ast->type == functionLn)) && (ast->right != NULL) && (ast->right->type == numberValue) && (((ast->type == operatorPower) && (ast->left->value == 1)) || ((ast->type == operatorPower) && (ast->right->value == 1)) || ((ast->type == operatorMul) && (ast->right->value == 1)) || ((ast->type == operatorPlus) && (ast->right->value == 0))) ) {
 		ast->type = ast->left->type; ast->left = ast->left->left; ast->right = NULL;
+		recordRewrite(3, ast); rewritten = true;
 	}
 
 	// Use identity rules (x^1 = x, x*1 = x; x+0 = x) to simplify bottom of tree 
 	else if (((ast->left != NULL) && (ast->left->type == numberValue) && (ast->right != NULL) && (ast->right->type == numberValue)) && (((ast->type == operatorMul) && (ast->left->value == 1)) || ((ast->type == operatorPlus) && (ast->left->value == 0)))) {
 		ast->type = numberValue; ast->value = ast->right->value; ast->left = NULL; ast->right = NULL;
+		recordRewrite(4, ast); rewritten = true;
 	}
 	else if (((ast->left != NULL) && (ast->left->type == numberValue) && (ast->right != NULL) && (ast->right->type == variableChar)) && (((ast->type == operatorMul) && (ast->left->value == 1)) || ((ast->type == operatorPlus) && (ast->left->value == 0)))) {
-		ast->type = variableChar; ast->var = ast->right->var; ast->left = NULL; ast->right = NULL;
+		ast->type = variableChar; ast->symbol = ast->right->symbol; ast->left = NULL; ast->right = NULL;
+		recordRewrite(5, ast); rewritten = true;
 	}
 
 	// Use identity rules (x^1 = x, x*1 = x; x+0 = x) to simplify top of tree
 	if (ast->left != NULL && ast->left->left != NULL && ast->left->right != NULL) {
 		if (((ast->type == operatorPower) && (ast->right->type == numberValue) && (ast->right->value == 1)) || ((ast->type == operatorMul) && (ast->right->type == numberValue) && (ast->right->value == 1)) || ((ast->type == operatorPlus) && (ast->right->type == numberValue) && (ast->right->value == 0))) {
 			ast->type = ast->left->type; ast->right = ast->left->right; ast->left = ast->left->left;
+			recordRewrite(6, ast); rewritten = true;
 		}
 	}
 	else if (ast->right != NULL && ast->right->left != NULL && ast->right->right != NULL) {
 		if (((ast->type == operatorPower) && (ast->left->type == numberValue) && (ast->left->value == 1)) || ((ast->type == operatorMul) && (ast->left->type == numberValue) && (ast->left->value == 1)) || ((ast->type == operatorPlus) && (ast->left->type == numberValue) && (ast->left->value == 0))) {
 			ast->type = ast->right->type; ast->left = ast->right->left; ast->right = ast->right->right;
+			recordRewrite(7, ast); rewritten = true;
 		}
 	}
-	
+
+	// Children are done, so this node's cached attributes can be brought up to date in O(1)
+	if (rewritten || childChanged) {
+		analyzeNode(ast);
+		changed = true;
+	}
 	return ast;
 }
 
@@ -92,6 +170,7 @@ void Parser::getNextToken() {
 	skipWhitespaces();
 	token.value = 0;
 	token.symbol = 0;
+	token.variable = -1;
 
 	// If we have reached the end of text, then this token is endOfText
 	if (text[index] == 0) {
@@ -118,6 +197,9 @@ void Parser::getNextToken() {
 		}
 		else {
 			token.type = variable;
+			token.symbol = text[index];
+			token.variable = getVariable();
+			return;
 		}
 	}
 	else {
@@ -180,6 +262,27 @@ double Parser::getNumber() {
 	return atof(buffer);
 }
 
+// Returns the symbol id of the variable name at the current location in the expression
+// A name is one letter, optionally followed by '_' and then letters, digits and underscores (x, x_1 and v_max are all names)
+int Parser::getVariable() {
+	size_t start = index;
+	index++;
+	if (text[index] == '_' && isalnum(text[index + 1])) {
+		index++;
+		while (isalnum(text[index]) || text[index] == '_') {
+			index++;
+		}
+	}
+
+	int id = SymbolTable::intern(text + start, index - start);
+	if (id < 0) {
+		std::stringstream sstr;
+		sstr << "Too many distinct variable names; cannot add the one at position: " << start << ".";
+		throw ParserException(sstr.str(), start);
+	}
+	return id;
+}
+
 // Helper method called by Parser::getFunction() to make sure a function is followed by parentheses
 void Parser::requireParen(){
 	if (text[index] != '('){
@@ -357,39 +460,40 @@ ASTNode* Parser::exponent(){
 	}
 	case variable:
 	{
-		char var = token.symbol;
+		int symbol = token.variable;
 		getNextToken();
-		return createVariableNode(var);
+		return createVariableNode(symbol);
 	}
+	// A function's argument is only the parenthesized expression that follows it, so sin(x)5 is sin(x)*5
 	case sine: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionSin, node, NULL);
 	case cosine: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionCos, node, NULL);
 	case tangent: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionTan, node, NULL);
 	case secant: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionSec, node, NULL);
 	case cosecant: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionCsc, node, NULL);
 	case cotangent: 
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionCot, node, NULL);
 	case unaryLog:
 	{
 		getNextToken();
 		ASTNode *baseNode = createNumberNode(10);
-		node = expression();
+		node = exponent();
 		return createNode(functionLog, baseNode, node);
 	}
 	case binaryLog:
@@ -402,12 +506,12 @@ ASTNode* Parser::exponent(){
 			sstr << "Expected ',' at position: " << index << ".";
 			throw ParserException(sstr.str(), index);
 		}
-		node = expression();
+		node = exponent(); // The opening parenthesis is still the current token, so this reads the argument up to ')'
 		return createNode(functionLog, baseNode, node);
 	}
 	case naturalLog:
 		getNextToken();
-		node = expression();
+		node = exponent();
 		return createNode(functionLn, node, NULL);
 	default:
 		std::stringstream sstr;
@@ -428,9 +532,16 @@ void Parser::match(char expected) {
 	}
 }
 
+// Returns a blank node from the arena if there is one, or from the heap otherwise
+ASTNode* Parser::allocateNode() {
+	Stats::count(counterNodesAllocated);
+	Budget::chargeNodes(1);
+	return (arena != NULL) ? arena->allocate() : new ASTNode;
+}
+
 // Creates a node that looks like this [type]-[]-[]-[LEFT]-[RIGHT]
 ASTNode* Parser::createNode(ASTNodeType type, ASTNode* left, ASTNode* right) {
-	ASTNode* node = new ASTNode;
+	ASTNode* node = allocateNode();
 	node->type = type;
 	node->left = left;
 	node->right = right;
@@ -439,7 +550,7 @@ ASTNode* Parser::createNode(ASTNodeType type, ASTNode* left, ASTNode* right) {
 
 // Creates a node that looks like this [unaryMinus]-[]-[]-[LEFT]-[]
 ASTNode* Parser::createUnaryMinusNode(ASTNode* left) {
-	ASTNode* node = new ASTNode;
+	ASTNode* node = allocateNode();
 	node->type = unaryMinus;
 	node->left = left;
 	node->right = NULL;
@@ -448,20 +559,22 @@ ASTNode* Parser::createUnaryMinusNode(ASTNode* left) {
 
 // Creates a leaf node that looks like this [numberValue]-[value]-[]-[]-[]
 ASTNode* Parser::createNumberNode(double value) {
-	ASTNode* node = new ASTNode;
+	ASTNode* node = allocateNode();
 	node->type = numberValue;
 	node->value = value;
 	return node;
 }
 
-// Creates a leaf node that looks like this [variableChar]-[]-[var]-[]-[]
-ASTNode* Parser::createVariableNode(char var) {
-	ASTNode* node = new ASTNode;
+// Creates a leaf node that looks like this [variableChar]-[]-[symbol]-[]-[]
+ASTNode* Parser::createVariableNode(int symbol) {
+	ASTNode* node = allocateNode();
 	node->type = variableChar;
-	node->var = var;
+	node->symbol = symbol;
 	return node;
 }
 
 // Implementation of ParserException method used to throw exceptions with custom messages
-// Yes, the curly brackets are supposed to be empty
-ParserException::ParserException(const std::string& message, int pos) : std::exception(message.c_str()), position(pos) {};
+// The body only counts the exception for the pipeline stats
+ParserException::ParserException(const std::string& message, int pos) : std::runtime_error(message), position(pos) {
+	Stats::count(counterExceptions);
+};
@@ -16,10 +16,12 @@
 #ifndef SCALP_PARSER_H_
 #define SCALP_PARSER_H_
 
-#include <exception>
+#include <stdexcept>
 #include <string>
 #include "ast.h"
 
+class NodeArena;
+
 //Let TokenType::error = 0, TokenType::plus = 1, and so on
 //Also limits TokenType to these tokens
 enum TokenType {
@@ -60,6 +62,9 @@ struct Token {
 	// Used to store the token's symbol if it is a non-numeric character
 	char symbol;
 
+	// Used to store the variable's id in the SymbolTable (see symbols.h) if it is a variable
+	int variable;
+
 	// Used to store the token's abbreviated function name (sin, cos, etc) if it is a function
 	//char function[3];
 };
@@ -76,12 +81,18 @@ class Parser {
 	// size_t is the type commonly used to represent sizes (as its name implies) and counts (like indexes), but can also be used as an unsigned int
 	size_t index;
 
+	// Where new nodes are placed; NULL means they are allocated on the heap with new
+	NodeArena* arena;
+
 	// Extracts the next token in the expression
 	void getNextToken();
 
 	// Returns the number at the current location in the expression
 	double getNumber();
 
+	// Returns the symbol id of the variable name at the current location in the expression
+	int getVariable();
+
 	// Small helper method called by getFunction() in order to reduce the amount of code retyped
 	// Checks to see if a function is followed by parentheses
 	void requireParen();
@@ -103,10 +114,11 @@ class Parser {
 	ASTNode* exponent();
 
 	// Used for AST node creation
+	ASTNode* allocateNode();
 	ASTNode* createNode(ASTNodeType type, ASTNode* left, ASTNode* right);
 	ASTNode* createUnaryMinusNode(ASTNode* left);
 	ASTNode* createNumberNode(double value);
-	ASTNode* createVariableNode(char var);
+	ASTNode* createVariableNode(int symbol);
 
 	// Used to match parentheses
 	void match(char expected);
@@ -114,17 +126,30 @@ class Parser {
 	// Skips all whitespaces between two tokens
 	void skipWhitespaces();
 
-	// Simplifies a given AST and returns the simplified AST
-	ASTNode* simplify(ASTNode* t_ast);
+	// Simplifies a given AST and returns the simplified AST; sets changed if any node below was rewritten
+	ASTNode* simplify(ASTNode* t_ast, bool& changed);
+
+	// Applies simplify() until the tree stops changing, and returns the simplified AST
+	ASTNode* simplifyIdentities(ASTNode* t_ast);
+
+	// Does the work of parse() on this copy
+	ASTNode* parseText(const char* t_text);
 	
 public:
+	Parser();
+
 	// Parse expression passed in as t_text
-	ASTNode* parse(const char* t_text);
+	// The text, position and current token live in a copy of the Parser made for each call, so one Parser may be used
+	// by several threads at once, as long as they do not share an arena
+	ASTNode* parse(const char* t_text) const;
+
+	// Places the nodes of every tree parsed from now on in t_arena (see arena.h); pass NULL to go back to the heap
+	void setArena(NodeArena* t_arena);
 
 };
 
-// Custom ParserException class derived from the base exception class defined in the standard library
-class ParserException : public std::exception{
+// Custom ParserException class derived from std::runtime_error, which keeps a copy of the message for what()
+class ParserException : public std::runtime_error{
 	int position; //The position (AKA the index) at which the exception occurs
 
 public:
@@ -0,0 +1,338 @@
+/*
+* Implements the PartsIntegrals class in partsintegrals.h
+* See comments in partsintegrals.h for more details
+*/
+
+#include "partsintegrals.h"
+#include "formatter.h"
+#include "fraction.h"
+#include "symbols.h"
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+enum PartsTrig { trigNone, trigSin, trigCos };
+
+// ln(x)^lnPower * x^xPower * trig(x) * e^x (when exponential), any of which may be missing
+struct PartsTerm {
+	unsigned int lnPower;
+	unsigned int xPower;
+	PartsTrig trig;
+	bool exponential;
+};
+
+// A sum of terms, plus multiples of integrals still in progress: (level on the stack, coefficient)
+struct PartsSum {
+	std::vector<Fraction> coefficients;
+	std::vector<PartsTerm> terms;
+	std::vector<std::pair<size_t, Fraction> > pending;
+};
+
+struct PartsMemo {
+	std::mutex mutex; // Guards results, and is held for a whole integrate()
+	std::unordered_map<unsigned long long, PartsSum> results;
+};
+
+// Created on first use, and never destroyed, as it holds nothing but memory
+static PartsMemo& partsMemo() {
+	static PartsMemo* memo = new PartsMemo;
+	return *memo;
+}
+
+// What one integrate() call is working on
+struct PartsSearch {
+	PartsMemo& memo;
+	std::vector<unsigned long long> open; // Keys of the integrals in progress, outermost first
+};
+
+static unsigned long long termKey(const PartsTerm& term) {
+	return ((unsigned long long)term.lnPower << 32) | ((unsigned long long)term.xPower << 8) | (term.trig << 1) | (term.exponential ? 1 : 0);
+}
+
+static PartsTerm makeTerm(unsigned int lnPower, unsigned int xPower, PartsTrig trig, bool exponential) {
+	PartsTerm term = { lnPower, xPower, trig, exponential };
+	return term;
+}
+
+// Adds coefficient * term to sum, merging it with a term of the same shape if there is one
+static bool addTerm(PartsSum& sum, Fraction coefficient, const PartsTerm& term) {
+	for (size_t i = 0; i < sum.terms.size(); i++) {
+		if (termKey(sum.terms[i]) == termKey(term)) {
+			return add(sum.coefficients[i], coefficient, sum.coefficients[i]);
+		}
+	}
+	sum.coefficients.push_back(coefficient);
+	sum.terms.push_back(term);
+	return true;
+}
+
+static bool addPending(PartsSum& sum, size_t level, Fraction coefficient) {
+	for (size_t i = 0; i < sum.pending.size(); i++) {
+		if (sum.pending[i].first == level) {
+			return add(sum.pending[i].second, coefficient, sum.pending[i].second);
+		}
+	}
+	sum.pending.push_back(std::make_pair(level, coefficient));
+	return true;
+}
+
+// Adds scale * other to sum
+static bool addScaled(PartsSum& sum, Fraction scale, const PartsSum& other) {
+	Fraction product;
+	for (size_t i = 0; i < other.terms.size(); i++) {
+		if (!multiply(scale, other.coefficients[i], product) || !addTerm(sum, product, other.terms[i])) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < other.pending.size(); i++) {
+		if (!multiply(scale, other.pending[i].second, product) || !addPending(sum, other.pending[i].first, product)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool integrateTerm(PartsSearch& search, const PartsTerm& term, PartsSum& result);
+
+// Sets result to scale * (the integral of term)
+static bool addIntegral(PartsSearch& search, PartsSum& result, Fraction scale, const PartsTerm& term) {
+	PartsSum integral;
+	return integrateTerm(search, term, integral) && addScaled(result, scale, integral);
+}
+
+// One step of parts on term, or its integral outright if it has a single factor
+static bool applyParts(PartsSearch& search, const PartsTerm& term, PartsSum& result) {
+	long long k = term.lnPower, n = term.xPower;
+
+	// u = ln(x)^k, dv = x^n: u*v = ln(x)^k * x^(n+1)/(n+1), and v du = k/(n+1) * ln(x)^(k-1) * x^n
+	if (k > 0) {
+		if (term.trig != trigNone || term.exponential) {
+			return false; // Leads to the sine and exponential integrals, which have no closed form
+		}
+		return addTerm(result, fraction(1, n + 1), makeTerm(term.lnPower, term.xPower + 1, trigNone, false))
+			&& addIntegral(search, result, fraction(-k, n + 1), makeTerm(term.lnPower - 1, term.xPower, trigNone, false));
+	}
+
+	// u = x^n, dv = the rest: u*v is x^n times each term of v, and v du is n*x^(n-1) times each of them
+	if (n > 0) {
+		if (term.trig == trigNone && !term.exponential) {
+			return addTerm(result, fraction(1, n + 1), makeTerm(0, term.xPower + 1, trigNone, false));
+		}
+		PartsSum v;
+		if (!integrateTerm(search, makeTerm(0, 0, term.trig, term.exponential), v) || !v.pending.empty()) {
+			return false;
+		}
+		for (size_t i = 0; i < v.terms.size(); i++) {
+			PartsTerm uv = v.terms[i], vdu = v.terms[i];
+			uv.xPower += term.xPower;
+			vdu.xPower += term.xPower - 1;
+			Fraction scale;
+			if (!addTerm(result, v.coefficients[i], uv) || !multiply(fraction(-n, 1), v.coefficients[i], scale)
+				|| !addIntegral(search, result, scale, vdu)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// u = sin(x) or cos(x), dv = e^x: u*v = e^x*sin(x), and v du = e^x*cos(x) (or -e^x*sin(x) for cos)
+	if (term.trig != trigNone && term.exponential) {
+		PartsTrig derivative = (term.trig == trigSin) ? trigCos : trigSin;
+		long long sign = (term.trig == trigSin) ? -1 : 1;
+		return addTerm(result, fraction(1, 1), term)
+			&& addIntegral(search, result, fraction(sign, 1), makeTerm(0, 0, derivative, true));
+	}
+
+	if (term.trig == trigSin) {
+		return addTerm(result, fraction(-1, 1), makeTerm(0, 0, trigCos, false));
+	}
+	if (term.trig == trigCos) {
+		return addTerm(result, fraction(1, 1), makeTerm(0, 0, trigSin, false));
+	}
+	if (term.exponential) {
+		return addTerm(result, fraction(1, 1), term);
+	}
+	return addTerm(result, fraction(1, 1), makeTerm(0, 1, trigNone, false));
+}
+
+static bool integrateTerm(PartsSearch& search, const PartsTerm& term, PartsSum& result) {
+	unsigned long long key = termKey(term);
+	std::unordered_map<unsigned long long, PartsSum>::const_iterator found = search.memo.results.find(key);
+	if (found != search.memo.results.end()) {
+		result = found->second;
+		return true;
+	}
+
+	// Asked for again while it is being worked out: it stays an unknown until its own level solves for it
+	for (size_t level = 0; level < search.open.size(); level++) {
+		if (search.open[level] == key) {
+			return addPending(result, level, fraction(1, 1));
+		}
+	}
+	if (search.open.size() >= MAX_PARTS_DEPTH) {
+		return false;
+	}
+
+	size_t level = search.open.size();
+	search.open.push_back(key);
+	bool integrated = applyParts(search, term, result);
+	search.open.pop_back();
+	if (!integrated) {
+		return false;
+	}
+
+	// I = rest + c*I, so I = rest / (1 - c)
+	for (size_t i = 0; i < result.pending.size(); i++) {
+		if (result.pending[i].first != level) {
+			continue;
+		}
+		Fraction remaining;
+		if (!add(fraction(1, 1), fraction(-result.pending[i].second.numerator, result.pending[i].second.denominator), remaining)
+			|| remaining.numerator == 0) {
+			return false;
+		}
+		result.pending.erase(result.pending.begin() + i);
+		PartsSum solved;
+		if (!addScaled(solved, fraction(remaining.denominator, remaining.numerator), result)) {
+			return false;
+		}
+		result = solved;
+		break;
+	}
+
+	if (result.pending.empty()) {
+		search.memo.results[key] = result;
+	}
+	return true;
+}
+
+// Multiplies the factors of a product into term and coefficient; base is set to the text of e if there is an e^x
+static bool collectFactors(const ASTNode* ast, int variable, PartsTerm& term, long long& coefficient, std::string& base) {
+	if (ast == NULL) {
+		return false;
+	}
+	if (ast->type == operatorMul) {
+		return collectFactors(ast->left, variable, term, coefficient, base)
+			&& collectFactors(ast->right, variable, term, coefficient, base);
+	}
+	if (ast->type == numberValue) {
+		if (ast->value == 0 || ast->value != floor(ast->value) || fabs(ast->value) > 1e6) {
+			return false;
+		}
+		coefficient *= (long long)ast->value;
+		return llabs(coefficient) <= 1000000000000LL;
+	}
+
+	// e^x, with e a number
+	if (ast->type == operatorPower && ast->left != NULL && ast->left->type == numberValue && ast->right != NULL
+		&& ast->right->type == variableChar && ast->right->symbol == variable) {
+		if (term.exponential || ast->left->value <= 0 || fabs(log(ast->left->value) - 1) > 1e-12) {
+			return false;
+		}
+		term.exponential = true;
+		Formatter formatter;
+		base = formatter.format(ast->left);
+		return true;
+	}
+
+	const ASTNode* factor = ast;
+	double exponent = 1;
+	if (ast->type == operatorPower) {
+		if (ast->right == NULL || ast->right->type != numberValue) {
+			return false;
+		}
+		factor = ast->left;
+		exponent = ast->right->value;
+	}
+	if (exponent < 0 || exponent > MAX_PARTS_DEPTH || exponent != floor(exponent) || factor == NULL) {
+		return false;
+	}
+
+	if (factor->type == variableChar && factor->symbol == variable) {
+		term.xPower += (unsigned int)exponent;
+		return term.xPower <= MAX_PARTS_DEPTH;
+	}
+	if (factor->left == NULL || factor->left->type != variableChar || factor->left->symbol != variable) {
+		return false;
+	}
+	if (factor->type == functionLn) {
+		term.lnPower += (unsigned int)exponent;
+		return term.lnPower <= MAX_PARTS_DEPTH;
+	}
+	if ((factor->type == functionSin || factor->type == functionCos) && exponent <= 1) {
+		if (exponent == 0) {
+			return true;
+		}
+		if (term.trig != trigNone) {
+			return false; // Products of sines and cosines are for TrigIntegrals
+		}
+		term.trig = (factor->type == functionSin) ? trigSin : trigCos;
+		return true;
+	}
+	return false;
+}
+
+bool PartsIntegrals::integrate(const ASTNode* ast, int variable, std::string& solution) {
+	PartsTerm term = makeTerm(0, 0, trigNone, false);
+	long long coefficient = 1;
+	std::string base;
+	if (!collectFactors(ast, variable, term, coefficient, base)) {
+		return false;
+	}
+
+	PartsSum integral;
+	{
+		PartsMemo& memo = partsMemo();
+		std::lock_guard<std::mutex> lock(memo.mutex);
+		PartsSearch search = { memo, std::vector<unsigned long long>() };
+		if (!integrateTerm(search, term, integral)) {
+			return false;
+		}
+	}
+
+	const std::string& name = SymbolTable::name(variable);
+	std::vector<Fraction> coefficients;
+	std::vector<std::string> factors;
+	for (size_t i = 0; i < integral.terms.size(); i++) {
+		Fraction scaled;
+		if (!multiply(fraction(coefficient, 1), integral.coefficients[i], scaled)) {
+			return false;
+		}
+		if (scaled.numerator == 0) {
+			continue;
+		}
+
+		const PartsTerm& t = integral.terms[i];
+		std::vector<std::string> parts;
+		if (t.xPower > 0) {
+			parts.push_back(name + ((t.xPower > 1) ? "^" + std::to_string(t.xPower) : ""));
+		}
+		if (t.lnPower > 0) {
+			parts.push_back("ln(" + name + ")" + ((t.lnPower > 1) ? "^" + std::to_string(t.lnPower) : ""));
+		}
+		if (t.exponential) {
+			parts.push_back(base + "^" + name);
+		}
+		if (t.trig != trigNone) {
+			parts.push_back(((t.trig == trigSin) ? "sin(" : "cos(") + name + ")");
+		}
+		std::string factor;
+		for (size_t k = 0; k < parts.size(); k++) {
+			factor += (k > 0) ? "*" + parts[k] : parts[k];
+		}
+		coefficients.push_back(scaled);
+		factors.push_back(factor);
+	}
+	if (factors.empty()) {
+		return false;
+	}
+	solution = formatTerms(coefficients, factors);
+	return true;
+}
+
+size_t PartsIntegrals::memoized() {
+	PartsMemo& memo = partsMemo();
+	std::lock_guard<std::mutex> lock(memo.mutex);
+	return memo.results.size();
+}
@@ -0,0 +1,50 @@
+/*
+* Declares the PartsIntegrals class, which integrates products of ln(x)^k, x^n, sin(x) or cos(x), and e^x by parts:
+* int u dv = u*v - int v du.
+*
+* u is picked by LIATE order (Logarithm, Inverse trigonometric, Algebraic, Trigonometric, Exponential), so the factor
+* that gets simpler when differentiated is the one that is: ln(x)^k becomes k*ln(x)^(k-1)/x, which cancels against
+* the x^(n+1) from integrating x^n; x^n becomes n*x^(n-1); and sin or cos becomes the other. Parts is applied again to
+* whatever integral is left, at most MAX_PARTS_DEPTH times deep.
+*
+* Integrals such as e^x*sin(x) come back to themselves after two steps instead of getting simpler. Every integral in
+* progress is kept on a stack, so when one is asked for again it is not expanded a second time: it stands for itself
+* as an unknown I, and once its own parts are in, I = rest + c*I is solved as I = rest / (1 - c).
+*
+* Finished integrals are memoised for the whole process by the shape of the product (the powers k and n and which
+* of the other factors are there), so "x*cos(x)" and "cos(x)*x" share one entry and repeated parts over a family of
+* integrands only ever works each one out once. Coefficients are exact fractions (see fraction.h); an answer whose
+* coefficients would overflow 64 bits is left unintegrated.
+*
+* There is no constant e in the grammar, so an exponential is a number equal to e raised to the bare variable, such
+* as 2.718281828459045^x; other bases would need ln of the base in every coefficient and are left alone. Other
+* numbers are allowed as factors if they are whole.
+*
+*  Sample usage:
+*   std::string solution;
+*   if (PartsIntegrals::integrate(ast, SymbolTable::letter('x'), solution)) { ... } // "(x*sin(x) + cos(x))"
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_PARTSINTEGRALS_H_
+#define SCALP_PARTSINTEGRALS_H_
+
+#include "ast.h"
+#include <string>
+
+// Most integrals by parts in progress at once, counting the ones for dv; also the highest power of x or ln(x) taken
+const unsigned int MAX_PARTS_DEPTH = 24;
+
+class PartsIntegrals
+{
+public:
+	// Integrates ast with respect to the variable with symbol id variable (see symbols.h) if it is one of the
+	// products above; returns false, leaving solution alone, otherwise. Answers are written like those of
+	// TrigIntegrals::integrate().
+	static bool integrate(const ASTNode* ast, int variable, std::string& solution);
+
+	// Number of integrals memoised so far
+	static size_t memoized();
+};
+
+#endif // SCALP_PARTSINTEGRALS_H_
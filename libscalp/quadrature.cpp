@@ -0,0 +1,239 @@
+/*
+* Implements the Quadrature class in quadrature.h
+* See comments in quadrature.h for more details
+*/
+
+#include "quadrature.h"
+#include "budget.h"
+#include "compiledfunction.h"
+#include "interval.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Abscissae and weights of the 7-point Gauss and 15-point Kronrod rules on [-1, 1], from QUADPACK
+// The Kronrod nodes are listed from the outside in; every odd one is also a Gauss node, as is the centre
+const double KRONROD_NODES[8] = {
+	0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+	0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+	0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+	0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+};
+const double KRONROD_WEIGHTS[8] = {
+	0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+	0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+	0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+	0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+const double GAUSS_WEIGHTS[4] = {
+	0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+	0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+const size_t KRONROD_POINTS = 15;
+
+// Below this many node evaluations in a round, starting threads costs more than it saves
+const size_t PARALLEL_MIN_WORK = 1 << 15;
+
+// Intervals bisected per round for each thread
+const size_t INTERVALS_PER_THREAD = 4;
+
+struct Interval {
+	double lower;
+	double upper;
+	double value;
+	double error;
+};
+
+// Orders the heap so that the interval with the largest error is on top
+static bool smallerError(const Interval& a, const Interval& b) {
+	return a.error < b.error;
+}
+
+static size_t countNodes(const ASTNode* ast) {
+	return (ast == NULL) ? 0 : 1 + countNodes(ast->left) + countNodes(ast->right);
+}
+
+// Fills in the value and error of interval with the 15-point Kronrod rule and the embedded 7-point Gauss rule
+static void estimate(Interval& interval, const CompiledFunction& integrand) {
+	double center = 0.5 * (interval.lower + interval.upper);
+	double halfLength = 0.5 * (interval.upper - interval.lower);
+
+	double points[KRONROD_POINTS];
+	double values[KRONROD_POINTS];
+	for (int k = 0; k < 7; k++) {
+		points[k] = center - halfLength * KRONROD_NODES[k];
+		points[14 - k] = center + halfLength * KRONROD_NODES[k];
+	}
+	points[7] = center;
+	integrand.evaluateBatch(points, values, KRONROD_POINTS);
+
+	double kronrod = KRONROD_WEIGHTS[7] * values[7];
+	double gauss = GAUSS_WEIGHTS[3] * values[7];
+	for (int k = 0; k < 7; k++) {
+		double pair = values[k] + values[14 - k];
+		kronrod += KRONROD_WEIGHTS[k] * pair;
+		if (k % 2 == 1) {
+			gauss += GAUSS_WEIGHTS[k / 2] * pair;
+		}
+	}
+
+	interval.value = kronrod * halfLength;
+	interval.error = std::isfinite(interval.value) ? fabs((kronrod - gauss) * halfLength) : INFINITY;
+}
+
+// Estimates intervals[first, last); each thread of a parallel round runs one of these
+static void estimateRange(std::vector<Interval>* intervals, size_t first, size_t last, const CompiledFunction* integrand) {
+	for (size_t i = first; i < last; i++) {
+		estimate((*intervals)[i], *integrand);
+	}
+}
+
+// Joins the threads of a parallel round on every way out of it
+struct ThreadJoiner {
+	std::vector<std::thread> threads;
+
+	~ThreadJoiner() {
+		for (size_t i = 0; i < threads.size(); i++) {
+			if (threads[i].joinable()) threads[i].join();
+		}
+	}
+};
+
+// Constructor
+QuadratureOptions::QuadratureOptions() {
+	this->absoluteTolerance = 1e-12;
+	this->relativeTolerance = 1e-10;
+	this->maxIntervals = 2000;
+	this->deadlineSeconds = 0.05;
+	this->threads = 1;
+}
+
+// Constructor
+Quadrature::Quadrature() {
+}
+
+void Quadrature::setOptions(const QuadratureOptions& t_options) {
+	this->options = t_options;
+}
+
+QuadratureResult Quadrature::integrate(const ASTNode* ast, int variable, double lower, double upper, const Evaluator& bindings) const {
+	if (ast == NULL) {
+		throw EvaluatorException("Abstract syntax tree is NULL");
+	}
+	if (!std::isfinite(lower) || !std::isfinite(upper)) {
+		throw EvaluatorException("Numerical integration needs finite bounds");
+	}
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.deadlineSeconds));
+	static const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency()); // Not free to ask for
+	unsigned int threads = (options.threads != 0) ? options.threads : hardwareThreads;
+	size_t nodes = countNodes(ast);
+
+	// Integrands that only use the variable are compiled once per process; compiling throws here, on the calling
+	// thread, for an integrand that cannot be evaluated (an unbound variable, say), and evaluating never throws
+	const CompiledFunction* integrand = CompiledFunction::cached(ast, variable);
+	CompiledFunction bound;
+	if (integrand == NULL) {
+		bound = CompiledFunction(ast, variable, bindings);
+		integrand = &bound;
+	}
+
+	// A range wholly outside the integrand's domain is rejected without sampling it
+	QuadratureResult result;
+	IntervalEvaluator ranges(variable, bindings);
+	if (ranges.evaluate(ast, std::min(lower, upper), std::max(lower, upper)).domain == domainNone) {
+		result.value = NAN;
+		result.error = INFINITY;
+		result.intervals = 1;
+		result.evaluations = 0;
+		result.converged = false;
+		return result;
+	}
+
+	Interval whole = { lower, upper, 0, 0 };
+	estimate(whole, *integrand);
+
+	std::vector<Interval> heap(1, whole);
+	std::vector<Interval> settled; // Too narrow to bisect any further, but still part of the sum
+	std::vector<Interval> children;
+
+	result.evaluations = KRONROD_POINTS;
+	result.converged = false;
+	while (true) {
+		double value = 0, error = 0;
+		for (size_t i = 0; i < heap.size(); i++) { value += heap[i].value; error += heap[i].error; }
+		for (size_t i = 0; i < settled.size(); i++) { value += settled[i].value; error += settled[i].error; }
+		result.value = value;
+		result.error = error;
+		result.intervals = heap.size() + settled.size();
+
+		if (error <= std::max(options.absoluteTolerance, options.relativeTolerance * fabs(value))) {
+			result.converged = true;
+			break;
+		}
+		if (heap.empty() || result.intervals >= options.maxIntervals || std::chrono::steady_clock::now() >= deadline) {
+			break;
+		}
+
+		// Running out of options.seconds still gives an estimate, but running out of the request's Budget throws
+		Budget::checkDeadline();
+
+		// Bisect the worst intervals; more than one per round only pays off when they can be estimated in parallel
+		size_t roundSize = (threads > 1 && 2 * threads * INTERVALS_PER_THREAD * KRONROD_POINTS * nodes >= PARALLEL_MIN_WORK) ? threads * INTERVALS_PER_THREAD : 1;
+		children.clear();
+		for (size_t i = 0; i < roundSize && !heap.empty() && result.intervals + children.size() / 2 < options.maxIntervals; i++) {
+			std::pop_heap(heap.begin(), heap.end(), smallerError);
+			Interval worst = heap.back();
+			heap.pop_back();
+
+			double middle = 0.5 * (worst.lower + worst.upper);
+			if (middle <= std::min(worst.lower, worst.upper) || middle >= std::max(worst.lower, worst.upper)) {
+				settled.push_back(worst);
+				continue;
+			}
+			Interval left = { worst.lower, middle, 0, 0 };
+			Interval right = { middle, worst.upper, 0, 0 };
+			children.push_back(left);
+			children.push_back(right);
+		}
+
+		// Each thread gets a contiguous slice, and results land in fixed slots, so the answer does not depend on timing
+		size_t workers = std::min<size_t>(threads, children.size());
+		if (workers > 1) {
+			ThreadJoiner pool;
+			pool.threads.reserve(workers); // So that adding a started thread cannot throw
+			size_t slice = (children.size() + workers - 1) / workers;
+			size_t started = 1; // Slice 0 is this thread's
+			try {
+				for (size_t w = 1; w < workers; w++) {
+					size_t first = std::min(children.size(), w * slice), last = std::min(children.size(), (w + 1) * slice);
+					pool.threads.push_back(std::thread(estimateRange, &children, first, last, integrand));
+					started = w + 1;
+				}
+			}
+			catch (const std::system_error&) {
+				// Out of threads; the slices that did not get one are estimated here instead
+			}
+			estimateRange(&children, 0, std::min(children.size(), slice), integrand);
+			for (size_t w = started; w < workers; w++) {
+				estimateRange(&children, std::min(children.size(), w * slice), std::min(children.size(), (w + 1) * slice), integrand);
+			}
+		}
+		else {
+			for (size_t i = 0; i < children.size(); i++) {
+				estimate(children[i], *integrand);
+			}
+		}
+		result.evaluations += children.size() * KRONROD_POINTS;
+
+		for (size_t i = 0; i < children.size(); i++) {
+			heap.push_back(children[i]);
+			std::push_heap(heap.begin(), heap.end(), smallerError);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,64 @@
+/*
+* Declares the Quadrature class, which integrates an expression numerically over a finite interval using adaptive
+* Gauss-Kronrod quadrature. Integrator::integrateDefinite() falls back to it when no antiderivative is found.
+*
+* Each interval is estimated with the 15-point Kronrod rule, and its error is the difference from the embedded
+* 7-point Gauss rule. Every round bisects the intervals with the largest errors. Rounds stop when the summed error
+* meets the tolerance, when the interval limit is reached or when the deadline passes. Whichever happens first, the
+* best estimate so far is returned, so the caller always gets an answer within its latency budget and can tell from
+* converged how far to trust it.
+*
+* The 15 points of an interval are evaluated as one batch (see Evaluator::evaluateBatch()). If options.threads
+* allows more than one thread and a round holds enough work, its intervals are spread over that many threads.
+*
+*  Sample usage:
+*   Quadrature quadrature; Evaluator evaluator;
+*   QuadratureResult result = quadrature.integrate(ast, SymbolTable::letter('x'), 0, 1, evaluator);
+*   if (result.converged) std::cout << result.value;
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_QUADRATURE_H_
+#define SCALP_QUADRATURE_H_
+
+#include "ast.h"
+#include "evaluator.h"
+
+struct QuadratureOptions {
+	double absoluteTolerance;
+	double relativeTolerance; // Converged once the error is below either tolerance
+	size_t maxIntervals;
+	double deadlineSeconds; // Wall-clock budget for one integrate() call
+	// Threads per integrate() call, the calling one included; 0 means one per hardware thread. Raise it only when
+	// few calls run at once, since every call that goes parallel starts its own threads
+	unsigned int threads;
+
+	// Defaults: 1e-12 absolute, 1e-10 relative, 2000 intervals, 50 ms, one thread (the caller's)
+	QuadratureOptions();
+};
+
+struct QuadratureResult {
+	double value;
+	double error; // Estimated absolute error of value
+	size_t intervals; // Intervals the range ended up split into
+	size_t evaluations; // Points at which the integrand was evaluated
+	bool converged; // error meets the tolerance; false if the interval limit or the deadline cut the work short
+};
+
+class Quadrature
+{
+	QuadratureOptions options;
+
+public:
+	Quadrature();
+
+	void setOptions(const QuadratureOptions& t_options);
+
+	// Integrates ast with respect to the variable with symbol id variable (see symbols.h) from lower to upper
+	// Other variables take the values bound in bindings; throws an EvaluatorException if one has no value or the
+	// bounds are not finite. An integrand that is undefined somewhere in the range gives a NaN or infinite value; one
+	// that is undefined all over it (see interval.h) gives NaN at once, without being evaluated anywhere.
+	QuadratureResult integrate(const ASTNode* ast, int variable, double lower, double upper, const Evaluator& bindings) const;
+};
+
+#endif // SCALP_QUADRATURE_H_
@@ -0,0 +1,298 @@
+/*
+* Implements the ResultCache class in resultcache.h
+* See comments in resultcache.h for more details
+*
+* File layout (native byte order; the cache is a local file, not an exchange format):
+*   [header]   64 bytes, see ResultCache::Header
+*   [slots]    slotCount * 16 bytes; a slot is free while its hash is 0
+*   [records]  dataCapacity bytes; records are appended at dataUsed and never moved
+*
+* A record is a 16-byte RecordHeader followed by the integrand as an AST image (see serializer.h) and then the result text.
+*/
+
+#include "resultcache.h"
+#include "integrator.h"
+#include "serializer.h"
+#include "symbols.h"
+#include <atomic>
+#include <cstring>
+
+const unsigned char CACHE_MAGIC[4] = { 'S', 'C', 'R', 'C' };
+const unsigned int CACHE_FORMAT_VERSION = 2;
+const size_t CACHE_HEADER_SIZE = 64;
+const size_t CACHE_SLOT_SIZE = 16;
+
+// One slot for every 256 bytes of cache leaves room for typical records at a comfortable load factor
+const size_t BYTES_PER_SLOT = 256;
+const size_t MIN_SLOTS = 64;
+
+struct ResultCache::Header {
+	unsigned char magic[4];
+	unsigned int formatVersion;
+	unsigned int rulesVersion;
+	unsigned int slotCount;
+	unsigned long long dataCapacity;
+	unsigned long long dataUsed; // Everything below this offset in the record region has been completely written
+	unsigned int entries;
+	unsigned char reserved[28];
+};
+
+struct ResultCache::Slot {
+	unsigned long long hash;
+	unsigned int offset;
+	unsigned int length;
+};
+
+struct RecordHeader {
+	unsigned int keyLength;
+	unsigned int valueLength;
+	unsigned int checksum;
+	unsigned int reserved;
+};
+
+// FNV-1a; only has to catch torn or stale records, not adversarial ones
+static unsigned int checksum(const unsigned char* bytes, size_t length) {
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		h ^= bytes[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Hash 0 marks a free slot, so a genuine hash of 0 is moved out of the way
+// The variable is mixed in by name, since symbol ids are not the same from one process to the next
+static unsigned long long slotHash(const ASTNode* ast, int variable) {
+	unsigned long long h = ast->analyzed ? ast->hash : structuralHash(ast); // Analyzed trees have it cached
+	h ^= SymbolTable::nameHash(variable) * 0x9E3779B97F4A7C15ULL;
+	return (h == 0) ? 1 : h;
+}
+
+// The key is an image holding two roots: the integrand, then a lone node for the variable of integration
+static std::vector<unsigned char> encodeKey(const ASTNode* ast, int variable) {
+	ASTNode variableNode;
+	variableNode.type = variableChar;
+	variableNode.symbol = variable;
+
+	ASTWriter writer;
+	writer.add(ast);
+	writer.add(&variableNode);
+	return writer.finish();
+}
+
+// Constructor
+ResultCache::ResultCache() {
+	this->durable = false;
+}
+
+ResultCache::Header* ResultCache::header() {
+	return (Header*)file.writableData();
+}
+
+ResultCache::Slot* ResultCache::slots() {
+	return (Slot*)(file.writableData() + CACHE_HEADER_SIZE);
+}
+
+unsigned char* ResultCache::records() {
+	return file.writableData() + CACHE_HEADER_SIZE + header()->slotCount * CACHE_SLOT_SIZE;
+}
+
+bool ResultCache::open(const std::string& path, size_t maxBytes, bool t_durable) {
+	std::lock_guard<std::mutex> lock(mutex);
+	file.close();
+	durable = t_durable;
+
+	if (maxBytes < CACHE_HEADER_SIZE + MIN_SLOTS * (CACHE_SLOT_SIZE + BYTES_PER_SLOT)) {
+		return false;
+	}
+	if (!file.openWritable(path, maxBytes)) {
+		return false;
+	}
+
+	// Anything that is not a consistent cache for the current integrator is thrown away
+	Header* h = header();
+	bool valid = memcmp(h->magic, CACHE_MAGIC, 4) == 0 && h->formatVersion == CACHE_FORMAT_VERSION && h->rulesVersion == INTEGRATOR_RULES_VERSION
+		&& h->slotCount >= MIN_SLOTS && (h->slotCount & (h->slotCount - 1)) == 0
+		&& CACHE_HEADER_SIZE + (unsigned long long)h->slotCount * CACHE_SLOT_SIZE + h->dataCapacity <= file.size()
+		&& h->dataUsed <= h->dataCapacity;
+	if (!valid) {
+		return initialize(maxBytes);
+	}
+
+	recover();
+	return true;
+}
+
+// Lays out an empty cache that fits in maxBytes
+bool ResultCache::initialize(size_t maxBytes) {
+	size_t slotCount = MIN_SLOTS;
+	while (slotCount * 2 * (CACHE_SLOT_SIZE + BYTES_PER_SLOT) <= maxBytes - CACHE_HEADER_SIZE) {
+		slotCount *= 2;
+	}
+	size_t dataCapacity = maxBytes - CACHE_HEADER_SIZE - slotCount * CACHE_SLOT_SIZE;
+	if (dataCapacity > 0xFFFFFFFFu) {
+		dataCapacity = 0xFFFFFFFFu; // Record offsets are 32-bit
+	}
+
+	unsigned char* bytes = file.writableData();
+	memset(bytes, 0, CACHE_HEADER_SIZE + slotCount * CACHE_SLOT_SIZE);
+
+	Header* h = header();
+	h->formatVersion = CACHE_FORMAT_VERSION;
+	h->rulesVersion = INTEGRATOR_RULES_VERSION;
+	h->slotCount = (unsigned int)slotCount;
+	h->dataCapacity = dataCapacity;
+	h->dataUsed = 0;
+	h->entries = 0;
+
+	// The magic goes in last, so a crash during initialization leaves a file that is initialized again next time
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(h->magic, CACHE_MAGIC, 4);
+	if (durable) {
+		file.flush(0, CACHE_HEADER_SIZE + slotCount * CACHE_SLOT_SIZE);
+	}
+	return true;
+}
+
+// Drops any slot whose record was not completely written before the last process stopped
+void ResultCache::recover() {
+	Header* h = header();
+	Slot* table = slots();
+	unsigned char* data = records();
+	unsigned int entries = 0;
+
+	for (unsigned int i = 0; i < h->slotCount; i++) {
+		Slot& slot = table[i];
+		if (slot.hash == 0) {
+			continue;
+		}
+
+		bool intact = (unsigned long long)slot.offset + slot.length <= h->dataUsed && slot.length >= sizeof(RecordHeader);
+		if (intact) {
+			RecordHeader record;
+			memcpy(&record, data + slot.offset, sizeof(record));
+			intact = sizeof(RecordHeader) + (unsigned long long)record.keyLength + record.valueLength <= slot.length
+				&& checksum(data + slot.offset + sizeof(RecordHeader), record.keyLength + record.valueLength) == record.checksum;
+		}
+
+		if (intact) {
+			entries++;
+		}
+		else {
+			slot.hash = 0;
+		}
+	}
+	h->entries = entries;
+}
+
+void ResultCache::close() {
+	std::lock_guard<std::mutex> lock(mutex);
+	file.close();
+}
+
+bool ResultCache::isOpen() const {
+	return file.data() != NULL;
+}
+
+bool ResultCache::keyMatches(const Slot& slot, const std::vector<unsigned char>& key) {
+	RecordHeader record;
+	memcpy(&record, records() + slot.offset, sizeof(record));
+	return record.keyLength == key.size() && memcmp(records() + slot.offset + sizeof(RecordHeader), &key[0], key.size()) == 0;
+}
+
+bool ResultCache::lookup(const ASTNode* ast, int variable, std::string& result) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (file.writableData() == NULL || ast == NULL) {
+		return false;
+	}
+
+	unsigned long long hash = slotHash(ast, variable);
+	std::vector<unsigned char> key = encodeKey(ast, variable);
+	Header* h = header();
+	Slot* table = slots();
+	unsigned int mask = h->slotCount - 1;
+
+	// Linear probing; a free slot ends the probe sequence
+	for (unsigned int probe = 0; probe < h->slotCount; probe++) {
+		const Slot& slot = table[(hash + probe) & mask];
+		if (slot.hash == 0) {
+			return false;
+		}
+		if (slot.hash == hash && keyMatches(slot, key)) {
+			RecordHeader record;
+			memcpy(&record, records() + slot.offset, sizeof(record));
+			result.assign((const char*)records() + slot.offset + sizeof(RecordHeader) + record.keyLength, record.valueLength);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResultCache::store(const ASTNode* ast, int variable, const std::string& result) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (file.writableData() == NULL || ast == NULL) {
+		return;
+	}
+
+	unsigned long long hash = slotHash(ast, variable);
+	std::vector<unsigned char> key = encodeKey(ast, variable);
+	Header* h = header();
+	Slot* table = slots();
+	unsigned int mask = h->slotCount - 1;
+
+	// Keep the table at most three quarters full so that probe sequences stay short
+	size_t length = sizeof(RecordHeader) + key.size() + result.size();
+	length = (length + 7) & ~(size_t)7;
+	if ((unsigned long long)h->entries * 4 >= (unsigned long long)h->slotCount * 3 || h->dataUsed + length > h->dataCapacity) {
+		return;
+	}
+
+	Slot* target = NULL;
+	for (unsigned int probe = 0; probe < h->slotCount; probe++) {
+		Slot& slot = table[(hash + probe) & mask];
+		if (slot.hash == 0) {
+			target = &slot;
+			break;
+		}
+		if (slot.hash == hash && keyMatches(slot, key)) {
+			return; // Already cached
+		}
+	}
+	if (target == NULL) {
+		return;
+	}
+
+	// 1. Append the record past the committed end of the record region
+	unsigned int offset = (unsigned int)h->dataUsed;
+	unsigned char* record = records() + offset;
+	RecordHeader recordHeader;
+	recordHeader.keyLength = (unsigned int)key.size();
+	recordHeader.valueLength = (unsigned int)result.size();
+	recordHeader.reserved = 0;
+	memcpy(record + sizeof(RecordHeader), &key[0], key.size());
+	memcpy(record + sizeof(RecordHeader) + key.size(), result.data(), result.size());
+	recordHeader.checksum = checksum(record + sizeof(RecordHeader), key.size() + result.size());
+	memcpy(record, &recordHeader, sizeof(recordHeader));
+	if (durable) {
+		file.flush(record - file.writableData(), length);
+	}
+
+	// 2. Publish the slot, writing the hash last
+	target->offset = offset;
+	target->length = (unsigned int)length;
+	std::atomic_thread_fence(std::memory_order_release);
+	target->hash = hash;
+
+	// 3. Commit the record; until this point recover() would discard the slot
+	std::atomic_thread_fence(std::memory_order_release);
+	h->dataUsed += length;
+	h->entries++;
+	if (durable) {
+		file.flush(0, CACHE_HEADER_SIZE + h->slotCount * CACHE_SLOT_SIZE);
+	}
+}
+
+size_t ResultCache::entryCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return (file.writableData() == NULL) ? 0 : header()->entries;
+}
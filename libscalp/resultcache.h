@@ -0,0 +1,67 @@
+/*
+* Declares a ResultCache class, an optional persistent cache of integration results that survives process restarts.
+* The cache is a memory-mapped file holding an open-addressing hash table keyed by the structural hash of the
+* integrand and the variable of integration, plus an append-only region of records that store the serialized
+* integrand, the variable and the result.
+*
+* Records are appended first and only then published by writing the slot's hash, so a crash part-way through an
+* insert leaves at worst one unpublished or half-published slot, which is discarded the next time the file is opened.
+* The file never grows past the size given to open(); once it is full further results are simply not cached.
+*
+*  Sample usage:
+*   ResultCache cache; Integrator integrator;
+*   if (cache.open("integrals.cache", 64 * 1024 * 1024)) {
+*     integrator.setCache(&cache);
+*   }
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_RESULTCACHE_H_
+#define SCALP_RESULTCACHE_H_
+
+#include "ast.h"
+#include "mappedfile.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ResultCache
+{
+	MappedFile file;
+	bool durable;
+
+	// Guards the mapping so one cache can be shared by several threads in a process
+	// Sharing one file between processes at the same time is not supported
+	std::mutex mutex;
+
+	struct Header;
+	struct Slot;
+	Header* header();
+	Slot* slots();
+	unsigned char* records();
+
+	bool initialize(size_t maxBytes);
+	void recover();
+	bool keyMatches(const Slot& slot, const std::vector<unsigned char>& key);
+
+public:
+	ResultCache();
+
+	// Opens (or creates) the cache file at path, capped at maxBytes on disk
+	// A file written by another format or rules version is wiped and started over
+	// If durable is true, every insert is flushed to disk before it is published, which is slower but survives power loss
+	bool open(const std::string& path, size_t maxBytes, bool durable = false);
+	void close();
+	bool isOpen() const;
+
+	// Looks up the result previously stored for an integrand equal to ast, integrated with respect to the variable
+	// whose symbol id is variable; returns false on a miss
+	bool lookup(const ASTNode* ast, int variable, std::string& result);
+
+	// Remembers result for ast; silently does nothing once the cache is full
+	void store(const ASTNode* ast, int variable, const std::string& result);
+
+	size_t entryCount();
+};
+
+#endif // SCALP_RESULTCACHE_H_
@@ -0,0 +1,105 @@
+/*
+* Implements the RuleOrder class in ruleorder.h
+* See comments in ruleorder.h for more details
+*/
+
+#include "ruleorder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// First line of a saved RuleOrder; the number is the version of the format
+const std::string RULE_ORDER_HEADER = "scalp-rule-order 1";
+
+// Orders rules by their hits, most first
+struct MoreHits {
+	const unsigned long long* hits;
+
+	bool operator()(IntegratorRule a, IntegratorRule b) const {
+		return hits[a] > hits[b];
+	}
+};
+
+// Constructor
+RuleOrder::RuleOrder() {
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		hits[i] = 0;
+	}
+	rank();
+}
+
+void RuleOrder::rank() {
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		ranked[i] = (IntegratorRule)i;
+	}
+	MoreHits moreHits = { hits };
+	std::stable_sort(ranked, ranked + INTEGRATOR_RULE_COUNT, moreHits);
+}
+
+void RuleOrder::adapt(const StatsSnapshot& snapshot) {
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		hits[i] += snapshot.ruleHits[i];
+	}
+	rank();
+}
+
+unsigned long long RuleOrder::hitCount(IntegratorRule rule) const {
+	return hits[rule];
+}
+
+IntegratorRule RuleOrder::at(int position) const {
+	return ranked[position];
+}
+
+std::string RuleOrder::toText() const {
+	std::stringstream sstr;
+	sstr << RULE_ORDER_HEADER << "\n";
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		sstr << INTEGRATOR_RULE_NAMES[ranked[i]] << " " << hits[ranked[i]] << "\n";
+	}
+	return sstr.str();
+}
+
+bool RuleOrder::fromText(const std::string& text) {
+	std::stringstream sstr(text);
+	std::string line;
+	if (!std::getline(sstr, line) || line != RULE_ORDER_HEADER) {
+		return false;
+	}
+
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		hits[i] = 0;
+	}
+	while (std::getline(sstr, line)) {
+		size_t space = line.find(' ');
+		if (space == std::string::npos) {
+			continue;
+		}
+		std::string name = line.substr(0, space);
+		for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+			if (name == INTEGRATOR_RULE_NAMES[i]) {
+				hits[i] = strtoull(line.c_str() + space + 1, NULL, 10);
+				break;
+			}
+		}
+	}
+	rank();
+	return true;
+}
+
+bool RuleOrder::save(const std::string& path) const {
+	std::ofstream file(path.c_str(), std::ios::trunc);
+	file << toText();
+	return (bool)file;
+}
+
+bool RuleOrder::load(const std::string& path) {
+	std::ifstream file(path.c_str());
+	if (!file) {
+		return false;
+	}
+	std::stringstream sstr;
+	sstr << file.rdbuf();
+	return fromText(sstr.str());
+}
@@ -0,0 +1,66 @@
+/*
+* Declares the RuleOrder class, which ranks the integrator's rules by how often they fire on a workload, so that the
+* Integrator can try the likely ones first.
+*
+* Integrator::lookInTable() tests a node against the patterns of its built-in table one after another until one
+* matches. No node matches two of them, so the order never changes an answer, only how many patterns a node is tested
+* against first; with the rules a workload uses most at the front, its common integrands are found after one or two
+* tests. A RuleOrder keeps a hit count per rule, adds to them from StatsSnapshots (whose ruleHits count every rule
+* applied, see stats.h) and ranks the rules by them. It can be saved as a short text file and loaded again, so that a
+* restarted server starts with the order learned from earlier traffic.
+*
+* Only the table is reordered. The rules integrateSubtree() tries before it, and the trigonometric power, parts and
+* substitution rules tried after it, can match the same integrand, so their order decides the answer and stays fixed.
+*
+*  Sample usage:
+*   RuleOrder order;
+*   order.load("rules.txt"); // Keeps the order rules are written in if there is no such file
+*   integrator.setRuleOrder(order);
+*   ... // Integrate a workload
+*   order.adapt(Stats::collect());
+*   order.save("rules.txt");
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_RULEORDER_H_
+#define SCALP_RULEORDER_H_
+
+#include "integrator.h"
+#include "stats.h"
+#include <string>
+
+class RuleOrder
+{
+	unsigned long long hits[INTEGRATOR_RULE_COUNT];
+
+	// Every rule, most hits first; rules with as many hits as each other stay in the order of IntegratorRule
+	IntegratorRule ranked[INTEGRATOR_RULE_COUNT];
+
+	void rank();
+
+public:
+	// No hits yet, so the rules are in the order of IntegratorRule, which is the order they are written in
+	RuleOrder();
+
+	// Adds the rule hits of snapshot to the ones counted so far and ranks the rules again
+	// Pass each piece of work once: Stats::collect() after a run, not after every request of it
+	void adapt(const StatsSnapshot& snapshot);
+
+	unsigned long long hitCount(IntegratorRule rule) const;
+
+	// The rule ranked position-th, from 0 for the most hits up to INTEGRATOR_RULE_COUNT - 1
+	IntegratorRule at(int position) const;
+
+	// A header line, then one line per rule, in rank order: its name (see INTEGRATOR_RULE_NAMES) and its hits
+	std::string toText() const;
+
+	// Reads what toText() wrote; lines naming a rule this build does not have are skipped, and rules that have no line
+	// get 0 hits. Returns false, and changes nothing, if text does not start with the header
+	bool fromText(const std::string& text);
+
+	// Return false if the file could not be written or read (or is not a saved RuleOrder)
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+};
+
+#endif // SCALP_RULEORDER_H_
@@ -0,0 +1,63 @@
+/*
+* Implements the Scalp class in scalp.h
+* See comments in scalp.h for more details
+*/
+
+#include "scalp.h"
+#include "arena.h"
+#include "evaluator.h"
+#include "formatter.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "symbols.h"
+#include <vector>
+
+// Nodes per arena block; one block holds the tree of a typical one-line expression
+const size_t SCALP_ARENA_BLOCK = 256;
+
+std::string Scalp::interpret(const std::string& text) {
+	// interpret() edits in place and may insert one '*' per character, so leave room for twice the input
+	std::vector<char> buffer(2 * text.size() + 4, 0);
+	text.copy(&buffer[0], text.size());
+	Interpreter interpreter;
+	interpreter.interpret(&buffer[0]);
+	return std::string(&buffer[0]);
+}
+
+static int variableSymbol(const std::string& variable) {
+	int symbol = SymbolTable::isName(variable) ? SymbolTable::intern(variable) : -1;
+	if (symbol < 0) {
+		throw ParserException("'" + variable + "' is not a variable name", 0);
+	}
+	return symbol;
+}
+
+std::string Scalp::integrate(const std::string& text, const std::string& variable) {
+	int symbol = variableSymbol(variable);
+	std::string interpreted = interpret(text);
+	NodeArena arena(SCALP_ARENA_BLOCK); Parser parser; Integrator integrator;
+	parser.setArena(&arena);
+	return integrator.integrate(parser.parse(interpreted.c_str()), symbol);
+}
+
+DefiniteIntegral Scalp::integrateDefinite(const std::string& text, const std::string& variable, double lower, double upper) {
+	int symbol = variableSymbol(variable);
+	std::string interpreted = interpret(text);
+	NodeArena arena(SCALP_ARENA_BLOCK); Parser parser; Integrator integrator;
+	parser.setArena(&arena);
+	return integrator.integrateDefinite(parser.parse(interpreted.c_str()), symbol, lower, upper);
+}
+
+std::string Scalp::share(const std::string& text) {
+	std::string interpreted = interpret(text);
+	NodeArena arena(SCALP_ARENA_BLOCK); Parser parser; Formatter formatter;
+	parser.setArena(&arena);
+	return formatter.formatShared(parser.parse(interpreted.c_str()));
+}
+
+double Scalp::evaluate(const std::string& text) {
+	std::string interpreted = interpret(text);
+	NodeArena arena(SCALP_ARENA_BLOCK); Parser parser; Evaluator evaluator;
+	parser.setArena(&arena);
+	return evaluator.evaluate(parser.parse(interpreted.c_str()));
+}
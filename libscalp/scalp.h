@@ -0,0 +1,54 @@
+/*
+* Declares the Scalp class, the entry point of libscalp for callers that have an expression as text and want an
+* answer in one call. Each call interprets, parses and integrates (or evaluates) with objects of its own, so any
+* number of threads may call these functions at once.
+*
+* libscalp keeps no global state that a caller can observe. The only process-wide pieces are the SymbolTable (see
+* symbols.h) and the cache of CompiledFunction::cached() (see compiledfunction.h), which are locked internally, and
+* the pipeline Stats and Trace buffers, which every thread keeps for itself. The classes behind these functions can
+* also be used directly; from several threads:
+*   Interpreter, Formatter   hold no state; share freely
+*   Parser                   share freely; each parse() works on its own copy of the cursor, but threads that parse
+*                            at the same time must not share an arena (see arena.h)
+*   Integrator               share freely once configured; integrate() and integrateDefinite() do not change it
+*   ResultCache              share freely; locked internally
+*   CompiledFunction         share freely; never changes once built
+*   Evaluator, Builder,      one per thread; they hold bindings, scratch space or nodes that every call changes
+*   NodeArena
+* A finished tree is read-only to all of the above, so threads may share one as well.
+*
+*  Sample usage:
+*   std::string solution = Scalp::integrate("5x^3 - 10x^6 + 4");
+*   double value = Scalp::evaluate("8.99 * 10 + 8.85 * 1.60");
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_SCALP_H_
+#define SCALP_SCALP_H_
+
+#include "integrator.h"
+#include <string>
+
+class Scalp
+{
+public:
+	// text as the Parser sees it, with whitespace removed and implied multiplication written out
+	static std::string interpret(const std::string& text);
+
+	// The antiderivative of text with respect to variable, without "+ C"; ERROR marks parts with no known integral
+	// Throws a ParserException if text is not an expression or variable is not a variable name
+	static std::string integrate(const std::string& text, const std::string& variable = "x");
+
+	// See Integrator::integrateDefinite(); throws where integrate() does, and an EvaluatorException for bad bounds
+	static DefiniteIntegral integrateDefinite(const std::string& text, const std::string& variable, double lower, double upper);
+
+	// text in canonical form with its repeated subterms named once (see Formatter::formatShared), for instance to
+	// shorten a long answer from integrate(); throws a ParserException if text is not an expression
+	static std::string share(const std::string& text);
+
+	// The value of text, which must not contain variables
+	// Throws a ParserException if text is not an expression, and an EvaluatorException if it has a variable
+	static double evaluate(const std::string& text);
+};
+
+#endif // SCALP_SCALP_H_
@@ -0,0 +1,384 @@
+/*
+* Implements the ASTWriter and ASTImage classes in serializer.h
+* See comments in serializer.h for the binary layout
+*/
+
+#include "serializer.h"
+#include "stats.h"
+#include "symbols.h"
+#include <cstring>
+#include <fstream>
+
+const unsigned char FORMAT_MAGIC[4] = { 'S', 'C', 'L', 'P' };
+const size_t HEADER_SIZE = 24;
+const unsigned char TYPE_MASK = 0x1F;
+const unsigned char HAS_LEFT = 0x40;
+const unsigned char HAS_RIGHT = 0x80;
+
+// Small helpers for the fixed-width little-endian fields
+static void putUint16(std::vector<unsigned char>& out, unsigned int value) {
+	out.push_back((unsigned char)(value & 0xFF));
+	out.push_back((unsigned char)((value >> 8) & 0xFF));
+}
+
+static void putUint32(std::vector<unsigned char>& out, unsigned int value) {
+	for (int i = 0; i < 4; i++) {
+		out.push_back((unsigned char)((value >> (8 * i)) & 0xFF));
+	}
+}
+
+static unsigned int getUint32(const unsigned char* bytes) {
+	return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) | ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+// Unsigned LEB128: seven bits per byte, high bit set on every byte but the last
+static size_t varintLength(unsigned long long value) {
+	size_t length = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		length++;
+	}
+	return length;
+}
+
+static void putVarint(std::vector<unsigned char>& out, unsigned long long value) {
+	while (value >= 0x80) {
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+// The right-child offset counts its own varint, so find the varint length that is consistent with itself
+static size_t rightOffset(size_t fixedPart, size_t leftSize) {
+	size_t length = 1;
+	while (varintLength(fixedPart + length + leftSize) != length) {
+		length++;
+	}
+	return fixedPart + length + leftSize;
+}
+
+////////////// ASTWriter ////////////////
+
+// Constructor
+ASTWriter::ASTWriter() {
+	this->nextSubtree = 0;
+}
+
+unsigned int ASTWriter::internConstant(double value) {
+	unsigned long long bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	std::map<unsigned long long, unsigned int>::iterator it = constantIndex.find(bits);
+	if (it != constantIndex.end()) {
+		return it->second;
+	}
+	unsigned int index = (unsigned int)constants.size();
+	constants.push_back(value);
+	constantIndex[bits] = index;
+	return index;
+}
+
+unsigned int ASTWriter::internName(int symbol) {
+	std::map<int, unsigned int>::iterator it = nameIndex.find(symbol);
+	if (it != nameIndex.end()) {
+		return it->second;
+	}
+	unsigned int index = (unsigned int)nameIndex.size();
+	const std::string& name = SymbolTable::name(symbol);
+	putVarint(namePool, name.size());
+	namePool.insert(namePool.end(), name.begin(), name.end());
+	nameIndex[symbol] = index;
+	return index;
+}
+
+// First pass: records the encoded size of every subtree in pre-order, so emit() knows each right-child offset up front
+size_t ASTWriter::measure(const ASTNode* ast) {
+	size_t slot = subtreeSizes.size();
+	subtreeSizes.push_back(0);
+
+	size_t fixedPart = 1;
+	if (ast->type == numberValue) {
+		fixedPart += varintLength(internConstant(ast->value));
+	}
+	else if (ast->type == variableChar) {
+		fixedPart += varintLength(internName(ast->symbol));
+	}
+
+	size_t leftSize = (ast->left != NULL) ? measure(ast->left) : 0;
+	size_t rightSize = (ast->right != NULL) ? measure(ast->right) : 0;
+
+	size_t size;
+	if (ast->left != NULL && ast->right != NULL) {
+		size = rightOffset(fixedPart, leftSize) + rightSize;
+	}
+	else {
+		size = fixedPart + leftSize + rightSize;
+	}
+	subtreeSizes[slot] = size;
+	return size;
+}
+
+// Second pass: writes the records in the same pre-order that measure() visited them
+void ASTWriter::emit(const ASTNode* ast) {
+	nextSubtree++;
+
+	unsigned char tag = (unsigned char)ast->type;
+	if (ast->left != NULL) tag |= HAS_LEFT;
+	if (ast->right != NULL) tag |= HAS_RIGHT;
+	nodes.push_back(tag);
+
+	size_t fixedPart = 1;
+	if (ast->type == numberValue) {
+		unsigned int index = internConstant(ast->value);
+		putVarint(nodes, index);
+		fixedPart += varintLength(index);
+	}
+	else if (ast->type == variableChar) {
+		unsigned int index = internName(ast->symbol);
+		putVarint(nodes, index);
+		fixedPart += varintLength(index);
+	}
+
+	if (ast->left != NULL && ast->right != NULL) {
+		putVarint(nodes, rightOffset(fixedPart, subtreeSizes[nextSubtree]));
+	}
+	if (ast->left != NULL) {
+		emit(ast->left);
+	}
+	if (ast->right != NULL) {
+		emit(ast->right);
+	}
+}
+
+size_t ASTWriter::add(const ASTNode* ast) {
+	if (ast == NULL) {
+		throw SerializerException("Abstract syntax tree is NULL");
+	}
+
+	subtreeSizes.clear();
+	measure(ast);
+
+	roots.push_back((unsigned int)nodes.size());
+	nextSubtree = 0;
+	emit(ast);
+	return roots.size() - 1;
+}
+
+std::vector<unsigned char> ASTWriter::finish() const {
+	std::vector<unsigned char> out;
+	out.reserve(HEADER_SIZE + constants.size() * 8 + namePool.size() + roots.size() * 4 + nodes.size());
+
+	out.insert(out.end(), FORMAT_MAGIC, FORMAT_MAGIC + 4);
+	putUint16(out, AST_FORMAT_VERSION);
+	putUint16(out, 0);
+	putUint32(out, (unsigned int)constants.size());
+	putUint32(out, (unsigned int)roots.size());
+	putUint32(out, (unsigned int)nodes.size());
+	putUint32(out, (unsigned int)namePool.size());
+
+	for (size_t i = 0; i < constants.size(); i++) {
+		unsigned long long bits;
+		memcpy(&bits, &constants[i], sizeof(bits));
+		putUint32(out, (unsigned int)(bits & 0xFFFFFFFF));
+		putUint32(out, (unsigned int)(bits >> 32));
+	}
+	out.insert(out.end(), namePool.begin(), namePool.end());
+	for (size_t i = 0; i < roots.size(); i++) {
+		putUint32(out, roots[i]);
+	}
+	out.insert(out.end(), nodes.begin(), nodes.end());
+	return out;
+}
+
+void ASTWriter::writeFile(const std::string& path) const {
+	std::vector<unsigned char> bytes = finish();
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	file.write((const char*)&bytes[0], bytes.size());
+	if (!file) {
+		throw SerializerException("Could not write AST image to " + path);
+	}
+}
+
+////////////// ASTImage ////////////////
+
+// Constructor; only the header and section bounds are checked here, node records are checked as they are read
+ASTImage::ASTImage(const unsigned char* data, size_t size) {
+	if (data == NULL || size < HEADER_SIZE || memcmp(data, FORMAT_MAGIC, 4) != 0) {
+		throw SerializerException("Not a SCALP AST image");
+	}
+	unsigned int version = (unsigned int)data[4] | ((unsigned int)data[5] << 8);
+	if (version != AST_FORMAT_VERSION) {
+		throw SerializerException("Unsupported AST image version " + std::to_string(version));
+	}
+
+	constantCount = getUint32(data + 8);
+	rootTotal = getUint32(data + 12);
+	nodeBytes = getUint32(data + 16);
+	size_t nameBytes = getUint32(data + 20);
+
+	// Computed in 64 bits so that a corrupt count cannot wrap around the bounds check
+	unsigned long long expected = (unsigned long long)HEADER_SIZE + (unsigned long long)constantCount * 8 + nameBytes + (unsigned long long)rootTotal * 4 + nodeBytes;
+	if (expected > size) {
+		throw SerializerException("AST image is truncated");
+	}
+
+	constantPool = data + HEADER_SIZE;
+	const unsigned char* namePool = constantPool + constantCount * 8;
+	rootTable = namePool + nameBytes;
+	nodeStream = rootTable + rootTotal * 4;
+
+	// Names are few and short, so they are interned once here rather than on every lookup
+	size_t cursor = 0;
+	while (cursor < nameBytes) {
+		unsigned long long length = 0;
+		int shift = 0;
+		unsigned char byte;
+		do {
+			if (cursor >= nameBytes || shift >= 64) {
+				throw SerializerException("AST image name pool is corrupt");
+			}
+			byte = namePool[cursor++];
+			length |= (unsigned long long)(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		if (length == 0 || length > nameBytes - cursor) {
+			throw SerializerException("AST image name pool is corrupt");
+		}
+		int symbol = SymbolTable::intern(std::string((const char*)namePool + cursor, (size_t)length));
+		if (symbol < 0) {
+			throw SerializerException("AST image has more variable names than the symbol table can hold");
+		}
+		symbols.push_back(symbol);
+		cursor += (size_t)length;
+	}
+}
+
+size_t ASTImage::rootCount() const {
+	return rootTotal;
+}
+
+ASTImage::Node ASTImage::root(size_t i) const {
+	if (i >= rootTotal) {
+		throw SerializerException("AST image root index out of range");
+	}
+	return Node(this, getUint32(rootTable + i * 4));
+}
+
+ASTNode* ASTImage::materialize(size_t i) const {
+	return materializeNode(root(i));
+}
+
+ASTNode* ASTImage::materializeNode(const Node& node) const {
+	ASTNode* ast = new ASTNode;
+	try {
+		ast->type = node.type();
+		if (ast->type == numberValue) ast->value = node.value();
+		if (ast->type == variableChar) ast->symbol = node.symbol();
+		if (node.hasLeft()) ast->left = materializeNode(node.left());
+		if (node.hasRight()) ast->right = materializeNode(node.right());
+	}
+	catch (...) {
+		delete ast;
+		throw;
+	}
+	return ast;
+}
+
+unsigned char ASTImage::readByte(size_t offset) const {
+	if (offset >= nodeBytes) {
+		throw SerializerException("AST image node record out of bounds");
+	}
+	return nodeStream[offset];
+}
+
+unsigned long long ASTImage::readVarint(size_t& offset) const {
+	unsigned long long value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char byte = readByte(offset++);
+		value |= (unsigned long long)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+	throw SerializerException("AST image varint is too long");
+}
+
+////////////// ASTImage::Node ////////////////
+
+ASTImage::Node::Node(const ASTImage* t_image, size_t t_offset) {
+	this->image = t_image;
+	this->offset = t_offset;
+}
+
+ASTNodeType ASTImage::Node::type() const {
+	unsigned char tag = image->readByte(offset) & TYPE_MASK;
+	if (tag > functionLn) {
+		throw SerializerException("AST image has an unknown node type");
+	}
+	return (ASTNodeType)tag;
+}
+
+double ASTImage::Node::value() const {
+	size_t cursor = offset + 1;
+	unsigned long long index = image->readVarint(cursor);
+	if (index >= image->constantCount) {
+		throw SerializerException("AST image constant index out of range");
+	}
+	double value;
+	memcpy(&value, image->constantPool + index * 8, sizeof(value));
+	return value;
+}
+
+int ASTImage::Node::symbol() const {
+	size_t cursor = offset + 1;
+	unsigned long long index = image->readVarint(cursor);
+	if (index >= image->symbols.size()) {
+		throw SerializerException("AST image name index out of range");
+	}
+	return image->symbols[(size_t)index];
+}
+
+bool ASTImage::Node::hasLeft() const {
+	return (image->readByte(offset) & HAS_LEFT) != 0;
+}
+
+bool ASTImage::Node::hasRight() const {
+	return (image->readByte(offset) & HAS_RIGHT) != 0;
+}
+
+// Returns the offset just past this record's type byte and payload
+size_t ASTImage::Node::payloadEnd() const {
+	size_t cursor = offset + 1;
+	ASTNodeType nodeType = type();
+	if (nodeType == numberValue || nodeType == variableChar) image->readVarint(cursor);
+	return cursor;
+}
+
+// The left child's record follows this one, after the right-child offset if there is one
+ASTImage::Node ASTImage::Node::left() const {
+	size_t cursor = payloadEnd();
+	if (hasRight()) image->readVarint(cursor);
+	return Node(image, cursor);
+}
+
+// Offsets only ever point forwards, which guarantees that a corrupt image cannot make traversal loop
+ASTImage::Node ASTImage::Node::right() const {
+	size_t cursor = payloadEnd();
+	if (!hasLeft()) {
+		return Node(image, cursor);
+	}
+
+	size_t fixedPart = cursor - offset;
+	unsigned long long distance = image->readVarint(cursor);
+	if (distance <= fixedPart || distance > image->nodeBytes - offset) {
+		throw SerializerException("AST image child offset out of range");
+	}
+	return Node(image, offset + (size_t)distance);
+}
+
+// SerializerException derived from std::runtime_error, which keeps a copy of the message for what()
+SerializerException::SerializerException(const std::string& message) : std::runtime_error(message) {
+	Stats::count(counterExceptions);
+}
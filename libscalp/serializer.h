@@ -0,0 +1,128 @@
+/*
+* Declares the classes that store ASTs in a compact, versioned binary format so that parsed expressions can be
+* saved and loaded again without going through the Interpreter and Parser.
+*
+* File layout (all integers little-endian):
+*   [header]     "SCLP" magic, uint16 version, uint16 flags, uint32 constant count, uint32 root count, uint32 node bytes, uint32 name bytes
+*   [constants]  constant count * 8-byte IEEE-754 doubles; every numberValue refers to one of these by index
+*   [names]      name bytes worth of variable names, each a varint length followed by its characters; every
+*                variableChar refers to one of these by index, since symbol ids (see symbols.h) differ between processes
+*   [roots]      root count * uint32 offsets into the node stream, one per stored expression
+*   [nodes]      the node stream: one variable-length record per node, written in pre-order
+*
+* A node record is a single byte holding the ASTNodeType in its low 5 bits, bit 6 set if the node has a left child
+* and bit 7 set if it has a right child, followed by:
+*   numberValue   varint index into the constant pool
+*   variableChar  varint index into the name pool
+*   both children varint offset from the start of this record to the right child's record
+* The left child's record always follows immediately, so it needs no offset.
+*
+*  Sample usage:
+*   ASTWriter writer; writer.add(ast); writer.writeFile("corpus.sast");
+*
+*   MappedFile file; file.open("corpus.sast");
+*   ASTImage image(file.data(), file.size());
+*   ASTNode* ast = image.materialize(0);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_SERIALIZER_H_
+#define SCALP_SERIALIZER_H_
+
+#include "ast.h"
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Bumped whenever the layout above changes; older images are rejected rather than misread
+const unsigned short AST_FORMAT_VERSION = 2;
+
+// Collects ASTs and encodes them into a single image
+class ASTWriter
+{
+	std::vector<double> constants;
+	std::map<unsigned long long, unsigned int> constantIndex; // Keyed by the bit pattern so -0.0 and 0.0 stay distinct
+	std::vector<unsigned char> namePool;
+	std::map<int, unsigned int> nameIndex; // Keyed by symbol id
+	std::vector<unsigned int> roots;
+	std::vector<unsigned char> nodes;
+
+	// Sizes of every encoded record and subtree, in pre-order; filled by measure() and consumed by emit()
+	std::vector<size_t> subtreeSizes;
+	size_t nextSubtree;
+
+	unsigned int internConstant(double value);
+	unsigned int internName(int symbol);
+	size_t measure(const ASTNode* ast);
+	void emit(const ASTNode* ast);
+
+public:
+	ASTWriter();
+
+	// Appends ast to the image and returns its root index
+	size_t add(const ASTNode* ast);
+
+	// Returns the complete encoded image
+	std::vector<unsigned char> finish() const;
+
+	// Writes the complete encoded image to path; throws a SerializerException on I/O failure
+	void writeFile(const std::string& path) const;
+};
+
+// A read-only view over an encoded image; only the variable names are copied (into the SymbolTable, when the image
+// is opened), so the bytes must outlive the image
+class ASTImage
+{
+	const unsigned char* nodeStream;
+	size_t nodeBytes;
+	const unsigned char* constantPool;
+	size_t constantCount;
+	std::vector<int> symbols; // Symbol id of each name in the name pool
+	const unsigned char* rootTable;
+	size_t rootTotal;
+
+public:
+	// A lightweight cursor onto one node record; decodes fields on demand
+	class Node
+	{
+		friend class ASTImage;
+		const ASTImage* image;
+		size_t offset;
+
+		Node(const ASTImage* t_image, size_t t_offset);
+		size_t payloadEnd() const;
+
+	public:
+		ASTNodeType type() const;
+		double value() const;
+		int symbol() const;
+		bool hasLeft() const;
+		bool hasRight() const;
+		Node left() const;
+		Node right() const;
+	};
+
+	// Validates the header and section bounds; throws a SerializerException if the bytes are not a usable image
+	ASTImage(const unsigned char* data, size_t size);
+
+	size_t rootCount() const;
+	Node root(size_t i) const;
+
+	// Builds an ordinary heap-allocated copy of root i that the caller owns
+	ASTNode* materialize(size_t i) const;
+
+private:
+	ASTNode* materializeNode(const Node& node) const;
+	unsigned long long readVarint(size_t& offset) const;
+	unsigned char readByte(size_t offset) const;
+};
+
+// Custom SerializerException class derived from the base exception class defined in the standard library
+class SerializerException : public std::runtime_error
+{
+public:
+	SerializerException(const std::string& message);
+};
+
+#endif // SCALP_SERIALIZER_H_
@@ -0,0 +1,206 @@
+/*
+* Implements the Stats, StatsSnapshot and PhaseTimer classes in stats.h
+* See comments in stats.h for more details
+*/
+
+#include "stats.h"
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+const char* PHASE_NAMES[STAT_PHASE_COUNT] = { "interpret", "parse", "simplify", "integrate", "format" };
+const char* COUNTER_NAMES[STAT_COUNTER_COUNT] = { "nodes_allocated", "simplify_rewrites", "exceptions", "budgets_exceeded" };
+
+// One thread's counters; only that thread writes them, any thread may read them while merging
+struct ThreadStats {
+	std::atomic<unsigned long long> phaseCalls[STAT_PHASE_COUNT];
+	std::atomic<unsigned long long> phaseNanoseconds[STAT_PHASE_COUNT];
+	std::atomic<unsigned long long> counters[STAT_COUNTER_COUNT];
+	std::atomic<unsigned long long> ruleHits[INTEGRATOR_RULE_COUNT];
+
+	ThreadStats() {
+		zero();
+	}
+
+	void zero() {
+		for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+			phaseCalls[i].store(0, std::memory_order_relaxed);
+			phaseNanoseconds[i].store(0, std::memory_order_relaxed);
+		}
+		for (int i = 0; i < STAT_COUNTER_COUNT; i++) counters[i].store(0, std::memory_order_relaxed);
+		for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) ruleHits[i].store(0, std::memory_order_relaxed);
+	}
+
+	void addTo(StatsSnapshot& snapshot) const {
+		for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+			snapshot.phaseCalls[i] += phaseCalls[i].load(std::memory_order_relaxed);
+			snapshot.phaseNanoseconds[i] += phaseNanoseconds[i].load(std::memory_order_relaxed);
+		}
+		for (int i = 0; i < STAT_COUNTER_COUNT; i++) snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+		for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) snapshot.ruleHits[i] += ruleHits[i].load(std::memory_order_relaxed);
+	}
+};
+
+// With a single writer a plain load and store is enough; no locked read-modify-write instruction is needed
+static inline void bump(std::atomic<unsigned long long>& value, unsigned long long amount) {
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Function-local statics so that the registry exists before the first thread records anything
+static std::mutex& registryMutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::vector<ThreadStats*>& liveThreads() {
+	static std::vector<ThreadStats*> threads;
+	return threads;
+}
+
+static StatsSnapshot& retiredTotals() {
+	static StatsSnapshot totals;
+	return totals;
+}
+
+// Registers the thread's block on first use and folds it into the retired totals when the thread exits
+struct ThreadStatsHolder {
+	ThreadStats* stats;
+
+	ThreadStatsHolder() {
+		stats = NULL;
+	}
+
+	~ThreadStatsHolder() {
+		if (stats == NULL) return;
+		std::lock_guard<std::mutex> lock(registryMutex());
+		stats->addTo(retiredTotals());
+		std::vector<ThreadStats*>& threads = liveThreads();
+		for (size_t i = 0; i < threads.size(); i++) {
+			if (threads[i] == stats) {
+				threads.erase(threads.begin() + i);
+				break;
+			}
+		}
+		delete stats;
+	}
+};
+
+static thread_local ThreadStatsHolder holder;
+
+static ThreadStats& localStats() {
+	if (holder.stats == NULL) {
+		holder.stats = new ThreadStats;
+		std::lock_guard<std::mutex> lock(registryMutex());
+		liveThreads().push_back(holder.stats);
+	}
+	return *holder.stats;
+}
+
+////////////// Stats ////////////////
+
+void Stats::addPhaseTime(StatPhase phase, unsigned long long nanoseconds) {
+	ThreadStats& stats = localStats();
+	bump(stats.phaseCalls[phase], 1);
+	bump(stats.phaseNanoseconds[phase], nanoseconds);
+}
+
+void Stats::count(StatCounter counter, unsigned long long amount) {
+	bump(localStats().counters[counter], amount);
+}
+
+void Stats::countRule(IntegratorRule rule) {
+	bump(localStats().ruleHits[rule], 1);
+}
+
+StatsSnapshot Stats::collect() {
+	std::lock_guard<std::mutex> lock(registryMutex());
+	StatsSnapshot snapshot = retiredTotals();
+	std::vector<ThreadStats*>& threads = liveThreads();
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i]->addTo(snapshot);
+	}
+	return snapshot;
+}
+
+void Stats::reset() {
+	std::lock_guard<std::mutex> lock(registryMutex());
+	retiredTotals() = StatsSnapshot();
+	std::vector<ThreadStats*>& threads = liveThreads();
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i]->zero();
+	}
+}
+
+////////////// StatsSnapshot ////////////////
+
+// Constructor
+StatsSnapshot::StatsSnapshot() {
+	for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+		phaseCalls[i] = 0;
+		phaseNanoseconds[i] = 0;
+	}
+	for (int i = 0; i < STAT_COUNTER_COUNT; i++) counters[i] = 0;
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) ruleHits[i] = 0;
+}
+
+void StatsSnapshot::add(const StatsSnapshot& other) {
+	for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+		phaseCalls[i] += other.phaseCalls[i];
+		phaseNanoseconds[i] += other.phaseNanoseconds[i];
+	}
+	for (int i = 0; i < STAT_COUNTER_COUNT; i++) counters[i] += other.counters[i];
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) ruleHits[i] += other.ruleHits[i];
+}
+
+std::string StatsSnapshot::toText() const {
+	std::stringstream sstr;
+	for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+		double milliseconds = phaseNanoseconds[i] / 1e6;
+		double meanMicroseconds = (phaseCalls[i] > 0) ? phaseNanoseconds[i] / 1e3 / phaseCalls[i] : 0;
+		sstr << "phase " << PHASE_NAMES[i] << " calls=" << phaseCalls[i] << " total=" << milliseconds << "ms mean=" << meanMicroseconds << "us\n";
+	}
+	for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+		sstr << "counter " << COUNTER_NAMES[i] << " " << counters[i] << "\n";
+	}
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		if (ruleHits[i] > 0) {
+			sstr << "rule " << INTEGRATOR_RULE_NAMES[i] << " " << ruleHits[i] << "\n";
+		}
+	}
+	return sstr.str();
+}
+
+std::string StatsSnapshot::toJson() const {
+	std::stringstream sstr;
+	sstr << "{\"phases\":{";
+	for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+		if (i > 0) sstr << ",";
+		sstr << "\"" << PHASE_NAMES[i] << "\":{\"calls\":" << phaseCalls[i] << ",\"ns\":" << phaseNanoseconds[i] << "}";
+	}
+	sstr << "},\"counters\":{";
+	for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+		if (i > 0) sstr << ",";
+		sstr << "\"" << COUNTER_NAMES[i] << "\":" << counters[i];
+	}
+	sstr << "},\"integrator_rules\":{";
+	for (int i = 0; i < INTEGRATOR_RULE_COUNT; i++) {
+		if (i > 0) sstr << ",";
+		sstr << "\"" << INTEGRATOR_RULE_NAMES[i] << "\":" << ruleHits[i];
+	}
+	sstr << "}}";
+	return sstr.str();
+}
+
+////////////// PhaseTimer ////////////////
+
+// Constructor
+PhaseTimer::PhaseTimer(StatPhase t_phase) {
+	this->phase = t_phase;
+	this->start = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+	std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+	Stats::addPhaseTime(phase, (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
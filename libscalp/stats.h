@@ -0,0 +1,82 @@
+/*
+* Declares the Stats class, which collects per-phase timings and event counters for the whole pipeline so that we
+* can see where time goes (interpreting, parsing, the simplify passes, integrating or formatting output).
+*
+* Every thread records into its own block of counters, so recording never takes a lock or shares a cache line with
+* another thread. Stats::collect() merges the blocks of all live threads, plus the totals left behind by threads
+* that have exited, into a StatsSnapshot that can be printed or exported as JSON.
+*
+*  Sample usage:
+*   {
+*     PhaseTimer timer(phaseParse); // Adds the time until the end of the scope to the parse phase
+*     ...
+*   }
+*   Stats::count(counterNodesAllocated);
+*   std::cerr << Stats::collect().toText();
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_STATS_H_
+#define SCALP_STATS_H_
+
+#include "integrator.h"
+#include <chrono>
+#include <string>
+
+enum StatPhase { phaseInterpret, phaseParse, phaseSimplify, phaseIntegrate, phaseFormat, STAT_PHASE_COUNT };
+
+enum StatCounter {
+	counterNodesAllocated, // AST nodes created by the Parser
+	counterSimplifyRewrites, // Identity rules applied by Parser::simplify, and sums and products rebuilt by LikeTerms
+	counterExceptions, // ParserException, EvaluatorException, SerializerException and BudgetException objects constructed
+	counterBudgetsExceeded, // BudgetException objects constructed (see budget.h)
+	STAT_COUNTER_COUNT
+};
+
+// Merged totals; plain numbers, safe to copy around and print
+struct StatsSnapshot {
+	unsigned long long phaseCalls[STAT_PHASE_COUNT];
+	unsigned long long phaseNanoseconds[STAT_PHASE_COUNT];
+	unsigned long long counters[STAT_COUNTER_COUNT];
+	unsigned long long ruleHits[INTEGRATOR_RULE_COUNT];
+
+	StatsSnapshot();
+
+	void add(const StatsSnapshot& other);
+
+	// One line per phase, counter and integrator rule that has been used
+	std::string toText() const;
+
+	// {"phases":{"parse":{"calls":..,"ns":..},..},"counters":{..},"integrator_rules":{..}}
+	std::string toJson() const;
+};
+
+class Stats
+{
+public:
+	static void addPhaseTime(StatPhase phase, unsigned long long nanoseconds);
+	static void count(StatCounter counter, unsigned long long amount = 1);
+	static void countRule(IntegratorRule rule);
+
+	// Totals over every thread that has recorded anything since the last reset()
+	static StatsSnapshot collect();
+
+	// Zeroes every thread's counters; increments racing with a reset may survive it
+	static void reset();
+};
+
+// Adds the time between its construction and destruction to a phase
+class PhaseTimer
+{
+	StatPhase phase;
+	std::chrono::steady_clock::time_point start;
+
+	PhaseTimer(const PhaseTimer&);
+	PhaseTimer& operator=(const PhaseTimer&);
+
+public:
+	PhaseTimer(StatPhase t_phase);
+	~PhaseTimer();
+};
+
+#endif // SCALP_STATS_H_
@@ -0,0 +1,554 @@
+/*
+* Implements the Substitutions class in substitution.h
+* See comments in substitution.h for more details
+*/
+
+#include "substitution.h"
+#include "analysis.h"
+#include "evaluator.h"
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// base^exponent, one factor of a product
+struct ProductFactor {
+	const ASTNode* base;
+	double exponent;
+	std::vector<double> coefficients; // Those of base if it is a polynomial in the variable, else empty
+	unsigned long long key; // Hash of the coefficients if there are any, else the structural hash of base
+};
+
+// constant * polynomial * the product of factors, none of which is a polynomial with a whole positive exponent
+struct ProductForm {
+	double constant;
+	std::vector<double> polynomial; // Coefficient of x^i at i
+	std::vector<ProductFactor> factors;
+};
+
+// A product as it was written: (base, exponent) pairs
+typedef std::vector<std::pair<const ASTNode*, double> > FactorList;
+
+static ProductForm emptyForm() {
+	ProductForm form;
+	form.constant = 1;
+	form.polynomial.push_back(1);
+	return form;
+}
+
+static unsigned long long hashOf(const ASTNode* ast) {
+	return ast->analyzed ? ast->hash : structuralHash(ast);
+}
+
+static bool isWhole(double value) {
+	return value == floor(value) && fabs(value) <= MAX_SUBSTITUTION_DEGREE;
+}
+
+static std::vector<double> multiplied(const std::vector<double>& a, const std::vector<double>& b) {
+	std::vector<double> product(a.size() + b.size() - 1, 0.0);
+	for (size_t i = 0; i < a.size(); i++) {
+		for (size_t k = 0; k < b.size(); k++) {
+			product[i + k] += a[i] * b[k];
+		}
+	}
+	return product;
+}
+
+// Sets coefficients to those of ast as a polynomial in variable; returns false if it is not one of low enough degree
+static bool polynomialCoefficients(const ASTNode* ast, int variable, std::vector<double>& coefficients) {
+	if (ast == NULL || ast->degree < 0 || ast->degree > MAX_SUBSTITUTION_DEGREE) {
+		return false;
+	}
+	double value;
+	Evaluator evaluator;
+	if (ast->constant) {
+		coefficients.assign(1, 0.0);
+		return evaluator.tryEvaluate(ast, coefficients[0]);
+	}
+
+	std::vector<double> left, right;
+	switch (ast->type) {
+	case variableChar:
+		if (ast->symbol != variable) {
+			return false;
+		}
+		coefficients.assign(2, 0.0);
+		coefficients[1] = 1;
+		return true;
+	case unaryMinus:
+		if (!polynomialCoefficients(ast->left, variable, coefficients)) {
+			return false;
+		}
+		for (size_t i = 0; i < coefficients.size(); i++) coefficients[i] = -coefficients[i];
+		return true;
+	case operatorPlus: case operatorMinus:
+		if (!polynomialCoefficients(ast->left, variable, left) || !polynomialCoefficients(ast->right, variable, right)) {
+			return false;
+		}
+		coefficients.assign((left.size() > right.size()) ? left.size() : right.size(), 0.0);
+		for (size_t i = 0; i < left.size(); i++) coefficients[i] += left[i];
+		for (size_t i = 0; i < right.size(); i++) coefficients[i] += (ast->type == operatorPlus) ? right[i] : -right[i];
+		return true;
+	case operatorMul:
+		if (!polynomialCoefficients(ast->left, variable, left) || !polynomialCoefficients(ast->right, variable, right)) {
+			return false;
+		}
+		coefficients = multiplied(left, right);
+		return true;
+	case operatorDivision:
+		if (!polynomialCoefficients(ast->left, variable, coefficients) || !evaluator.tryEvaluate(ast->right, value)
+			|| value == 0) {
+			return false;
+		}
+		for (size_t i = 0; i < coefficients.size(); i++) coefficients[i] /= value;
+		return true;
+	case operatorPower:
+		if (!polynomialCoefficients(ast->left, variable, left)) {
+			return false;
+		}
+		coefficients.assign(1, 1.0);
+		for (int i = 0; i < (int)ast->right->value; i++) {
+			coefficients = multiplied(coefficients, left);
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+// What the derivatives and the outer functions are built with
+struct SubstitutionContext {
+	int variable;
+	NodeArena& arena;
+};
+
+static unsigned long long hashCoefficients(const std::vector<double>& coefficients) {
+	unsigned long long h = 0x9E3779B97F4A7C15ULL;
+	for (size_t i = 0; i < coefficients.size(); i++) {
+		double value = (coefficients[i] == 0) ? 0.0 : coefficients[i]; // -0 and 0 are the same coefficient
+		unsigned long long bits;
+		memcpy(&bits, &value, sizeof(bits));
+		h = (h ^ bits) * 0x100000001B3ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+// A polynomial base is keyed by its coefficients, so "x^2+1" and "1+x^2" are the same factor
+static ProductFactor makeFactor(const SubstitutionContext& context, const ASTNode* base, double exponent) {
+	ProductFactor factor;
+	factor.base = base;
+	factor.exponent = exponent;
+	if (base->degree >= 1 && polynomialCoefficients(base, context.variable, factor.coefficients)) {
+		factor.key = hashCoefficients(factor.coefficients);
+	}
+	else {
+		factor.coefficients.clear();
+		factor.key = hashOf(base);
+	}
+	return factor;
+}
+
+// Whether two factors with the same key have the same base; only called on a hash hit
+static bool sameBase(const ProductFactor& a, const ProductFactor& b) {
+	if (!a.coefficients.empty() || !b.coefficients.empty()) {
+		return a.coefficients == b.coefficients;
+	}
+	return a.base == b.base || sameTree(a.base, b.base);
+}
+
+// Multiplies form by factor; a polynomial with a whole positive exponent is multiplied out
+static void addFactor(ProductForm& form, const ProductFactor& factor) {
+	if (factor.exponent == 0) {
+		return;
+	}
+	if (!factor.coefficients.empty() && factor.exponent > 0 && isWhole(factor.exponent)
+		&& (factor.coefficients.size() - 1) * factor.exponent + form.polynomial.size() <= MAX_SUBSTITUTION_DEGREE + 1) {
+		for (int i = 0; i < (int)factor.exponent; i++) {
+			form.polynomial = multiplied(form.polynomial, factor.coefficients);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < form.factors.size(); i++) {
+		if (form.factors[i].key == factor.key && sameBase(form.factors[i], factor)) {
+			form.factors[i].exponent += factor.exponent;
+			return;
+		}
+	}
+	form.factors.push_back(factor);
+}
+
+static void addFactor(const SubstitutionContext& context, ProductForm& form, const ASTNode* base, double exponent) {
+	if (exponent != 0) {
+		addFactor(form, makeFactor(context, base, exponent));
+	}
+}
+
+static ASTNode* makeNode(const SubstitutionContext& context, ASTNodeType type, const ASTNode* left, const ASTNode* right) {
+	ASTNode* node = context.arena.allocate();
+	node->type = type;
+	node->left = const_cast<ASTNode*>(left);
+	node->right = const_cast<ASTNode*>(right);
+	analyzeNode(node);
+	return node;
+}
+
+static ASTNode* makeVariable(const SubstitutionContext& context, int symbol) {
+	ASTNode* node = context.arena.allocate();
+	node->type = variableChar;
+	node->symbol = symbol;
+	analyzeNode(node);
+	return node;
+}
+
+static ASTNode* makeNumber(const SubstitutionContext& context, double value) {
+	ASTNode* node = context.arena.allocate();
+	node->type = numberValue;
+	node->value = value;
+	analyzeNode(node);
+	return node;
+}
+
+// base^exponent, written as 1/base for -1 so that the Integrator's 1/x rule applies
+static ASTNode* raise(const SubstitutionContext& context, ASTNode* base, double exponent) {
+	if (exponent == 1) {
+		return base;
+	}
+	if (exponent == -1) {
+		return makeNode(context, operatorDivision, makeNumber(context, 1), base);
+	}
+	return makeNode(context, operatorPower, base, makeNumber(context, exponent));
+}
+
+static bool dependsOn(const ASTNode* ast, int variable) {
+	return (ast->variables & symbolBit(variable)) != 0;
+}
+
+// Multiplies form by the derivative of g, by the chain rule; returns false if that is not a product
+static bool derive(const SubstitutionContext& context, const ASTNode* g, ProductForm& form) {
+	if (g == NULL || !dependsOn(g, context.variable)) {
+		return false;
+	}
+	if (g->type == variableChar) {
+		return g->symbol == context.variable;
+	}
+
+	std::vector<double> coefficients;
+	if (g->degree >= 1 && polynomialCoefficients(g, context.variable, coefficients)) {
+		std::vector<double> derivative(coefficients.size() - 1, 0.0);
+		for (size_t i = 1; i < coefficients.size(); i++) {
+			derivative[i - 1] = coefficients[i] * i;
+		}
+		form.polynomial = multiplied(form.polynomial, derivative);
+		return true;
+	}
+
+	Evaluator evaluator;
+	double value;
+	const ASTNode* h = g->left;
+	switch (g->type) {
+	case unaryMinus:
+		form.constant = -form.constant;
+		return derive(context, h, form);
+	case operatorMul:
+		if (g->left->constant && evaluator.tryEvaluate(g->left, value)) {
+			form.constant *= value;
+			return derive(context, g->right, form);
+		}
+		if (g->right->constant && evaluator.tryEvaluate(g->right, value)) {
+			form.constant *= value;
+			return derive(context, g->left, form);
+		}
+		return false;
+	case operatorDivision:
+		if (!g->right->constant || !evaluator.tryEvaluate(g->right, value) || value == 0) {
+			return false;
+		}
+		form.constant /= value;
+		return derive(context, h, form);
+	case operatorPower:
+		// h^n is n*h^(n-1)*h', and a^h is ln(a)*a^h*h'
+		if (g->right->type == numberValue) {
+			form.constant *= g->right->value;
+			addFactor(context, form, h, g->right->value - 1);
+			return derive(context, h, form);
+		}
+		if (g->left->constant && evaluator.tryEvaluate(g->left, value) && value > 0) {
+			form.constant *= log(value);
+			addFactor(context, form, g, 1);
+			return derive(context, g->right, form);
+		}
+		return false;
+	case functionSin:
+		addFactor(context, form, makeNode(context, functionCos, h, NULL), 1);
+		break;
+	case functionCos:
+		form.constant = -form.constant;
+		addFactor(context, form, makeNode(context, functionSin, h, NULL), 1);
+		break;
+	case functionTan:
+		addFactor(context, form, makeNode(context, functionSec, h, NULL), 2);
+		break;
+	case functionSec:
+		addFactor(context, form, g, 1);
+		addFactor(context, form, makeNode(context, functionTan, h, NULL), 1);
+		break;
+	case functionCsc:
+		form.constant = -form.constant;
+		addFactor(context, form, g, 1);
+		addFactor(context, form, makeNode(context, functionCot, h, NULL), 1);
+		break;
+	case functionCot:
+		form.constant = -form.constant;
+		addFactor(context, form, makeNode(context, functionCsc, h, NULL), 2);
+		break;
+	case functionLn:
+		addFactor(context, form, h, -1);
+		break;
+	default:
+		return false;
+	}
+	return derive(context, h, form);
+}
+
+static void trim(std::vector<double>& polynomial) {
+	while (polynomial.size() > 1 && polynomial.back() == 0) {
+		polynomial.pop_back();
+	}
+}
+
+// Whether have equals scale * want for some constant scale, which is then set
+static bool matchForms(ProductForm& have, ProductForm& want, double& scale) {
+	std::unordered_multimap<unsigned long long, size_t> byHash;
+	size_t remaining = 0;
+	for (size_t i = 0; i < have.factors.size(); i++) {
+		if (have.factors[i].exponent != 0) {
+			byHash.insert(std::make_pair(have.factors[i].key, i));
+			remaining++;
+		}
+	}
+	typedef std::unordered_multimap<unsigned long long, size_t>::iterator Iterator;
+	for (size_t i = 0; i < want.factors.size(); i++) {
+		const ProductFactor& factor = want.factors[i];
+		if (factor.exponent == 0) {
+			continue;
+		}
+		std::pair<Iterator, Iterator> range = byHash.equal_range(factor.key);
+		Iterator match = range.second;
+		for (Iterator k = range.first; k != range.second; ++k) {
+			const ProductFactor& candidate = have.factors[k->second];
+			if (candidate.exponent == factor.exponent && sameBase(candidate, factor)) {
+				match = k;
+				break;
+			}
+		}
+		if (match == range.second) {
+			return false;
+		}
+		byHash.erase(match);
+		remaining--;
+	}
+	if (remaining != 0) {
+		return false;
+	}
+
+	// The polynomials have to be proportional; their leading coefficients give the ratio
+	trim(have.polynomial);
+	trim(want.polynomial);
+	if (have.polynomial.size() != want.polynomial.size() || want.polynomial.back() == 0 || want.constant == 0) {
+		return false;
+	}
+	double ratio = have.polynomial.back() / want.polynomial.back(), largest = 0;
+	for (size_t i = 0; i < have.polynomial.size(); i++) {
+		largest = fmax(largest, fabs(have.polynomial[i]));
+	}
+	for (size_t i = 0; i < have.polynomial.size(); i++) {
+		if (fabs(have.polynomial[i] - ratio * want.polynomial[i]) > 1e-12 * largest) {
+			return false;
+		}
+	}
+	scale = have.constant * ratio / want.constant;
+	return std::isfinite(scale) && scale != 0;
+}
+
+// Splits ast into (base, exponent) pairs; exponentSign is -1 below a division
+static bool collectFactors(const ASTNode* ast, double exponentSign, double& constant, FactorList& factors) {
+	if (ast == NULL) {
+		return false;
+	}
+	double value;
+	Evaluator evaluator;
+	if (ast->constant) {
+		if (!evaluator.tryEvaluate(ast, value) || value == 0) {
+			return false;
+		}
+		constant = (exponentSign > 0) ? constant * value : constant / value;
+		return true;
+	}
+
+	switch (ast->type) {
+	case operatorMul:
+		return collectFactors(ast->left, exponentSign, constant, factors)
+			&& collectFactors(ast->right, exponentSign, constant, factors);
+	case operatorDivision:
+		return collectFactors(ast->left, exponentSign, constant, factors)
+			&& collectFactors(ast->right, -exponentSign, constant, factors);
+	case unaryMinus:
+		constant = -constant;
+		return collectFactors(ast->left, exponentSign, constant, factors);
+	default:
+		break;
+	}
+	if (ast->type == operatorPower && ast->right != NULL && ast->right->type == numberValue) {
+		factors.push_back(std::make_pair(ast->left, exponentSign * ast->right->value));
+	}
+	else {
+		factors.push_back(std::make_pair(ast, exponentSign));
+	}
+	return true;
+}
+
+static bool isInner(const SubstitutionContext& context, const ASTNode* g) {
+	return g != NULL && dependsOn(g, context.variable) && g->type != variableChar;
+}
+
+// Whether g, with the rest of the integrand in rest, is a substitution; sets scale if it is
+// If power is given, g' may have g itself as a factor (sec(x)' is sec(x)*tan(x)); its exponent is taken out of g' and
+// subtracted from power
+static bool tryInner(const SubstitutionContext& context, const ASTNode* g, const ProductForm& rest, double& scale,
+	double* power = NULL) {
+	if (!isInner(context, g)) {
+		return false; // Substituting for the variable itself would only give the same integral back
+	}
+	ProductForm have = rest, want = emptyForm();
+	if (!derive(context, g, want)) {
+		return false;
+	}
+	if (power != NULL) {
+		ProductFactor self = makeFactor(context, g, 1);
+		for (size_t i = 0; i < want.factors.size(); i++) {
+			if (want.factors[i].key == self.key && sameBase(want.factors[i], self)) {
+				*power -= want.factors[i].exponent;
+				want.factors[i].exponent = 0;
+			}
+		}
+	}
+	return matchForms(have, want, scale);
+}
+
+static bool isPolynomialFactor(const SubstitutionContext& context, const ASTNode* base, double exponent) {
+	return base->degree >= 1 && (base->variables & ~symbolBit(context.variable)) == 0 && exponent > 0 && isWhole(exponent);
+}
+
+// A quick test, on hashes alone, that rules out most inner subtrees g before their derivatives are worked out: the
+// first factor the chain rule gives for g (cos(h) for sin(h), and so on) has to be one of the other factors, and if g'
+// is a polynomial, so has to be everything else. It may let through g that do not match, never the other way around.
+static bool mayMatch(const SubstitutionContext& context, const ASTNode* g, const FactorList& factors, size_t skip) {
+	if (g->degree >= 1 && (g->variables & ~symbolBit(context.variable)) == 0) {
+		for (size_t i = 0; i < factors.size(); i++) {
+			if (i != skip && !isPolynomialFactor(context, factors[i].first, factors[i].second)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const ASTNodeType derivatives[] = { functionCos, functionSin, functionSec, functionTan, functionCot, functionCsc };
+	unsigned long long needed;
+	if (g->type >= functionSin && g->type <= functionCot && g->left != NULL && g->left->analyzed) {
+		ASTNode derivative; // Only hashed; its children stay NULL so that destroying it frees nothing
+		derivative.type = derivatives[g->type - functionSin];
+		needed = nodeHash(&derivative, g->left->hash, 0);
+	}
+	else if (g->type == functionLn && g->left != NULL && g->left->analyzed && g->left->degree < 1) {
+		needed = g->left->hash;
+	}
+	else {
+		return true;
+	}
+	for (size_t i = 0; i < factors.size(); i++) {
+		if (i != skip && factors[i].first->analyzed && factors[i].first->hash == needed) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Constructor; tries the inner subtrees each factor offers against the product of all the other factors
+Substitutions::Substitutions(const ASTNode* ast, int variable, int substitute, NodeArena& arena) {
+	SubstitutionContext context = { variable, arena };
+	double constant = 1;
+	FactorList factors;
+	if (!collectFactors(ast, 1, constant, factors)) {
+		return;
+	}
+
+	// Each factor is keyed once, when the first inner subtree gets past mayMatch(), and the rest of the product for
+	// each factor is put together from the keyed ones
+	std::vector<ProductFactor> keyed;
+	for (size_t i = 0; i < factors.size(); i++) {
+		const ASTNode* base = factors[i].first;
+		double exponent = factors[i].second, scale;
+		const ASTNode* inners[3] = { base, NULL, NULL };
+		if ((base->type >= functionSin && base->type <= functionCot) || base->type == functionLn) {
+			inners[1] = base->left;
+		}
+		if (base->type == operatorPower && base->left->constant) {
+			inners[2] = base->right;
+		}
+
+		ProductForm rest;
+		bool restMade = false;
+		for (int kind = 0; kind < 3; kind++) {
+			const ASTNode* g = inners[kind];
+			if (g == NULL || !isInner(context, g) || !mayMatch(context, g, factors, i)) {
+				continue;
+			}
+			if (keyed.empty()) {
+				for (size_t k = 0; k < factors.size(); k++) {
+					keyed.push_back(makeFactor(context, factors[k].first, factors[k].second));
+				}
+			}
+			if (!restMade) {
+				rest = emptyForm();
+				rest.constant = constant;
+				for (size_t k = 0; k < factors.size(); k++) {
+					if (k != i) {
+						addFactor(rest, keyed[k]);
+					}
+				}
+				restMade = true;
+			}
+
+			// The base itself: g^n * g' is u^n
+			double power = exponent;
+			if (kind == 0 && tryInner(context, g, rest, scale, &power)) {
+				ASTNode* outer = (power == 0) ? NULL : raise(context, makeVariable(context, substitute), power);
+				addCandidate(g, outer, scale);
+			}
+			// The argument of a function: f(g)^n * g' is f(u)^n
+			if (kind == 1 && tryInner(context, g, rest, scale)) {
+				ASTNode* outer = makeNode(context, base->type, makeVariable(context, substitute), NULL);
+				addCandidate(g, raise(context, outer, exponent), scale);
+			}
+			// The exponent of a number: (a^g)^n * g' is (a^u)^n
+			if (kind == 2 && tryInner(context, g, rest, scale)) {
+				ASTNode* outer = makeNode(context, operatorPower, base->left, makeVariable(context, substitute));
+				addCandidate(g, raise(context, outer, exponent), scale);
+			}
+		}
+	}
+}
+
+void Substitutions::addCandidate(const ASTNode* inner, ASTNode* outer, double scale) {
+	SubstitutionCandidate candidate = { inner, outer, scale };
+	found.push_back(candidate);
+}
+
+size_t Substitutions::size() const {
+	return found.size();
+}
+
+const SubstitutionCandidate& Substitutions::candidate(size_t i) const {
+	return found[i];
+}
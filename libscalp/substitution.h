@@ -0,0 +1,62 @@
+/*
+* Declares the Substitutions class, which finds the ways an integrand can be written as f(g(x)) * g'(x) times a
+* constant, so that the Integrator can integrate f(u) with respect to u and put g(x) back in for u.
+*
+* The integrand is split into the factors of its product, each a base and a numeric exponent ("x/(x^2+1)^3" is x^1
+* and (x^2+1)^-3). Every factor offers the inner subtrees g that could have been substituted: the factor's base
+* itself, the argument of a function such as sin(g), and the exponent of a number such as e^g. For each one the
+* derivative of g is worked out in the same product form, by the chain rule, with the new factors it needs (cos(h)
+* for sin(h), and so on) placed in the arena. It then has to match the other factors of the integrand up to a
+* constant:
+*   - factors that are polynomials in x (with whole positive exponents) are multiplied out and compared by their
+*     coefficients, so "2x + 3" matches however the Parser shaped it;
+*   - every other factor is looked up by its structural hash (see ast.h), and only a hash hit is confirmed with
+*     sameTree(), so the trees are never compared pairwise.
+* The cost is linear in the size of the tree for each factor of the product, and the product rarely has more than a
+* handful of factors.
+*
+* Derivatives that are sums (other than polynomials), such as that of x*sin(x), are not followed; g is then not
+* offered.
+*
+*  Sample usage:
+*   NodeArena arena;
+*   Substitutions found(ast, SymbolTable::letter('x'), SymbolTable::intern("u_substitution"), arena);
+*   for (size_t i = 0; i < found.size(); i++) { ... integrate found.candidate(i).outer with respect to u ... }
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_SUBSTITUTION_H_
+#define SCALP_SUBSTITUTION_H_
+
+#include "arena.h"
+#include "ast.h"
+#include <vector>
+
+// Polynomials of higher degree, as factors or multiplied together, are compared by hash like other factors
+const int MAX_SUBSTITUTION_DEGREE = 64;
+
+// The integral of the integrand is scale times the integral of outer with respect to u, with u = inner
+struct SubstitutionCandidate {
+	const ASTNode* inner; // Part of the integrand's tree
+	ASTNode* outer; // In the arena; analyzed, and depends on no variable but u; NULL for 1, whose integral is u
+	double scale;
+};
+
+class Substitutions
+{
+	std::vector<SubstitutionCandidate> found;
+
+	void addCandidate(const ASTNode* inner, ASTNode* outer, double scale);
+
+public:
+	// Finds the substitutions for ast, an integrand in variable, writing u as the variable with symbol id substitute
+	// (see symbols.h); the nodes it makes live in arena
+	Substitutions(const ASTNode* ast, int variable, int substitute, NodeArena& arena);
+
+	// Number of substitutions found; they are numbered from 0, in the order of the factors they were found in
+	size_t size() const;
+
+	const SubstitutionCandidate& candidate(size_t i) const;
+};
+
+#endif // SCALP_SUBSTITUTION_H_
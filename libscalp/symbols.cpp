@@ -0,0 +1,177 @@
+/*
+* Implements the SymbolTable class in symbols.h
+* See comments in symbols.h for more details
+*/
+
+#include "symbols.h"
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+
+const int LETTER_SYMBOLS = 52;
+
+// Slots of the open-addressing index from names to ids; a power of two, and twice MAX_SYMBOLS so probes stay short
+const int SYMBOL_INDEX_SIZE = 2 * MAX_SYMBOLS;
+
+struct Symbol {
+	std::string name;
+	unsigned long long hash;
+};
+
+// Entries are published by storing them before count is raised, so readers that only use ids below count need no lock
+// The index is published the same way: a slot is only set, to id + 1, once symbols[id] is stored, and is never
+// changed again, so finding a name that is already there takes no lock either
+struct Table {
+	const Symbol* symbols[MAX_SYMBOLS];
+	std::atomic<int> count;
+	std::atomic<int> index[SYMBOL_INDEX_SIZE]; // id + 1 of the names that are not single letters; 0 for a free slot
+	std::mutex mutex; // Serializes interning
+
+	Table();
+};
+
+// 64-bit FNV-1a over the name's characters
+static unsigned long long hashName(const char* name, size_t length) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++) {
+		h ^= (unsigned char)name[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static const Symbol* createSymbol(const std::string& name) {
+	Symbol* symbol = new Symbol;
+	symbol->name = name;
+	symbol->hash = hashName(name.data(), name.size());
+	return symbol;
+}
+
+// Constructor; interns a-z and then A-Z so that their ids match SymbolTable::letter()
+Table::Table() {
+	for (int i = 0; i < MAX_SYMBOLS; i++) {
+		symbols[i] = NULL;
+	}
+	for (int i = 0; i < SYMBOL_INDEX_SIZE; i++) {
+		index[i].store(0, std::memory_order_relaxed);
+	}
+	for (int i = 0; i < 26; i++) {
+		symbols[i] = createSymbol(std::string(1, (char)('a' + i)));
+		symbols[26 + i] = createSymbol(std::string(1, (char)('A' + i)));
+	}
+	count.store(LETTER_SYMBOLS);
+}
+
+// Created on first use, so other files' static initializers can intern safely
+static Table& table() {
+	static Table instance;
+	return instance;
+}
+
+// The id of the name that is not a single letter, or -1; slot is left at the free slot where the search ended
+static int lookUp(Table& t, const char* name, size_t length, unsigned long long hash, int& slot) {
+	slot = (int)(hash & (SYMBOL_INDEX_SIZE - 1));
+	while (true) {
+		int entry = t.index[slot].load(std::memory_order_acquire);
+		if (entry == 0) {
+			return -1;
+		}
+		const Symbol* symbol = t.symbols[entry - 1];
+		if (symbol->hash == hash && symbol->name.size() == length && memcmp(symbol->name.data(), name, length) == 0) {
+			return entry - 1;
+		}
+		slot = (slot + 1) & (SYMBOL_INDEX_SIZE - 1);
+	}
+}
+
+int SymbolTable::letter(char letter) {
+	if (letter >= 'a' && letter <= 'z') return letter - 'a';
+	if (letter >= 'A' && letter <= 'Z') return 26 + letter - 'A';
+	return -1;
+}
+
+bool SymbolTable::isName(const std::string& name) {
+	if (name.empty() || !isalpha((unsigned char)name[0])) {
+		return false;
+	}
+	if (name.size() == 1) {
+		return true;
+	}
+	if (name[1] != '_' || name.size() < 3 || !isalnum((unsigned char)name[2])) {
+		return false;
+	}
+	for (size_t i = 3; i < name.size(); i++) {
+		if (!isalnum((unsigned char)name[i]) && name[i] != '_') {
+			return false;
+		}
+	}
+	return true;
+}
+
+int SymbolTable::find(const std::string& name) {
+	if (name.size() == 1) {
+		return letter(name[0]);
+	}
+
+	int slot;
+	return lookUp(table(), name.data(), name.size(), hashName(name.data(), name.size()), slot);
+}
+
+int SymbolTable::intern(const std::string& name) {
+	return intern(name.data(), name.size());
+}
+
+// Names that are already there are found without the lock; only adding one takes it, and looks again under it in
+// case another thread added the same name in between
+int SymbolTable::intern(const char* name, size_t length) {
+	if (length == 0) {
+		return -1;
+	}
+	if (length == 1 && letter(name[0]) >= 0) {
+		return letter(name[0]);
+	}
+
+	Table& t = table();
+	unsigned long long hash = hashName(name, length);
+	int slot;
+	int id = lookUp(t, name, length, hash, slot);
+	if (id >= 0) {
+		return id;
+	}
+
+	std::lock_guard<std::mutex> lock(t.mutex);
+	id = lookUp(t, name, length, hash, slot);
+	if (id >= 0) {
+		return id;
+	}
+	id = t.count.load(std::memory_order_relaxed);
+	if (id >= MAX_SYMBOLS) {
+		return -1;
+	}
+	t.symbols[id] = createSymbol(std::string(name, length));
+	t.count.store(id + 1, std::memory_order_release);
+	t.index[slot].store(id + 1, std::memory_order_release);
+	return id;
+}
+
+const std::string& SymbolTable::name(int id) {
+	static const std::string unknown = "?";
+	Table& t = table();
+	if (id < 0 || id >= t.count.load(std::memory_order_acquire)) {
+		return unknown;
+	}
+	return t.symbols[id]->name;
+}
+
+unsigned long long SymbolTable::nameHash(int id) {
+	Table& t = table();
+	if (id < 0 || id >= t.count.load(std::memory_order_acquire)) {
+		return 0;
+	}
+	return t.symbols[id]->hash;
+}
+
+int SymbolTable::size() {
+	return table().count.load(std::memory_order_acquire);
+}
@@ -0,0 +1,68 @@
+/*
+* Declares the SymbolTable class, which interns variable names to small integer ids so that an ASTNode can refer to
+* its variable with an int instead of carrying the name around.
+*
+* Single letters are interned up front: a-z have ids 0-25 and A-Z ids 26-51, the same order as the dependency bits
+* in analysis.h, so the common case never touches the table. Longer names (written x_1, v_max and so on, see
+* interpreter.cpp) get the next free id the first time they are seen.
+*
+* Ids are only meaningful within one process. Anything that outlives the process stores names (see serializer.h) or
+* name hashes (see structuralHash() in ast.h) instead.
+*
+* The table is shared by every thread and entries are never removed. Turning an id back into its name, and finding
+* or interning a name that is already in the table, never locks; only adding a new name takes a lock.
+*
+* Since ids live as long as the process, the table is bounded rather than scoped: once MAX_SYMBOLS ids are handed
+* out, intern() returns -1 for every new name, and the Parser rejects an expression that uses one with a
+* ParserException. Names already in the table, and all single letters, keep working. A long-running process that
+* is sent many distinct names (a server receiving a_1, a_2, ... from its clients) reaches this limit and stays
+* there until it is restarted; size() shows how close it is, and the server reports it with "!stats".
+*
+*  Sample usage:
+*   int y = SymbolTable::intern("y");
+*   std::string solution = integrator.integrate(ast, y);
+*   std::cout << "d" << SymbolTable::name(y);
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_SYMBOLS_H_
+#define SCALP_SYMBOLS_H_
+
+#include <cstddef>
+#include <string>
+
+// The most distinct names one process can intern, single letters included
+const int MAX_SYMBOLS = 4096;
+
+class SymbolTable
+{
+public:
+	// Returns the id of name, adding it to the table if it is new
+	// Returns -1 if name is empty or the table is full
+	static int intern(const std::string& name);
+
+	// The same for the length characters at name, which need not end there; lets the Parser intern a name straight
+	// from its input without copying it into a string first
+	static int intern(const char* name, size_t length);
+
+	// Whether name is written the way the Parser reads variable names: one letter, optionally followed by '_' and
+	// then letters, digits and underscores (x, x_1 and v_max are all names)
+	static bool isName(const std::string& name);
+
+	// Returns the id of name without adding it, or -1 if it has never been interned
+	static int find(const std::string& name);
+
+	// The id of a single letter, or -1 if letter is not one; never locks
+	static int letter(char letter);
+
+	// The name behind id, or "?" if id was never handed out
+	static const std::string& name(int id);
+
+	// A hash of the name behind id; unlike the id itself it is the same in every process
+	static unsigned long long nameHash(int id);
+
+	// Number of ids handed out so far, at most MAX_SYMBOLS
+	static int size();
+};
+
+#endif // SCALP_SYMBOLS_H_
@@ -0,0 +1,36 @@
+/*
+* Implements the non-template parts of tablerules.h
+* See comments in tablerules.h for more details
+*/
+
+#include "tablerules.h"
+#include <cstdio>
+
+size_t formatCoefficient(double value, char* buffer) {
+	if (value > -1e15 && value < 1e15 && value == (double)(long long)value) {
+		// Whole numbers are the common case (every exponent in a polynomial), so they skip snprintf
+		long long whole = (long long)value;
+		unsigned long long digits = (whole < 0) ? 0 - (unsigned long long)whole : (unsigned long long)whole;
+		char reversed[COEFFICIENT_MAX_LENGTH];
+		size_t count = 0;
+		do {
+			reversed[count++] = (char)('0' + digits % 10);
+			digits /= 10;
+		} while (digits != 0);
+		size_t length = 0;
+		if (whole < 0) {
+			buffer[length++] = '-';
+		}
+		while (count > 0) {
+			buffer[length++] = reversed[--count];
+		}
+		buffer[length] = 0;
+		return length;
+	}
+	return (size_t)snprintf(buffer, COEFFICIENT_MAX_LENGTH, "%.15g", value);
+}
+
+std::string formatCoefficient(double value) {
+	char text[COEFFICIENT_MAX_LENGTH];
+	return std::string(text, formatCoefficient(value, text));
+}
@@ -0,0 +1,246 @@
+/*
+* Declares the building blocks of the integrator's table of built-in integrals (see Integrator::lookInTable).
+*
+* Each entry of the table is a TableRule: a pattern type that describes the integrand and a result type that describes
+* its integral, written as expression templates. Everything a rule needs to know is in its type, so the compiler turns
+* the table into a chain of inlined checks on node fields: matching has no virtual calls, no lookups and no
+* allocation. Numbers a pattern matches are captured into a TableCaptures on the stack, and only a rule that matches
+* builds its result: the skeleton is written into a buffer sized from its bound, then copied into the string once.
+*
+*  Patterns:
+*   Var                        the variable of integration
+*   Number<n>                  the number n
+*   NonZeroNumber              any number but 0; captured
+*   Unary<type, A>             a function node of type whose argument matches A (Cos<A> for functionCos, ...)
+*   Binary<type, L, R>         an operator node of type whose operands match L and R (Div<L, R>, Pow<L, R>, ...)
+*
+*  Results:
+*   Result<segments...>        the segments one after another
+*   Text<'l', 'n', '('>        fixed text
+*   Name                       the variable's name
+*   Captured<i, n>             the i-th captured number plus n, written by formatCoefficient()
+*
+*  Sample usage:
+*   typedef TableRules<
+*       TableRule<ruleReciprocal, Div<Number<1>, Var>, Result<Text<'l', 'n', '('>, Name, Text<')'> > >
+*   > Table;
+*   std::string solution;
+*   IntegratorRule rule = Table::apply(ast, variable, solution); // ruleTableMiss if nothing matched
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_TABLERULES_H_
+#define SCALP_TABLERULES_H_
+
+#include "ast.h"
+#include "integrator.h"
+#include "symbols.h"
+#include <cstring>
+#include <string>
+
+// Most numbers one pattern can capture
+const int TABLE_MAX_CAPTURES = 4;
+
+// Longest text formatCoefficient() writes, including the terminating 0
+const size_t COEFFICIENT_MAX_LENGTH = 32;
+
+// Results that are certain to fit this many characters are built on the stack and copied into the string once
+const size_t TABLE_RESULT_BUFFER = 128;
+
+// Writes value to buffer (at least COEFFICIENT_MAX_LENGTH bytes) and returns its length
+// Whole numbers are written without a decimal point, anything else in full, so "2.5x" integrates to 2.5(x^2)/2
+size_t formatCoefficient(double value, char* buffer);
+std::string formatCoefficient(double value);
+
+// Numbers captured by the pattern being matched, in the order the pattern mentions them
+struct TableCaptures {
+	double numbers[TABLE_MAX_CAPTURES];
+	int count;
+};
+
+// Patterns; match() tells whether the subtree ast fits, capturing numbers on the way
+
+struct Var {
+	static bool match(const ASTNode* ast, int variable, TableCaptures&) {
+		return ast != NULL && ast->type == variableChar && ast->symbol == variable && ast->left == NULL && ast->right == NULL;
+	}
+};
+
+template <int N>
+struct Number {
+	static bool match(const ASTNode* ast, int, TableCaptures&) {
+		return ast != NULL && ast->type == numberValue && ast->value == N;
+	}
+};
+
+struct NonZeroNumber {
+	static bool match(const ASTNode* ast, int, TableCaptures& captures) {
+		if (ast == NULL || ast->type != numberValue || ast->value == 0 || captures.count == TABLE_MAX_CAPTURES) {
+			return false;
+		}
+		captures.numbers[captures.count++] = ast->value;
+		return true;
+	}
+};
+
+template <ASTNodeType Type, class Argument>
+struct Unary {
+	static bool match(const ASTNode* ast, int variable, TableCaptures& captures) {
+		return ast != NULL && ast->type == Type && Argument::match(ast->left, variable, captures);
+	}
+};
+
+template <ASTNodeType Type, class Left, class Right>
+struct Binary {
+	static bool match(const ASTNode* ast, int variable, TableCaptures& captures) {
+		return ast != NULL && ast->type == Type && Left::match(ast->left, variable, captures) && Right::match(ast->right, variable, captures);
+	}
+};
+
+template <class L, class R> using Div = Binary<operatorDivision, L, R>;
+template <class L, class R> using Mul = Binary<operatorMul, L, R>;
+template <class L, class R> using Pow = Binary<operatorPower, L, R>;
+template <class A> using Sin = Unary<functionSin, A>;
+template <class A> using Cos = Unary<functionCos, A>;
+
+// Result segments; write() puts the segment at buffer + length and returns the new length, which maxLength() bounds
+
+template <char... Characters>
+struct Text {
+	static size_t maxLength(const std::string&) {
+		return sizeof...(Characters);
+	}
+	static size_t write(char* buffer, size_t length, const std::string&, const TableCaptures&) {
+		static const char text[] = { Characters..., 0 };
+		memcpy(buffer + length, text, sizeof...(Characters));
+		return length + sizeof...(Characters);
+	}
+};
+
+struct Name {
+	static size_t maxLength(const std::string& name) {
+		return name.size();
+	}
+	static size_t write(char* buffer, size_t length, const std::string& name, const TableCaptures&) {
+		memcpy(buffer + length, name.data(), name.size());
+		return length + name.size();
+	}
+};
+
+template <int Index, int Add = 0>
+struct Captured {
+	static size_t maxLength(const std::string&) {
+		return COEFFICIENT_MAX_LENGTH;
+	}
+	static size_t write(char* buffer, size_t length, const std::string&, const TableCaptures& captures) {
+		return length + formatCoefficient(captures.numbers[Index] + Add, buffer + length);
+	}
+};
+
+template <class... Segments>
+struct Result;
+
+template <>
+struct Result<> {
+	static size_t maxLength(const std::string&) {
+		return 0;
+	}
+	static size_t write(char*, size_t length, const std::string&, const TableCaptures&) {
+		return length;
+	}
+};
+
+template <class First, class... Rest>
+struct Result<First, Rest...> {
+	static size_t maxLength(const std::string& name) {
+		return First::maxLength(name) + Result<Rest...>::maxLength(name);
+	}
+	static size_t write(char* buffer, size_t length, const std::string& name, const TableCaptures& captures) {
+		return Result<Rest...>::write(buffer, First::write(buffer, length, name, captures), name, captures);
+	}
+};
+
+// One entry of the table: integrands matching Pattern integrate to ResultSkeleton, counted as Rule
+template <IntegratorRule Rule, class Pattern, class ResultSkeleton>
+struct TableRule {
+	static const IntegratorRule rule = Rule;
+
+	static bool apply(const ASTNode* ast, int variable, std::string& solution) {
+		TableCaptures captures;
+		captures.count = 0;
+		if (!Pattern::match(ast, variable, captures)) {
+			return false;
+		}
+		const std::string& name = SymbolTable::name(variable);
+		size_t capacity = ResultSkeleton::maxLength(name);
+		if (capacity <= TABLE_RESULT_BUFFER) {
+			char buffer[TABLE_RESULT_BUFFER];
+			solution.assign(buffer, ResultSkeleton::write(buffer, 0, name, captures));
+		}
+		else {
+			solution.resize(capacity);
+			solution.resize(ResultSkeleton::write(&solution[0], 0, name, captures));
+		}
+		return true;
+	}
+};
+
+// Tries rules in the order they are written; the chain of checks TableRules::apply() inlines
+template <class... Rules>
+struct TableChain;
+
+template <>
+struct TableChain<> {
+	static IntegratorRule apply(const ASTNode*, int, std::string&) {
+		return ruleTableMiss;
+	}
+};
+
+template <class First, class... Rest>
+struct TableChain<First, Rest...> {
+	static IntegratorRule apply(const ASTNode* ast, int variable, std::string& solution) {
+		if (First::apply(ast, variable, solution)) {
+			return First::rule;
+		}
+		return TableChain<Rest...>::apply(ast, variable, solution);
+	}
+};
+
+// The table; rules are tried in order and the first one that matches writes solution
+// apply() returns the rule that matched, or ruleTableMiss (leaving solution alone) when none did
+template <class... Rules>
+struct TableRules {
+	static const size_t size = sizeof...(Rules);
+
+	static IntegratorRule apply(const ASTNode* ast, int variable, std::string& solution) {
+		return TableChain<Rules...>::apply(ast, variable, solution);
+	}
+
+	// The same, trying the rule at position order[0] first, then order[1], and so on; order must hold each of
+	// 0 .. size - 1 once. Reordering only saves checks when no node matches two of the patterns, since the order
+	// would otherwise decide which rule wins
+	static IntegratorRule apply(const ASTNode* ast, int variable, std::string& solution, const unsigned char* order) {
+		typedef bool (*Apply)(const ASTNode*, int, std::string&);
+		static const Apply appliers[] = { &Rules::apply... };
+		static const IntegratorRule rules[] = { Rules::rule... };
+		for (size_t i = 0; i < size; i++) {
+			if (appliers[order[i]](ast, variable, solution)) {
+				return rules[order[i]];
+			}
+		}
+		return ruleTableMiss;
+	}
+
+	// Position of rule in the table, or size if the table does not have it
+	static size_t indexOf(IntegratorRule rule) {
+		static const IntegratorRule rules[] = { Rules::rule... };
+		for (size_t i = 0; i < size; i++) {
+			if (rules[i] == rule) {
+				return i;
+			}
+		}
+		return size;
+	}
+};
+
+#endif // SCALP_TABLERULES_H_
@@ -0,0 +1,91 @@
+/*
+* Implements Tracer<true> in trace.h
+* See comments in trace.h for more details
+*/
+
+#include "trace.h"
+#include "formatter.h"
+#include <cstdio>
+#include <sstream>
+
+// Nothing here is compiled unless tracing is enabled, so release builds carry no per-thread buffers
+#if SCALP_ENABLE_TRACE
+
+enum TraceEventKind { traceRule, traceTransform, traceResult };
+
+// Text is copied into the event (truncated) because the tree it describes may be gone by the time it is dumped
+struct TraceEvent {
+	TraceEventKind kind;
+	int depth;
+	int code; // IntegratorRule for rules, rewrite number for transforms
+	char text[64];
+};
+
+struct TraceRing {
+	TraceEvent events[TRACE_CAPACITY];
+	unsigned long long recorded; // Total events ever recorded; the newest is at (recorded - 1) % TRACE_CAPACITY
+	int depth;
+};
+
+static thread_local TraceRing ring;
+
+static TraceEvent& nextEvent(TraceEventKind kind, int code) {
+	TraceEvent& event = ring.events[ring.recorded % TRACE_CAPACITY];
+	ring.recorded++;
+	event.kind = kind;
+	event.depth = ring.depth;
+	event.code = code;
+	event.text[0] = 0;
+	return event;
+}
+
+void Tracer<true>::rule(IntegratorRule rule, const ASTNode* node) {
+	TraceEvent& event = nextEvent(traceRule, rule);
+	Formatter::formatInto(node, event.text, 0, sizeof(event.text));
+}
+
+void Tracer<true>::transform(int rewrite, const ASTNode* node) {
+	TraceEvent& event = nextEvent(traceTransform, rewrite);
+	Formatter::formatInto(node, event.text, 0, sizeof(event.text));
+}
+
+void Tracer<true>::result(const std::string& text) {
+	TraceEvent& event = nextEvent(traceResult, 0);
+	snprintf(event.text, sizeof(event.text), "%s", text.c_str());
+}
+
+void Tracer<true>::enter() {
+	ring.depth++;
+}
+
+void Tracer<true>::leave() {
+	ring.depth--;
+}
+
+std::string Tracer<true>::dump() {
+	std::stringstream sstr;
+	unsigned long long first = (ring.recorded > TRACE_CAPACITY) ? ring.recorded - TRACE_CAPACITY : 0;
+	if (first > 0) {
+		sstr << "(" << first << " older events overwritten)\n";
+	}
+	for (unsigned long long i = first; i < ring.recorded; i++) {
+		const TraceEvent& event = ring.events[i % TRACE_CAPACITY];
+		for (int level = 0; level < event.depth; level++) sstr << "  ";
+		if (event.kind == traceRule) {
+			sstr << "rule " << INTEGRATOR_RULE_NAMES[event.code] << ": " << event.text << "\n";
+		}
+		else if (event.kind == traceTransform) {
+			sstr << "simplify #" << event.code << " -> " << event.text << "\n";
+		}
+		else {
+			sstr << "result: " << event.text << "\n";
+		}
+	}
+	return sstr.str();
+}
+
+void Tracer<true>::clear() {
+	ring.recorded = 0;
+}
+
+#endif // SCALP_ENABLE_TRACE
@@ -0,0 +1,88 @@
+/*
+* Declares the Tracer class template, which records which integrator rules and simplify rewrites were applied, so
+* that a surprising answer (or an ERROR) can be explained by dumping its derivation.
+*
+* Tracing is switched at compile time with SCALP_ENABLE_TRACE (on in Debug builds, off otherwise). Code records
+* events through the Trace typedef; when tracing is off, Trace is Tracer<false>, whose members are empty inline
+* functions, so release builds contain no tracing code or data at all.
+*
+* Events go to a fixed-size ring buffer owned by the recording thread; recording never locks or allocates, and once
+* the buffer is full the oldest events are overwritten. dump() reads the calling thread's buffer.
+*
+*  Sample usage:
+*   Trace::clear();
+*   std::string solution = integrator.integrate(ast);
+*   std::cout << Trace::dump();
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_TRACE_H_
+#define SCALP_TRACE_H_
+
+#include "ast.h"
+#include "integrator.h"
+#include <string>
+
+#ifndef SCALP_ENABLE_TRACE
+#define SCALP_ENABLE_TRACE 0
+#endif
+
+// Events kept per thread before the oldest are overwritten
+const int TRACE_CAPACITY = 4096;
+
+template <bool Enabled>
+class Tracer;
+
+template <>
+class Tracer<true>
+{
+public:
+	static const bool enabled = true;
+
+	// An integrator rule matched node
+	static void rule(IntegratorRule rule, const ASTNode* node);
+
+	// Parser::simplify applied identity rewrite number rewrite (or LikeTerms combined a sum, 8, or product, 9), leaving node
+	static void transform(int rewrite, const ASTNode* node);
+
+	// The final answer of one integrate() call
+	static void result(const std::string& text);
+
+	// Rules recorded between enter() and leave() are indented one level deeper in the dump
+	static void enter();
+	static void leave();
+
+	// One line per event still in this thread's buffer, oldest first
+	static std::string dump();
+	static void clear();
+};
+
+template <>
+class Tracer<false>
+{
+public:
+	static const bool enabled = false;
+
+	static void rule(IntegratorRule, const ASTNode*) {}
+	static void transform(int, const ASTNode*) {}
+	static void result(const std::string&) {}
+	static void enter() {}
+	static void leave() {}
+	static std::string dump() { return ""; }
+	static void clear() {}
+};
+
+typedef Tracer<SCALP_ENABLE_TRACE != 0> Trace;
+
+// Calls Trace::enter() and Trace::leave() for the lifetime of a scope
+class TraceScope
+{
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+
+public:
+	TraceScope() { Trace::enter(); }
+	~TraceScope() { Trace::leave(); }
+};
+
+#endif // SCALP_TRACE_H_
@@ -0,0 +1,240 @@
+/*
+* Implements the TrigIntegrals class in trigintegrals.h
+* See comments in trigintegrals.h for more details
+*/
+
+#include "trigintegrals.h"
+#include "fraction.h"
+#include "symbols.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// The integrands TrigIntegrals knows; the last five are numbered like functionSin to functionCot in ast.h
+enum TrigFamily { familySinCos, familyTan = 2, familySec, familyCsc, familyCot };
+
+// One memoised integral: a term of its own plus scale times the integral memoised at lower
+struct TrigStep {
+	Fraction coefficient;
+	std::string factor; // The term without its coefficient; '#' stands for the variable
+	Fraction scale;
+	int lower; // -1 for the powers 0 and 1, which are a single term, or when scale is 0
+};
+
+struct TrigMemo {
+	std::mutex mutex; // Guards both members
+	std::vector<TrigStep> steps;
+	std::unordered_map<unsigned long long, int> index; // Key of (family, m, n) to its step
+};
+
+// Created on first use, and never destroyed, as it holds nothing but memory
+static TrigMemo& trigMemo() {
+	static TrigMemo* memo = new TrigMemo;
+	return *memo;
+}
+
+static unsigned long long memoKey(TrigFamily family, unsigned int m, unsigned int n) {
+	return ((unsigned long long)family << 48) | ((unsigned long long)m << 24) | n;
+}
+
+// "" for exponent 0, "sin(#)" for 1, "sin(#)^k" above that
+static std::string power(const char* function, unsigned int exponent) {
+	std::string text;
+	if (exponent > 0) {
+		text = std::string(function) + "(#)";
+	}
+	if (exponent > 1) {
+		text += "^" + std::to_string(exponent);
+	}
+	return text;
+}
+
+static std::string product(const std::string& a, const std::string& b) {
+	return (a.empty() || b.empty()) ? a + b : a + "*" + b;
+}
+
+// Moves (m, n) to the powers the reduction formula for them refers to; returns false for the base cases
+static bool reduce(TrigFamily family, unsigned int& m, unsigned int& n) {
+	if (n >= 2) {
+		n -= 2;
+		return true;
+	}
+	if (family == familySinCos && m >= 2) {
+		m -= 2;
+		return true;
+	}
+	return false;
+}
+
+// The step for (m, n), given the index of the step for the powers reduce() leads to
+static TrigStep makeStep(TrigFamily family, unsigned int m, unsigned int n, int lower) {
+	TrigStep step;
+	step.scale = fraction(0, 1);
+	step.lower = -1;
+	long long total = (long long)m + n;
+
+	if (family == familySinCos && n >= 2) {
+		step.coefficient = fraction(1, total);
+		step.factor = product(power("sin", m + 1), power("cos", n - 1));
+		step.scale = fraction(n - 1, total);
+	}
+	else if (family == familySinCos && m >= 2) {
+		step.coefficient = fraction(-1, total);
+		step.factor = product(power("sin", m - 1), power("cos", n + 1));
+		step.scale = fraction(m - 1, total);
+	}
+	else if (family == familySinCos) {
+		// sin^0 cos^0 = 1, sin -> -cos, cos -> sin, sin cos -> sin^2/2
+		const long long numerators[4] = { 1, -1, 1, 1 };
+		const long long denominators[4] = { 1, 1, 1, 2 };
+		const char* factors[4] = { "#", "cos(#)", "sin(#)", "sin(#)^2" };
+		step.coefficient = fraction(numerators[2 * n + m], denominators[2 * n + m]);
+		step.factor = factors[2 * n + m];
+	}
+	else if (n >= 2) {
+		const char* functions[6] = { "sin", "cos", "tan", "sec", "csc", "cot" };
+		bool negative = (family == familyCsc || family == familyCot);
+		step.coefficient = fraction(negative ? -1 : 1, n - 1);
+		if (family == familyTan || family == familyCot) {
+			step.factor = power(functions[family], n - 1);
+			step.scale = fraction(-1, 1);
+		}
+		else {
+			step.factor = product(power(functions[family], n - 2), (family == familySec) ? "tan(#)" : "cot(#)");
+			step.scale = fraction(n - 2, n - 1);
+		}
+	}
+	else if (n == 1) {
+		const long long signs[6] = { 0, 0, -1, 1, -1, 1 };
+		const char* logs[6] = { "", "", "ln(cos(#))", "ln(sec(#)+tan(#))", "ln(csc(#)+cot(#))", "ln(sin(#))" };
+		step.coefficient = fraction(signs[family], 1);
+		step.factor = logs[family];
+	}
+	else {
+		step.coefficient = fraction(1, 1);
+		step.factor = "#";
+	}
+
+	if (step.scale.numerator != 0) {
+		step.lower = lower;
+	}
+	return step;
+}
+
+// Returns the step for (m, n), memoising it and every step below it that is not memoised yet
+// Walks down to the first memoised step (or a base case) and then back up, so the work is linear in the powers
+static int memoize(TrigMemo& memo, TrigFamily family, unsigned int m, unsigned int n) {
+	std::vector<std::pair<unsigned int, unsigned int> > pending;
+	int below = -1;
+	while (true) {
+		std::unordered_map<unsigned long long, int>::const_iterator found = memo.index.find(memoKey(family, m, n));
+		if (found != memo.index.end()) {
+			below = found->second;
+			break;
+		}
+		pending.push_back(std::make_pair(m, n));
+		if (!reduce(family, m, n)) {
+			break;
+		}
+	}
+
+	for (size_t i = pending.size(); i-- > 0; ) {
+		memo.steps.push_back(makeStep(family, pending[i].first, pending[i].second, below));
+		below = (int)memo.steps.size() - 1;
+		memo.index[memoKey(family, pending[i].first, pending[i].second)] = below;
+	}
+	return below;
+}
+
+// Adds up the exponent of each trigonometric function of the variable in a product of them
+// Factors of 1, which the Parser leaves in products such as "sin(x)cos(x)", and powers of 0 are skipped
+static bool collectPowers(const ASTNode* ast, int variable, unsigned int exponents[6]) {
+	if (ast == NULL) {
+		return false;
+	}
+	if (ast->type == numberValue) {
+		return ast->value == 1;
+	}
+	if (ast->type == operatorMul) {
+		return collectPowers(ast->left, variable, exponents) && collectPowers(ast->right, variable, exponents);
+	}
+
+	const ASTNode* function = ast;
+	double exponent = 1;
+	if (ast->type == operatorPower) {
+		if (ast->right == NULL || ast->right->type != numberValue) {
+			return false;
+		}
+		function = ast->left;
+		exponent = ast->right->value;
+	}
+	if (function == NULL || function->type < functionSin || function->type > functionCot
+		|| function->left == NULL || function->left->type != variableChar || function->left->symbol != variable) {
+		return false;
+	}
+	if (exponent < 0 || exponent > MAX_TRIG_POWER || exponent != (unsigned int)exponent) {
+		return false;
+	}
+	unsigned int& total = exponents[function->type - functionSin];
+	total += (unsigned int)exponent;
+	return total <= MAX_TRIG_POWER;
+}
+
+bool TrigIntegrals::integrate(const ASTNode* ast, int variable, std::string& solution) {
+	unsigned int exponents[6] = { 0, 0, 0, 0, 0, 0 };
+	if (!collectPowers(ast, variable, exponents)) {
+		return false;
+	}
+
+	// sin and cos mix with each other; the others are only integrated on their own
+	TrigFamily family = familySinCos;
+	unsigned int m = exponents[0], n = exponents[1];
+	int others = 0;
+	for (int f = familyTan; f <= familyCot; f++) {
+		if (exponents[f] > 0) {
+			others++;
+			family = (TrigFamily)f;
+			m = 0;
+			n = exponents[f];
+		}
+	}
+	if ((others > 0 && exponents[0] + exponents[1] > 0) || others > 1 || m + n == 0) {
+		return false;
+	}
+
+	// Walk the links with the lock held, multiplying the scales out as we go
+	std::vector<Fraction> coefficients;
+	std::vector<std::string> factors;
+	{
+		TrigMemo& memo = trigMemo();
+		std::lock_guard<std::mutex> lock(memo.mutex);
+		Fraction scale = fraction(1, 1);
+		for (int i = memoize(memo, family, m, n); i >= 0; i = memo.steps[i].lower) {
+			const TrigStep& step = memo.steps[i];
+			Fraction coefficient;
+			if (!multiply(scale, step.coefficient, coefficient) || !multiply(scale, step.scale, scale)) {
+				return false;
+			}
+			coefficients.push_back(coefficient);
+			factors.push_back(step.factor);
+		}
+	}
+
+	const std::string& name = SymbolTable::name(variable);
+	for (size_t i = 0; i < factors.size(); i++) {
+		std::string factor;
+		for (size_t k = 0; k < factors[i].size(); k++) {
+			if (factors[i][k] == '#') factor += name;
+			else factor += factors[i][k];
+		}
+		factors[i] = factor;
+	}
+	solution = formatTerms(coefficients, factors);
+	return true;
+}
+
+size_t TrigIntegrals::memoized() {
+	TrigMemo& memo = trigMemo();
+	std::lock_guard<std::mutex> lock(memo.mutex);
+	return memo.steps.size();
+}
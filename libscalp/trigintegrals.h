@@ -0,0 +1,46 @@
+/*
+* Declares the TrigIntegrals class, which integrates powers of the trigonometric functions of the bare variable with
+* reduction formulas: sin(x)^m * cos(x)^n, and tan(x)^n, sec(x)^n, csc(x)^n or cot(x)^n on their own.
+*
+* Each formula writes the integral of a power as one new term plus a multiple of the integral of a power two lower:
+*   int sin^m cos^n = sin^(m+1) cos^(n-1) / (m+n) + (n-1)/(m+n) int sin^m cos^(n-2)      (n >= 2)
+*   int sin^m cos^n = -sin^(m-1) cos^(n+1) / (m+n) + (m-1)/(m+n) int sin^(m-2) cos^n     (m >= 2)
+*   int tan^n = tan^(n-1) / (n-1) - int tan^(n-2)
+*   int cot^n = -cot^(n-1) / (n-1) - int cot^(n-2)
+*   int sec^n = sec^(n-2) tan / (n-1) + (n-2)/(n-1) int sec^(n-2)
+*   int csc^n = -csc^(n-2) cot / (n-1) + (n-2)/(n-1) int csc^(n-2)
+* down to powers 0 and 1, which are known. Every step is memoised for the whole process by (function, m, n) as its
+* term and a link to the step below, so a power costs work linear in the power the first time it (or anything above
+* it) is asked for, and only the walk down the links after that. Coefficients are exact fractions; a power whose
+* coefficients would overflow 64 bits is left unintegrated, as is one above MAX_TRIG_POWER.
+*
+* Logarithms are written without absolute values, like the 1/x rule of the integrator: int tan(x) = -ln(cos(x)).
+*
+*  Sample usage:
+*   std::string solution;
+*   if (TrigIntegrals::integrate(ast, SymbolTable::letter('x'), solution)) { ... } // "(x/2 - (sin(x)*cos(x))/2)"
+*/
+
+// #define guard prevents multiple inclusion; follows Google style guard naming convention (<PROJECT>_<FILE>_H_)
+#ifndef SCALP_TRIGINTEGRALS_H_
+#define SCALP_TRIGINTEGRALS_H_
+
+#include "ast.h"
+#include <string>
+
+// Highest power of one function that is integrated; the answer has about half this many terms
+const unsigned int MAX_TRIG_POWER = 256;
+
+class TrigIntegrals
+{
+public:
+	// Integrates ast with respect to the variable with symbol id variable (see symbols.h) if it is one of the
+	// products above; returns false, leaving solution alone, otherwise. The answer is written by formatTerms() (see
+	// fraction.h), so it can be scaled or subtracted as it is.
+	static bool integrate(const ASTNode* ast, int variable, std::string& solution);
+
+	// Number of reduction steps memoised so far
+	static size_t memoized();
+};
+
+#endif // SCALP_TRIGINTEGRALS_H_